@@ -0,0 +1,35 @@
+// Builds a max-depth pyramid: cs_copy_depth fills mip 0 from the depth buffer,
+// cs_downsample reduces each following mip from the one above it.
+@group(0) @binding(0) var source_depth: texture_depth_2d;
+@group(0) @binding(1) var destination: texture_storage_2d<r32float, write>;
+@group(0) @binding(2) var source_mip: texture_2d<f32>;
+
+@compute @workgroup_size(8, 8)
+fn cs_copy_depth(@builtin(global_invocation_id) id: vec3u) {
+    if (any(id.xy >= textureDimensions(destination))) {
+        return;
+    }
+    textureStore(destination, id.xy, vec4f(textureLoad(source_depth, id.xy, 0), 0.0, 0.0, 0.0));
+}
+
+@compute @workgroup_size(8, 8)
+fn cs_downsample(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(destination);
+    if (any(id.xy >= size)) {
+        return;
+    }
+
+    // Odd source sizes fold the extra row or column into the last texel.
+    let source_size = textureDimensions(source_mip);
+    let odd = ((source_size & vec2u(1u)) == vec2u(1u)) & (id.xy == size - 1u);
+    let extent = select(vec2u(2u), vec2u(3u), odd);
+    let base = id.xy * 2u;
+
+    var depth = 0.0;
+    for (var y = 0u; y < extent.y; y++) {
+        for (var x = 0u; x < extent.x; x++) {
+            depth = max(depth, textureLoad(source_mip, min(base + vec2u(x, y), source_size - 1u), 0).r);
+        }
+    }
+    textureStore(destination, id.xy, vec4f(depth, 0.0, 0.0, 0.0));
+}
@@ -0,0 +1,173 @@
+// Image based lighting precomputation, dispatched once per environment by
+// tkImageBasedLighting. Cube faces follow the WebGPU layer order +X, -X, +Y, -Y, +Z, -Z.
+
+struct FilterParams {
+    roughness: f32,
+    source_size: f32,
+    sample_count: u32,
+    pad: u32
+}
+
+@group(0) @binding(0) var linear_sampler: sampler;
+@group(0) @binding(1) var equirect_texture: texture_2d<f32>;
+@group(0) @binding(2) var environment_texture: texture_cube<f32>;
+@group(0) @binding(3) var source_faces: texture_2d_array<f32>;
+@group(0) @binding(4) var cube_output: texture_storage_2d_array<rgba16float, write>;
+@group(0) @binding(5) var lut_output: texture_storage_2d<rgba16float, write>;
+@group(0) @binding(6) var<uniform> params: FilterParams;
+
+const PI = 3.14159265359;
+const HALF_MAX = 65504.0;
+
+fn cube_direction(face: u32, uv: vec2f) -> vec3f {
+    switch face {
+        case 0u: { return normalize(vec3f(1.0, -uv.y, -uv.x)); }
+        case 1u: { return normalize(vec3f(-1.0, -uv.y, uv.x)); }
+        case 2u: { return normalize(vec3f(uv.x, 1.0, uv.y)); }
+        case 3u: { return normalize(vec3f(uv.x, -1.0, -uv.y)); }
+        case 4u: { return normalize(vec3f(uv.x, -uv.y, 1.0)); }
+        default: { return normalize(vec3f(-uv.x, -uv.y, -1.0)); }
+    }
+}
+
+fn face_uv(id: vec2u, size: vec2u) -> vec2f {
+    return (vec2f(id) + 0.5) / vec2f(size) * 2.0 - 1.0;
+}
+
+fn hammersley(i: u32, count: u32) -> vec2f {
+    return vec2f(f32(i) / f32(count), f32(reverseBits(i)) * 2.3283064365386963e-10);
+}
+
+fn tangent_to_world(v: vec3f, N: vec3f) -> vec3f {
+    let up = select(vec3f(1.0, 0.0, 0.0), vec3f(0.0, 0.0, 1.0), abs(N.z) < 0.999);
+    let T = normalize(cross(up, N));
+    let B = cross(N, T);
+    return T * v.x + B * v.y + N * v.z;
+}
+
+fn importance_sample_ggx(xi: vec2f, N: vec3f, roughness: f32) -> vec3f {
+    let a = roughness * roughness;
+    let phi = 2.0 * PI * xi.x;
+    let cos_theta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    let sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+    return tangent_to_world(vec3f(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta), N);
+}
+
+fn distribution_ggx(NdotH: f32, roughness: f32) -> f32 {
+    let a = roughness * roughness;
+    let a2 = a * a;
+    let denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    return a2 / (PI * denom * denom);
+}
+
+// Filtered importance sampling: pick the environment mip whose texel covers the same
+// solid angle as the sample, so a few hundred samples give a noise free result.
+fn sample_lod(pdf: f32) -> f32 {
+    let sample_angle = 1.0 / (f32(params.sample_count) * pdf + 1e-4);
+    let texel_angle = 4.0 * PI / (6.0 * params.source_size * params.source_size);
+    return max(0.5 * log2(sample_angle / texel_angle), 0.0);
+}
+
+@compute @workgroup_size(8, 8, 1)
+fn cs_equirect_to_cube(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(cube_output);
+    if (any(id.xy >= size)) {
+        return;
+    }
+    let dir = cube_direction(id.z, face_uv(id.xy, size));
+    let uv = vec2f(atan2(dir.z, dir.x) / (2.0 * PI) + 0.5, acos(clamp(dir.y, -1.0, 1.0)) / PI);
+    let color = textureSampleLevel(equirect_texture, linear_sampler, uv, 0.0).rgb;
+    textureStore(cube_output, id.xy, id.z, vec4f(min(color, vec3f(HALF_MAX)), 1.0));
+}
+
+@compute @workgroup_size(8, 8, 1)
+fn cs_downsample(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(cube_output);
+    if (any(id.xy >= size)) {
+        return;
+    }
+    let src = id.xy * 2u;
+    let color = textureLoad(source_faces, src, id.z, 0) +
+                textureLoad(source_faces, src + vec2u(1u, 0u), id.z, 0) +
+                textureLoad(source_faces, src + vec2u(0u, 1u), id.z, 0) +
+                textureLoad(source_faces, src + vec2u(1u, 1u), id.z, 0);
+    textureStore(cube_output, id.xy, id.z, color * 0.25);
+}
+
+// Stores irradiance / PI so shading only multiplies by albedo.
+@compute @workgroup_size(8, 8, 1)
+fn cs_irradiance(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(cube_output);
+    if (any(id.xy >= size)) {
+        return;
+    }
+    let N = cube_direction(id.z, face_uv(id.xy, size));
+    var irradiance = vec3f(0.0);
+    for (var i = 0u; i < params.sample_count; i++) {
+        // Cosine weighted hemisphere sample, pdf = cos(theta) / PI.
+        let xi = hammersley(i, params.sample_count);
+        let cos_theta = sqrt(1.0 - xi.y);
+        let sin_theta = sqrt(xi.y);
+        let phi = 2.0 * PI * xi.x;
+        let L = tangent_to_world(vec3f(cos(phi) * sin_theta, sin(phi) * sin_theta, cos_theta), N);
+        irradiance += textureSampleLevel(environment_texture, linear_sampler, L, sample_lod(cos_theta / PI)).rgb;
+    }
+    textureStore(cube_output, id.xy, id.z, vec4f(irradiance / f32(params.sample_count), 1.0));
+}
+
+// One dispatch per mip, roughness rising linearly with the mip level. Assumes N = V.
+@compute @workgroup_size(8, 8, 1)
+fn cs_prefilter(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(cube_output);
+    if (any(id.xy >= size)) {
+        return;
+    }
+    let N = cube_direction(id.z, face_uv(id.xy, size));
+    var color = vec3f(0.0);
+    var weight = 0.0;
+    for (var i = 0u; i < params.sample_count; i++) {
+        let H = importance_sample_ggx(hammersley(i, params.sample_count), N, params.roughness);
+        let L = normalize(2.0 * dot(N, H) * H - N);
+        let NdotL = dot(N, L);
+        if (NdotL > 0.0) {
+            // pdf = D * NdotH / (4 * VdotH), which reduces to D / 4 with N = V.
+            let pdf = distribution_ggx(max(dot(N, H), 0.0), params.roughness) * 0.25;
+            let lod = select(sample_lod(pdf), 0.0, params.roughness == 0.0);
+            color += textureSampleLevel(environment_texture, linear_sampler, L, lod).rgb * NdotL;
+            weight += NdotL;
+        }
+    }
+    textureStore(cube_output, id.xy, id.z, vec4f(color / max(weight, 1e-4), 1.0));
+}
+
+// Split-sum BRDF: x = NdotV, y = roughness, stores the F0 scale and bias in rg.
+@compute @workgroup_size(8, 8, 1)
+fn cs_brdf_lut(@builtin(global_invocation_id) id: vec3u) {
+    let size = textureDimensions(lut_output);
+    if (any(id.xy >= size)) {
+        return;
+    }
+    let NdotV = (f32(id.x) + 0.5) / f32(size.x);
+    let roughness = (f32(id.y) + 0.5) / f32(size.y);
+    let V = vec3f(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+    let N = vec3f(0.0, 0.0, 1.0);
+    let k = roughness * roughness * 0.5;
+
+    var scale = 0.0;
+    var bias = 0.0;
+    for (var i = 0u; i < params.sample_count; i++) {
+        let H = importance_sample_ggx(hammersley(i, params.sample_count), N, roughness);
+        let L = normalize(2.0 * dot(V, H) * H - V);
+        let NdotL = max(L.z, 0.0);
+        if (NdotL > 0.0) {
+            let NdotH = max(H.z, 0.0);
+            let VdotH = max(dot(V, H), 0.0);
+            let G = (NdotV / (NdotV * (1.0 - k) + k)) * (NdotL / (NdotL * (1.0 - k) + k));
+            let G_vis = G * VdotH / (NdotH * NdotV);
+            let Fc = pow(1.0 - VdotH, 5.0);
+            scale += (1.0 - Fc) * G_vis;
+            bias += Fc * G_vis;
+        }
+    }
+    textureStore(lut_output, id.xy, vec4f(scale, bias, 0.0, 1.0) / vec4f(f32(params.sample_count), f32(params.sample_count), 1.0, 1.0));
+}
@@ -0,0 +1,78 @@
+const CLUSTERS_X = 16u;
+const CLUSTERS_Y = 16u;
+const CLUSTERS_Z = 24u;
+const MAX_LIGHTS_PER_CLUSTER = 128u;
+
+struct Light {
+    position: vec3f,
+    range: f32,
+    color: vec3f,
+    intensity: f32
+}
+
+struct LightParams {
+    view: mat4x4f,
+    inv_proj: mat4x4f,
+    screen_size: vec2f,
+    near: f32,
+    far: f32,
+    light_count: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32
+}
+
+@group(0) @binding(0) var<uniform> params: LightParams;
+@group(0) @binding(1) var<storage, read> lights: array<Light>;
+@group(0) @binding(2) var<storage, read_write> cluster_counts: array<u32>;
+@group(0) @binding(3) var<storage, read_write> cluster_lights: array<u32>;
+
+// View-space point on the ray through an NDC position, at the given view depth.
+fn view_point(ndc: vec2f, depth: f32) -> vec3f {
+    let p = params.inv_proj * vec4f(ndc, 0.0, 1.0);
+    let ray = p.xyz / p.w;
+    return ray * (depth / -ray.z);
+}
+
+// One thread per froxel. Depth slices are logarithmic between near and far.
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3u) {
+    let cluster = id.x;
+    if (cluster >= CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z) {
+        return;
+    }
+
+    let x = cluster % CLUSTERS_X;
+    let y = (cluster / CLUSTERS_X) % CLUSTERS_Y;
+    let z = cluster / (CLUSTERS_X * CLUSTERS_Y);
+
+    let tile = vec2f(1.0 / f32(CLUSTERS_X), 1.0 / f32(CLUSTERS_Y));
+    let ndc_min = vec2f(f32(x) * tile.x, 1.0 - f32(y + 1u) * tile.y) * 2.0 - 1.0;
+    let ndc_max = vec2f(f32(x + 1u) * tile.x, 1.0 - f32(y) * tile.y) * 2.0 - 1.0;
+    let ratio = params.far / params.near;
+    let depth_near = params.near * pow(ratio, f32(z) / f32(CLUSTERS_Z));
+    let depth_far = params.near * pow(ratio, f32(z + 1u) / f32(CLUSTERS_Z));
+
+    var box_min = vec3f(1e30);
+    var box_max = vec3f(-1e30);
+    for (var i = 0u; i < 4u; i++) {
+        let ndc = vec2f(select(ndc_min.x, ndc_max.x, (i & 1u) != 0u), select(ndc_min.y, ndc_max.y, (i & 2u) != 0u));
+        let a = view_point(ndc, depth_near);
+        let b = view_point(ndc, depth_far);
+        box_min = min(box_min, min(a, b));
+        box_max = max(box_max, max(a, b));
+    }
+
+    var count = 0u;
+    for (var i = 0u; i < params.light_count && count < MAX_LIGHTS_PER_CLUSTER; i++) {
+        let light = lights[i];
+        let center = (params.view * vec4f(light.position, 1.0)).xyz;
+        let closest = clamp(center, box_min, box_max);
+        let offset = center - closest;
+        if (dot(offset, offset) <= light.range * light.range) {
+            cluster_lights[cluster * MAX_LIGHTS_PER_CLUSTER + count] = i;
+            count++;
+        }
+    }
+    cluster_counts[cluster] = count;
+}
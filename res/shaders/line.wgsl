@@ -0,0 +1,102 @@
+struct Camera {
+    view_projection: mat4x4<f32>,
+    // World units per pixel at clip w = 1.
+    pixel_scale: f32,
+}
+
+struct LineStyle {
+    width: f32,
+    color: u32,
+    join: u32,
+    padding: u32,
+}
+
+struct VertexOut {
+    @builtin(position) position: vec4f,
+    // Along and across the segment, in world units from its start.
+    @location(0) local: vec2f,
+    @location(1) color: vec4f,
+    @location(2) @interpolate(flat) half_width: f32,
+    @location(3) @interpolate(flat) length: f32,
+}
+
+const has_previous = 0x80000000u;
+const has_next = 0x40000000u;
+const point_mask = 0x3FFFFFFFu;
+const join_round = 1u;
+// Sharper miters than this fall back to a round join.
+const miter_limit = 4.0;
+
+@group(0) @binding(0) var<uniform> camera: Camera;
+@group(0) @binding(1) var<storage, read> points: array<vec2f>;
+@group(0) @binding(2) var<storage, read> styles: array<LineStyle>;
+
+fn perpendicular(v: vec2f) -> vec2f {
+    return vec2f(-v.y, v.x);
+}
+
+// Drawn as a 4 vertex triangle strip per segment: x picks the end, y the side.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, @location(0) segment: vec2u) -> VertexOut {
+    let start = segment.x & point_mask;
+    let style = styles[segment.y];
+    let p0 = points[start];
+    let p1 = points[start + 1u];
+    let segment_length = distance(p0, p1);
+    let dir = select(vec2f(1.0, 0.0), (p1 - p0) / segment_length, segment_length > 0.0);
+    let normal = perpendicular(dir);
+
+    let at_end = (vertex_index & 1u) != 0u;
+    let side = select(-1.0, 1.0, (vertex_index & 2u) != 0u);
+    let p = select(p0, p1, at_end);
+
+    // Widen to at least one pixel and pad by one more for the anti-aliased edge.
+    let pixel = (camera.view_projection * vec4f(p, 0.0, 1.0)).w * camera.pixel_scale;
+    let half_width = max(style.width * 0.5, pixel * 0.5);
+    let extent = half_width + pixel;
+
+    let has_neighbour = (segment.x & select(has_previous, has_next, at_end)) != 0u;
+    var miter = vec2f(0.0);
+    var miter_cos = 0.0;
+    if (has_neighbour && style.join != join_round) {
+        var neighbour = points[start + 2u];
+        if (!at_end) {
+            neighbour = points[start - 1u];
+        }
+        let other_dir = normalize(select(p0 - neighbour, neighbour - p1, at_end));
+        miter = normalize(normal + perpendicular(other_dir));
+        miter_cos = dot(miter, normal);
+    }
+
+    var out: VertexOut;
+    let along_end = select(0.0, segment_length, at_end);
+    var world: vec2f;
+    if (miter_cos > 1.0 / miter_limit) {
+        // The miter point lies on the offset line of both segments, so the across
+        // distance still interpolates exactly.
+        world = p + miter * side * extent / miter_cos;
+        out.local = vec2f(along_end, side * extent);
+    } else {
+        // Round joins and caps: extend past the end and let the fragment shader cut a
+        // half circle. Open miter lines only extend by the anti-aliasing pad.
+        let cap = select(pixel, extent, has_neighbour || style.join == join_round);
+        let along = select(-cap, cap, at_end);
+        world = p + dir * along + normal * side * extent;
+        out.local = vec2f(along_end + along, side * extent);
+    }
+
+    out.position = camera.view_projection * vec4f(world, 0.0, 1.0);
+    out.color = unpack4x8unorm(style.color);
+    out.half_width = half_width;
+    out.length = segment_length;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOut) -> @location(0) vec4f {
+    // Distance to the segment, which is the distance across it except past the ends.
+    let along = in.local.x - clamp(in.local.x, 0.0, in.length);
+    let d = length(vec2f(along, in.local.y));
+    let coverage = clamp((in.half_width - d) / max(fwidth(d), 1e-5) + 0.5, 0.0, 1.0);
+    return vec4f(in.color.rgb, in.color.a * coverage);
+}
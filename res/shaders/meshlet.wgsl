@@ -0,0 +1,165 @@
+struct CullParams {
+    view: mat4x4f,
+    proj: mat4x4f,
+    view_pos: vec4f,
+    planes: array<vec4f, 6>,
+    instance_count: u32,
+    meshlet_count: u32,
+    pad0: u32,
+    pad1: u32
+}
+
+struct Instance {
+    model: mat4x4f,
+    quant_offset: vec4f,
+    quant_scale: vec4f
+}
+
+struct Meshlet {
+    center: vec3f,
+    radius: f32,
+    cone_axis: vec3f,
+    cone_cutoff: f32,
+    cone_apex: vec3f,
+    triangle_offset: u32,
+    triangle_count: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32
+}
+
+struct VertexOutput {
+    // Invariant so the depth prepass and the shading pass produce identical depth.
+    @builtin(position) @invariant position: vec4f,
+    @location(0) color: vec4f,
+    @location(1) normal: vec3f,
+    @location(2) uv: vec2f,
+    @location(3) world_pos: vec3f
+}
+
+@group(0) @binding(0) var<uniform> params: CullParams;
+@group(0) @binding(1) var<storage, read> instances: array<Instance>;
+@group(0) @binding(2) var<storage, read> meshlets: array<Meshlet>;
+@group(0) @binding(3) var<storage, read> visible: array<vec2u>;
+// tkPackedMeshVertex, six words per vertex
+@group(0) @binding(4) var<storage, read> vertices: array<u32>;
+@group(0) @binding(5) var<storage, read> indices: array<u32>;
+
+const CLUSTERS_X = 16u;
+const CLUSTERS_Y = 16u;
+const CLUSTERS_Z = 24u;
+const MAX_LIGHTS_PER_CLUSTER = 128u;
+
+struct Light {
+    position: vec3f,
+    range: f32,
+    color: vec3f,
+    intensity: f32
+}
+
+struct LightParams {
+    view: mat4x4f,
+    inv_proj: mat4x4f,
+    screen_size: vec2f,
+    near: f32,
+    far: f32,
+    light_count: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32
+}
+
+// Cluster light lists built by lightCluster.wgsl.
+@group(1) @binding(0) var<uniform> light_params: LightParams;
+@group(1) @binding(1) var<storage, read> lights: array<Light>;
+@group(1) @binding(2) var<storage, read> cluster_counts: array<u32>;
+@group(1) @binding(3) var<storage, read> cluster_lights: array<u32>;
+
+fn get_light_cluster(frag_coord: vec2f, world_pos: vec3f) -> u32 {
+    let depth = -(light_params.view * vec4f(world_pos, 1.0)).z;
+    let slice = log(max(depth, light_params.near) / light_params.near) / log(light_params.far / light_params.near);
+    let z = min(u32(slice * f32(CLUSTERS_Z)), CLUSTERS_Z - 1u);
+    let tile = vec2u(frag_coord / light_params.screen_size * vec2f(f32(CLUSTERS_X), f32(CLUSTERS_Y)));
+    let xy = min(tile, vec2u(CLUSTERS_X - 1u, CLUSTERS_Y - 1u));
+    return xy.x + xy.y * CLUSTERS_X + z * CLUSTERS_X * CLUSTERS_Y;
+}
+
+fn light_attenuation(distance: f32, range: f32) -> f32 {
+    let falloff = clamp(1.0 - pow(distance / range, 4.0), 0.0, 1.0);
+    return falloff * falloff / (distance * distance + 1.0);
+}
+
+// Split-sum image based lighting precomputed by ibl.wgsl.
+@group(2) @binding(0) var ibl_sampler: sampler;
+@group(2) @binding(1) var irradiance_texture: texture_cube<f32>;
+@group(2) @binding(2) var prefiltered_texture: texture_cube<f32>;
+@group(2) @binding(3) var brdf_lut: texture_2d<f32>;
+
+fn ibl_ambient(N: vec3f, V: vec3f, albedo: vec3f, roughness: f32, metallic: f32) -> vec3f {
+    let NdotV = max(dot(N, V), 1e-4);
+    let F0 = mix(vec3f(0.04), albedo, metallic);
+    let F = F0 + (max(vec3f(1.0 - roughness), F0) - F0) * pow(1.0 - NdotV, 5.0);
+    let kD = (1.0 - F) * (1.0 - metallic);
+    let diffuse = textureSample(irradiance_texture, ibl_sampler, N).rgb * albedo;
+    let lod = roughness * f32(textureNumLevels(prefiltered_texture) - 1u);
+    let prefiltered = textureSampleLevel(prefiltered_texture, ibl_sampler, reflect(-V, N), lod).rgb;
+    let brdf = textureSampleLevel(brdf_lut, ibl_sampler, vec2f(NdotV, roughness), 0.0).rg;
+    return kD * diffuse + prefiltered * (F0 * brdf.x + brdf.y);
+}
+
+fn oct_decode(e: vec2f) -> vec3f {
+    var n = vec3f(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.0);
+    n.x += select(t, -t, n.x >= 0.0);
+    n.y += select(t, -t, n.y >= 0.0);
+    return normalize(n);
+}
+
+// One instance per visible meshlet. Corners past the meshlet's triangle count
+// collapse to a single point and produce no fragments.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, @builtin(instance_index) instance_index: u32) -> VertexOutput {
+    var out: VertexOutput;
+    let cluster = visible[instance_index];
+    let meshlet = meshlets[cluster.y];
+    if (vertex_index / 3u >= meshlet.triangle_count) {
+        out.position = vec4f(0.0, 0.0, 0.0, 1.0);
+        return out;
+    }
+
+    let instance = instances[cluster.x];
+    let base = indices[meshlet.triangle_offset * 3u + vertex_index] * 6u;
+    let xy = unpack2x16unorm(vertices[base]);
+    let zw = unpack2x16unorm(vertices[base + 1u]);
+    let position = instance.quant_offset.xyz + vec3f(xy, zw.x) * instance.quant_scale.xyz;
+    let normal = oct_decode(unpack2x16snorm(vertices[base + 2u]));
+
+    let world = instance.model * vec4f(position, 1.0);
+    out.position = params.proj * params.view * world;
+    out.normal = normalize((instance.model * vec4f(normal, 0.0)).xyz);
+    out.color = unpack4x8unorm(vertices[base + 4u]);
+    out.uv = unpack2x16float(vertices[base + 5u]);
+    out.world_pos = world.xyz;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4f {
+    let N = normalize(in.normal);
+    let V = normalize(params.view_pos.xyz - in.world_pos);
+    let sun_dir = normalize(vec3f(0.4, 0.8, 0.6));
+    var radiance = vec3f(0.9 * max(dot(N, sun_dir), 0.0));
+
+    let cluster = get_light_cluster(in.position.xy, in.world_pos);
+    let count = cluster_counts[cluster];
+    for (var i = 0u; i < count; i++) {
+        let light = lights[cluster_lights[cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+        let to_light = light.position - in.world_pos;
+        let distance = length(to_light);
+        let NdotL = max(dot(N, to_light / max(distance, 1e-4)), 0.0);
+        radiance += light.color * light.intensity * light_attenuation(distance, light.range) * NdotL;
+    }
+    // No material inputs on this path yet, shade as a mid-rough dielectric.
+    let ambient = ibl_ambient(N, V, in.color.rgb, 0.5, 0.0);
+    return vec4f(in.color.rgb * radiance + ambient, in.color.a);
+}
@@ -0,0 +1,143 @@
+struct CullParams {
+    view: mat4x4f,
+    proj: mat4x4f,
+    view_pos: vec4f,
+    planes: array<vec4f, 6>,
+    instance_count: u32,
+    meshlet_count: u32,
+    pad0: u32,
+    pad1: u32
+}
+
+struct Instance {
+    model: mat4x4f,
+    // w: largest axis scale of the model matrix
+    quant_offset: vec4f,
+    quant_scale: vec4f
+}
+
+struct Meshlet {
+    center: vec3f,
+    radius: f32,
+    cone_axis: vec3f,
+    cone_cutoff: f32,
+    cone_apex: vec3f,
+    triangle_offset: u32,
+    triangle_count: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32
+}
+
+struct DrawIndirect {
+    vertex_count: u32,
+    instance_count: atomic<u32>,
+    first_vertex: u32,
+    first_instance: u32
+}
+
+@group(0) @binding(0) var<uniform> params: CullParams;
+@group(0) @binding(1) var<storage, read> instances: array<Instance>;
+@group(0) @binding(2) var<storage, read> meshlets: array<Meshlet>;
+@group(0) @binding(3) var<storage, read_write> early_visible: array<vec2u>;
+@group(0) @binding(4) var<storage, read_write> early_draw: DrawIndirect;
+@group(0) @binding(5) var<storage, read_write> late_visible: array<vec2u>;
+@group(0) @binding(6) var<storage, read_write> late_draw: DrawIndirect;
+// One flag per (instance, meshlet): visible at the end of last frame.
+@group(0) @binding(7) var<storage, read_write> history: array<u32>;
+@group(0) @binding(8) var hiz: texture_2d<f32>;
+
+fn get_cluster(id: vec3u, groups: vec3u) -> u32 {
+    return id.x + id.y * groups.x * 64u;
+}
+
+fn is_in_view(instance: Instance, meshlet: Meshlet) -> bool {
+    let center = (instance.model * vec4f(meshlet.center, 1.0)).xyz;
+    let radius = meshlet.radius * instance.quant_offset.w;
+    for (var i = 0u; i < 6u; i++) {
+        if (dot(params.planes[i].xyz, center) + params.planes[i].w < -radius) {
+            return false;
+        }
+    }
+
+    // Every triangle in the cluster faces away from the camera.
+    let apex = (instance.model * vec4f(meshlet.cone_apex, 1.0)).xyz;
+    let axis = normalize((instance.model * vec4f(meshlet.cone_axis, 0.0)).xyz);
+    return dot(normalize(apex - params.view_pos.xyz), axis) < meshlet.cone_cutoff;
+}
+
+// Projects the bounding box of the sphere and compares its nearest depth with the
+// farthest depth of the Hi-Z texels it covers.
+fn is_occluded(instance: Instance, meshlet: Meshlet) -> bool {
+    let center = (instance.model * vec4f(meshlet.center, 1.0)).xyz;
+    let radius = meshlet.radius * instance.quant_offset.w;
+    let view_proj = params.proj * params.view;
+
+    var lo = vec3f(1e9);
+    var hi = vec3f(-1e9);
+    for (var i = 0u; i < 8u; i++) {
+        let corner = center + radius * vec3f(select(-1.0, 1.0, (i & 1u) != 0u),
+                                             select(-1.0, 1.0, (i & 2u) != 0u),
+                                             select(-1.0, 1.0, (i & 4u) != 0u));
+        let clip = view_proj * vec4f(corner, 1.0);
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        let ndc = clip.xyz / clip.w;
+        lo = min(lo, ndc);
+        hi = max(hi, ndc);
+    }
+    if (lo.z <= 0.0) {
+        return false;
+    }
+
+    let uv_min = vec2f(lo.x, -hi.y) * 0.5 + 0.5;
+    let uv_max = vec2f(hi.x, -lo.y) * 0.5 + 0.5;
+    let extent = (uv_max - uv_min) * vec2f(textureDimensions(hiz, 0));
+    let level = min(u32(ceil(log2(max(max(extent.x, extent.y), 1.0)))), textureNumLevels(hiz) - 1u);
+
+    let size = vec2i(textureDimensions(hiz, level));
+    let p0 = clamp(vec2i(uv_min * vec2f(size)), vec2i(0), size - 1);
+    let p1 = clamp(vec2i(uv_max * vec2f(size)), vec2i(0), size - 1);
+    let depth = max(max(textureLoad(hiz, p0, level).r, textureLoad(hiz, vec2i(p1.x, p0.y), level).r),
+                    max(textureLoad(hiz, vec2i(p0.x, p1.y), level).r, textureLoad(hiz, p1, level).r));
+    return lo.z > depth;
+}
+
+// Phase one: clusters that were visible last frame are drawn to depth without an occlusion test.
+@compute @workgroup_size(64)
+fn cs_early(@builtin(global_invocation_id) id: vec3u, @builtin(num_workgroups) groups: vec3u) {
+    let index = get_cluster(id, groups);
+    if (index >= params.instance_count * params.meshlet_count || history[index] == 0u) {
+        return;
+    }
+
+    let instance_index = index / params.meshlet_count;
+    let meshlet_index = index % params.meshlet_count;
+    if (is_in_view(instances[instance_index], meshlets[meshlet_index])) {
+        let slot = atomicAdd(&early_draw.instance_count, 1u);
+        early_visible[slot] = vec2u(instance_index, meshlet_index);
+    }
+}
+
+// Phase two: every cluster is tested against the Hi-Z built from phase one. Newly
+// visible clusters are drawn, and the result becomes next frame's history.
+@compute @workgroup_size(64)
+fn cs_late(@builtin(global_invocation_id) id: vec3u, @builtin(num_workgroups) groups: vec3u) {
+    let index = get_cluster(id, groups);
+    if (index >= params.instance_count * params.meshlet_count) {
+        return;
+    }
+
+    let instance_index = index / params.meshlet_count;
+    let meshlet_index = index % params.meshlet_count;
+    let instance = instances[instance_index];
+    let meshlet = meshlets[meshlet_index];
+    let visible = is_in_view(instance, meshlet) && !is_occluded(instance, meshlet);
+
+    if (visible && history[index] == 0u) {
+        let slot = atomicAdd(&late_draw.instance_count, 1u);
+        late_visible[slot] = vec2u(instance_index, meshlet_index);
+    }
+    history[index] = u32(visible);
+}
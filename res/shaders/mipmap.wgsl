@@ -0,0 +1,78 @@
+// Single pass 2x2 box downsampler after AMD's SPD. Each workgroup reduces a 64x64 tile
+// of the source mip through workgroup memory into up to four successive mips, so
+// a chain of N mips takes ceil(N / 4) dispatches instead of N. Four outputs is the
+// default maxStorageTexturesPerShaderStage. tkMipGenerator swaps the storage format
+// for each texture format it supports.
+
+// Number of outputs written by this pipeline, 1 to 4. Unused outputs are bound to a dummy.
+override mip_count: u32 = 4u;
+
+@group(0) @binding(0) var source: texture_2d<f32>;
+@group(0) @binding(1) var mip1: texture_storage_2d<rgba8unorm, write>;
+@group(0) @binding(2) var mip2: texture_storage_2d<rgba8unorm, write>;
+@group(0) @binding(3) var mip3: texture_storage_2d<rgba8unorm, write>;
+@group(0) @binding(4) var mip4: texture_storage_2d<rgba8unorm, write>;
+
+var<workgroup> tile: array<vec4f, 256>;
+
+fn load_source(p: vec2u) -> vec4f {
+    return textureLoad(source, min(p, textureDimensions(source) - 1u), 0);
+}
+
+fn reduce_tile(p: vec2u) -> vec4f {
+    let i = p.y * 16u + p.x;
+    return (tile[i] + tile[i + 1u] + tile[i + 16u] + tile[i + 17u]) * 0.25;
+}
+
+@compute @workgroup_size(16, 16, 1)
+fn cs_main(@builtin(workgroup_id) group: vec3u, @builtin(local_invocation_id) local: vec3u,
+           @builtin(local_invocation_index) index: u32) {
+    // Every thread reduces a 4x4 source block into 2x2 texels of mip 1 and one of mip 2.
+    let coord2 = group.xy * 16u + local.xy;
+    var sum = vec4f(0.0);
+    for (var y = 0u; y < 2u; y++) {
+        for (var x = 0u; x < 2u; x++) {
+            let coord1 = coord2 * 2u + vec2u(x, y);
+            let s = coord1 * 2u;
+            let value = (load_source(s) + load_source(s + vec2u(1u, 0u)) +
+                         load_source(s + vec2u(0u, 1u)) + load_source(s + vec2u(1u, 1u))) * 0.25;
+            if (all(coord1 < textureDimensions(mip1))) {
+                textureStore(mip1, coord1, value);
+            }
+            sum += value;
+        }
+    }
+    if (mip_count < 2u) {
+        return;
+    }
+
+    var value = sum * 0.25;
+    if (all(coord2 < textureDimensions(mip2))) {
+        textureStore(mip2, coord2, value);
+    }
+    tile[index] = value;
+    workgroupBarrier();
+
+    // 8x8 threads produce mip 3, then 4x4 of them mip 4.
+    let active3 = all(local.xy < vec2u(8u));
+    if (active3) {
+        value = reduce_tile(local.xy * 2u);
+        let coord3 = group.xy * 8u + local.xy;
+        if (mip_count >= 3u && all(coord3 < textureDimensions(mip3))) {
+            textureStore(mip3, coord3, value);
+        }
+    }
+    workgroupBarrier();
+    if (active3) {
+        tile[local.y * 16u + local.x] = value;
+    }
+    workgroupBarrier();
+
+    if (all(local.xy < vec2u(4u))) {
+        value = reduce_tile(local.xy * 2u);
+        let coord4 = group.xy * 4u + local.xy;
+        if (mip_count >= 4u && all(coord4 < textureDimensions(mip4))) {
+            textureStore(mip4, coord4, value);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+// Must match Params and Particle in particles.wgsl.
+struct Params {
+    view_projection: mat4x4<f32>,
+    delta_time: f32,
+    seed: u32,
+    emit_total: u32,
+    emitter_count: u32,
+    current: u32,
+    sort_size: u32,
+    max_particles: u32,
+    sorted: u32,
+}
+
+struct Particle {
+    position: vec2f,
+    velocity: vec2f,
+    gravity: vec2f,
+    age: f32,
+    lifetime: f32,
+    start_size: f32,
+    end_size: f32,
+    start_color: u32,
+    end_color: u32,
+}
+
+struct VertexOut {
+    @builtin(position) position: vec4f,
+    @location(0) local: vec2f,
+    @location(1) color: vec4f,
+}
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read> particles: array<Particle>;
+@group(0) @binding(2) var<storage, read> alive: array<u32>;
+@group(0) @binding(3) var<storage, read> sort_pairs: array<vec2u>;
+
+// Drawn as a 4 vertex triangle strip per live particle.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, @builtin(instance_index) instance: u32) -> VertexOut {
+    var index: u32;
+    if (params.sorted != 0u) {
+        index = sort_pairs[instance].y;
+    } else {
+        index = alive[(1u - params.current) * params.max_particles + instance];
+    }
+    let particle = particles[index];
+
+    let t = clamp(particle.age / particle.lifetime, 0.0, 1.0);
+    let size = mix(particle.start_size, particle.end_size, t);
+    let corner = vec2f(f32(vertex_index & 1u), f32(vertex_index >> 1u)) * 2.0 - 1.0;
+
+    var out: VertexOut;
+    out.position = params.view_projection * vec4f(particle.position + corner * size * 0.5, 0.0, 1.0);
+    out.local = corner;
+    out.color = mix(unpack4x8unorm(particle.start_color), unpack4x8unorm(particle.end_color), t);
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOut) -> @location(0) vec4f {
+    // Soft round sprite.
+    let falloff = 1.0 - smoothstep(0.5, 1.0, length(in.local));
+    return vec4f(in.color.rgb, in.color.a * falloff);
+}
@@ -0,0 +1,271 @@
+struct Params {
+    view_projection: mat4x4<f32>,
+    delta_time: f32,
+    seed: u32,
+    emit_total: u32,
+    emitter_count: u32,
+    // Alive list this frame's emission appends to; survivors go to the other one.
+    current: u32,
+    sort_size: u32,
+    max_particles: u32,
+    sorted: u32,
+}
+
+struct SortStep {
+    k: u32,
+    j: u32,
+}
+
+struct Emitter {
+    position: vec2f,
+    velocity: vec2f,
+    gravity: vec2f,
+    spread: f32,
+    speed_jitter: f32,
+    lifetime: f32,
+    start_size: f32,
+    end_size: f32,
+    // Index of this emitter's first particle among the frame's emissions.
+    first: u32,
+    start_color: u32,
+    end_color: u32,
+    padding: vec2u,
+}
+
+struct Particle {
+    position: vec2f,
+    velocity: vec2f,
+    gravity: vec2f,
+    age: f32,
+    lifetime: f32,
+    start_size: f32,
+    end_size: f32,
+    start_color: u32,
+    end_color: u32,
+}
+
+struct Counters {
+    dead: atomic<u32>,
+    emit: atomic<u32>,
+    alive: array<atomic<u32>, 2>,
+}
+
+const workgroup_size = 64u;
+const sort_workgroup_size = 256u;
+const sort_block_size = 512u;
+const sort_sentinel = 0xFFFFFFFFu;
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read_write> particles: array<Particle>;
+@group(0) @binding(2) var<storage, read_write> dead: array<u32>;
+@group(0) @binding(3) var<storage, read_write> alive: array<u32>;
+@group(0) @binding(4) var<storage, read_write> counters: Counters;
+@group(0) @binding(5) var<storage, read> emitters: array<Emitter>;
+@group(0) @binding(6) var<storage, read_write> sort_pairs: array<vec2u>;
+
+// Only bound for the single thread passes, so the indirect dispatch that reads it
+// never sees it bound as writable storage.
+@group(1) @binding(0) var<storage, read_write> indirect: array<u32>;
+
+@group(1) @binding(0) var<uniform> sort_step: SortStep;
+
+fn hash(x: u32) -> u32 {
+    var h = x;
+    h ^= h >> 16u;
+    h *= 0x7feb352du;
+    h ^= h >> 15u;
+    h *= 0x846ca68bu;
+    h ^= h >> 16u;
+    return h;
+}
+
+fn random(seed: u32) -> f32 {
+    return f32(hash(seed) >> 8u) / 16777216.0;
+}
+
+fn alive_offset(list: u32) -> u32 {
+    return list * params.max_particles;
+}
+
+@compute @workgroup_size(1)
+fn cs_begin() {
+    atomicStore(&counters.emit, min(params.emit_total, atomicLoad(&counters.dead)));
+    atomicStore(&counters.alive[1u - params.current], 0u);
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_emit(@builtin(global_invocation_id) id: vec3u) {
+    let i = id.x;
+    if (i >= atomicLoad(&counters.emit)) {
+        return;
+    }
+
+    // Emitters are ordered by first, find the last one starting at or before i.
+    var lo = 0u;
+    var hi = params.emitter_count;
+    while (hi - lo > 1u) {
+        let mid = (lo + hi) / 2u;
+        if (emitters[mid].first <= i) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    let emitter = emitters[lo];
+
+    // cs_begin clamped the emission to the dead count, so this never underflows.
+    let index = dead[atomicSub(&counters.dead, 1u) - 1u];
+
+    let seed = hash(i ^ params.seed);
+    let base_speed = length(emitter.velocity);
+    let base_angle = select(0.0, atan2(emitter.velocity.y, emitter.velocity.x), base_speed > 0.0);
+    let angle = base_angle + (random(seed) * 2.0 - 1.0) * emitter.spread;
+    let speed = base_speed * (1.0 + (random(seed + 1u) * 2.0 - 1.0) * emitter.speed_jitter);
+
+    particles[index] = Particle(
+        emitter.position,
+        vec2f(cos(angle), sin(angle)) * speed,
+        emitter.gravity,
+        0.0,
+        emitter.lifetime,
+        emitter.start_size,
+        emitter.end_size,
+        emitter.start_color,
+        emitter.end_color,
+    );
+    alive[alive_offset(params.current) + atomicAdd(&counters.alive[params.current], 1u)] = index;
+}
+
+@compute @workgroup_size(1)
+fn cs_prepare() {
+    let count = atomicLoad(&counters.alive[params.current]);
+    indirect[0] = (count + workgroup_size - 1u) / workgroup_size;
+    indirect[1] = 1u;
+    indirect[2] = 1u;
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_simulate(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x >= atomicLoad(&counters.alive[params.current])) {
+        return;
+    }
+
+    let index = alive[alive_offset(params.current) + id.x];
+    var particle = particles[index];
+    particle.age += params.delta_time;
+    if (particle.age >= particle.lifetime) {
+        dead[atomicAdd(&counters.dead, 1u)] = index;
+        return;
+    }
+
+    particle.velocity += particle.gravity * params.delta_time;
+    particle.position += particle.velocity * params.delta_time;
+    particles[index] = particle;
+
+    // Survivors are compacted into the other list, which the renderer draws.
+    let next = 1u - params.current;
+    alive[alive_offset(next) + atomicAdd(&counters.alive[next], 1u)] = index;
+}
+
+@compute @workgroup_size(1)
+fn cs_finalize() {
+    var count = atomicLoad(&counters.alive[1u - params.current]);
+    if (params.sorted != 0u) {
+        count = min(count, params.sort_size);
+    }
+    indirect[4] = 4u;
+    indirect[5] = count;
+    indirect[6] = 0u;
+    indirect[7] = 0u;
+}
+
+// Back to front: the key is the inverted clip w, so an ascending sort puts the
+// farthest particle first and the padding sentinels last.
+@compute @workgroup_size(sort_workgroup_size)
+fn cs_sort_keys(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x >= params.sort_size) {
+        return;
+    }
+
+    let next = 1u - params.current;
+    if (id.x >= atomicLoad(&counters.alive[next])) {
+        sort_pairs[id.x] = vec2u(sort_sentinel, 0u);
+        return;
+    }
+
+    let index = alive[alive_offset(next) + id.x];
+    let w = (params.view_projection * vec4f(particles[index].position, 0.0, 1.0)).w;
+    sort_pairs[id.x] = vec2u(~bitcast<u32>(max(w, 0.0)), index);
+}
+
+var<workgroup> sort_block: array<vec2u, sort_block_size>;
+
+fn sort_block_steps(block_start: u32, local: u32, k_first: u32, k_last: u32, j_first: u32) {
+    var k = k_first;
+    var j = j_first;
+    loop {
+        if (k > k_last) {
+            break;
+        }
+        loop {
+            if (j == 0u) {
+                break;
+            }
+            let lo = (local / j) * 2u * j + local % j;
+            let hi = lo + j;
+            let ascending = ((block_start + lo) & k) == 0u;
+            let a = sort_block[lo];
+            let b = sort_block[hi];
+            if ((a.x > b.x) == ascending) {
+                sort_block[lo] = b;
+                sort_block[hi] = a;
+            }
+            workgroupBarrier();
+            j = j / 2u;
+        }
+        k = k * 2u;
+        j = k / 2u;
+    }
+}
+
+// Sorts every 512 element block completely, alternating direction between blocks.
+@compute @workgroup_size(sort_workgroup_size)
+fn cs_sort_local(@builtin(workgroup_id) group: vec3u, @builtin(local_invocation_index) local: u32) {
+    let block_start = group.x * sort_block_size;
+    sort_block[local] = sort_pairs[block_start + local];
+    sort_block[local + sort_workgroup_size] = sort_pairs[block_start + local + sort_workgroup_size];
+    workgroupBarrier();
+    sort_block_steps(block_start, local, 2u, sort_block_size, 1u);
+    sort_pairs[block_start + local] = sort_block[local];
+    sort_pairs[block_start + local + sort_workgroup_size] = sort_block[local + sort_workgroup_size];
+}
+
+// One bitonic step with a stride of at least a block.
+@compute @workgroup_size(sort_workgroup_size)
+fn cs_sort_global(@builtin(global_invocation_id) id: vec3u) {
+    let j = sort_step.j;
+    let lo = (id.x / j) * 2u * j + id.x % j;
+    let hi = lo + j;
+    if (hi >= params.sort_size) {
+        return;
+    }
+    let ascending = (lo & sort_step.k) == 0u;
+    let a = sort_pairs[lo];
+    let b = sort_pairs[hi];
+    if ((a.x > b.x) == ascending) {
+        sort_pairs[lo] = b;
+        sort_pairs[hi] = a;
+    }
+}
+
+// Finishes the strides below a block for stage k in workgroup memory.
+@compute @workgroup_size(sort_workgroup_size)
+fn cs_sort_merge(@builtin(workgroup_id) group: vec3u, @builtin(local_invocation_index) local: u32) {
+    let block_start = group.x * sort_block_size;
+    sort_block[local] = sort_pairs[block_start + local];
+    sort_block[local + sort_workgroup_size] = sort_pairs[block_start + local + sort_workgroup_size];
+    workgroupBarrier();
+    sort_block_steps(block_start, local, sort_step.k, sort_step.k, sort_block_size / 2u);
+    sort_pairs[block_start + local] = sort_block[local];
+    sort_pairs[block_start + local + sort_workgroup_size] = sort_block[local + sort_workgroup_size];
+}
@@ -1,10 +1,10 @@
 struct VertexInput {
-	@location(0) position: vec3f,
-    @location(1) normal: vec3f,
-    @location(2) tangent: vec3f,
-    @location(3) bitangent: vec3f,
-	@location(4) color: vec4f,
-    @location(5) uv: vec2f
+    // xyz: unorm16 within the mesh bounds, w: tangent handedness
+	@location(0) position: vec4f,
+    @location(1) normal: vec2f,
+    @location(2) tangent: vec2f,
+	@location(3) color: vec4f,
+    @location(4) uv: vec2f
 }
 
 struct VertexOutput {
@@ -25,7 +25,9 @@ struct MyUniforms {
     view : mat4x4<f32>,
     proj : mat4x4<f32>,
     view_pos: vec3f,
-    pad : f32
+    pad : f32,
+    quant_offset: vec4f,
+    quant_scale: vec4f
 }
 
 @group(0) @binding(0) var<uniform> u_uniforms: MyUniforms;
@@ -36,20 +38,49 @@ struct MyUniforms {
 @group(0) @binding(4) var roughness_texture: texture_2d<f32>;
 @group(0) @binding(5) var metallic_texture: texture_2d<f32>;
 
-@group(0) @binding(6) var irradiance_texture: texture_cube<f32>;
-
 const PI = 3.14159265359;
 
+// Split-sum image based lighting precomputed by ibl.wgsl.
+@group(2) @binding(0) var ibl_sampler: sampler;
+@group(2) @binding(1) var irradiance_texture: texture_cube<f32>;
+@group(2) @binding(2) var prefiltered_texture: texture_cube<f32>;
+@group(2) @binding(3) var brdf_lut: texture_2d<f32>;
+
+fn ibl_ambient(N: vec3f, V: vec3f, albedo: vec3f, roughness: f32, metallic: f32) -> vec3f {
+    let NdotV = max(dot(N, V), 1e-4);
+    let F0 = mix(vec3f(0.04), albedo, metallic);
+    let F = F0 + (max(vec3f(1.0 - roughness), F0) - F0) * pow(1.0 - NdotV, 5.0);
+    let kD = (1.0 - F) * (1.0 - metallic);
+    let diffuse = textureSample(irradiance_texture, ibl_sampler, N).rgb * albedo;
+    let lod = roughness * f32(textureNumLevels(prefiltered_texture) - 1u);
+    let prefiltered = textureSampleLevel(prefiltered_texture, ibl_sampler, reflect(-V, N), lod).rgb;
+    let brdf = textureSampleLevel(brdf_lut, ibl_sampler, vec2f(NdotV, roughness), 0.0).rg;
+    return kD * diffuse + prefiltered * (F0 * brdf.x + brdf.y);
+}
+
+fn oct_decode(e: vec2f) -> vec3f {
+    var n = vec3f(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    let t = max(-n.z, 0.0);
+    n.x += select(t, -t, n.x >= 0.0);
+    n.y += select(t, -t, n.y >= 0.0);
+    return normalize(n);
+}
+
 @vertex
 fn vs_main(in: VertexInput) -> VertexOutput {
     var out: VertexOutput;
-    out.position = u_uniforms.proj * u_uniforms.view * u_uniforms.model * vec4f(in.position, 1.0);
+    let position = u_uniforms.quant_offset.xyz + in.position.xyz * u_uniforms.quant_scale.xyz;
+    let normal = oct_decode(in.normal);
+    let tangent = oct_decode(in.tangent);
+    let bitangent = cross(normal, tangent) * (in.position.w * 2.0 - 1.0);
 
-    let worldPosition = u_uniforms.model * vec4f(in.position, 1.0);
+    out.position = u_uniforms.proj * u_uniforms.view * u_uniforms.model * vec4f(position, 1.0);
 
-    let T = normalize((u_uniforms.model * vec4f(in.tangent, 0.0)).xyz);
-    let B = normalize((u_uniforms.model * vec4f(in.bitangent, 0.0)).xyz);
-    let N = normalize((u_uniforms.model * vec4f(in.normal, 0.0)).xyz);
+    let worldPosition = u_uniforms.model * vec4f(position, 1.0);
+
+    let T = normalize((u_uniforms.model * vec4f(tangent, 0.0)).xyz);
+    let B = normalize((u_uniforms.model * vec4f(bitangent, 0.0)).xyz);
+    let N = normalize((u_uniforms.model * vec4f(normal, 0.0)).xyz);
 
     out.tangent = T;
     out.bitangent = B;
@@ -58,7 +89,7 @@ fn vs_main(in: VertexInput) -> VertexOutput {
     out.uv = in.uv;
     out.color = in.color;
     out.view_pos = u_uniforms.view_pos;
-    out.frag_pos = (u_uniforms.model * vec4f(in.position, 1.0)).xyz;
+    out.frag_pos = worldPosition.xyz;
     out.padding = u_uniforms.pad;
     out.view_dir = out.view_pos - worldPosition.xyz;
     return out;
@@ -155,10 +186,6 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
     let view_dir = normalize(in.view_dir * vec3f(1.0, 1.0, 1.0));
     let V = normalize(in.view_pos - frag_pos);
 
-    let ibl_direction = -reflect(view_dir, N);
-    let bias = mix(0.0, 10.0, roughness);
-    let irradiance = textureSampleBias(irradiance_texture, texture_sampler, ibl_direction, bias).rgb;
-
     var F0 = vec3f(0.04);
     F0 = mix(F0, albedo, metalic);
 
@@ -191,11 +218,11 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
         Lo += (kD * albedo / PI + specular) * radiance * NdotL;
     }
 
-    let ambient = vec3f(0.03) * albedo;
+    let ambient = ibl_ambient(N, V, albedo, roughness, metalic);
     var color = ambient + Lo;
 
     color = color / (color + vec3f(1.0));
     color = pow(color, vec3f(1.0 / 2.2));
 
-    return vec4f(irradiance, 1.0);
+    return vec4f(color, 1.0);
 }
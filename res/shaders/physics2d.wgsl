@@ -0,0 +1,222 @@
+struct Params {
+    view_projection: mat4x4<f32>,
+    gravity: vec2f,
+    // At least the largest body diameter, so contacts are always within the 3x3 neighbourhood.
+    cell_size: f32,
+    restitution: f32,
+    body_count: u32,
+    // Power of two, a multiple of the scan block size.
+    cell_count: u32,
+    readback_count: u32,
+    padding: u32,
+}
+
+struct Body {
+    position: vec2f,
+    velocity: vec2f,
+    // Zero for a free slot.
+    radius: f32,
+    // Zero for a body that is never pushed by collisions.
+    inv_mass: f32,
+    angle: f32,
+    angular_velocity: f32,
+    color: u32,
+    padding: u32,
+}
+
+const workgroup_size = 256u;
+const invalid_cell = 0xFFFFFFFFu;
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read> bodies_in: array<Body>;
+@group(0) @binding(2) var<storage, read_write> bodies_out: array<Body>;
+// Hashed cell and the body's offset within it.
+@group(0) @binding(3) var<storage, read_write> body_cells: array<vec2u>;
+@group(0) @binding(4) var<storage, read_write> cell_counts: array<atomic<u32>>;
+@group(0) @binding(5) var<storage, read_write> cell_starts: array<u32>;
+@group(0) @binding(6) var<storage, read_write> block_sums: array<u32>;
+// Body indices ordered by cell.
+@group(0) @binding(7) var<storage, read_write> sorted: array<u32>;
+
+@group(1) @binding(0) var<storage, read> readback_slots: array<u32>;
+@group(1) @binding(1) var<storage, read_write> readback_bodies: array<Body>;
+
+var<workgroup> scan: array<u32, workgroup_size>;
+var<workgroup> scan_carry: u32;
+
+fn cell_of(position: vec2f) -> vec2i {
+    return vec2i(floor(position / params.cell_size));
+}
+
+// Unbounded worlds share a fixed table, distant cells may collide in it.
+fn cell_hash(cell: vec2i) -> u32 {
+    return ((u32(cell.x) * 73856093u) ^ (u32(cell.y) * 19349663u)) & (params.cell_count - 1u);
+}
+
+// Inclusive Hillis-Steele scan of scan[] across the workgroup.
+fn scan_workgroup(local: u32) {
+    for (var offset = 1u; offset < workgroup_size; offset *= 2u) {
+        var value = scan[local];
+        if (local >= offset) {
+            value += scan[local - offset];
+        }
+        workgroupBarrier();
+        scan[local] = value;
+        workgroupBarrier();
+    }
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_clear(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x < params.cell_count) {
+        atomicStore(&cell_counts[id.x], 0u);
+    }
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_count(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x >= params.body_count) {
+        return;
+    }
+
+    let body = bodies_in[id.x];
+    if (body.radius <= 0.0) {
+        body_cells[id.x] = vec2u(invalid_cell, 0u);
+        return;
+    }
+    let cell = cell_hash(cell_of(body.position));
+    body_cells[id.x] = vec2u(cell, atomicAdd(&cell_counts[cell], 1u));
+}
+
+// Exclusive prefix sum of the cell counts within each block, block totals go to block_sums.
+@compute @workgroup_size(workgroup_size)
+fn cs_scan_local(@builtin(global_invocation_id) id: vec3u, @builtin(workgroup_id) group: vec3u,
+                 @builtin(local_invocation_index) local: u32) {
+    let count = atomicLoad(&cell_counts[id.x]);
+    scan[local] = count;
+    workgroupBarrier();
+    scan_workgroup(local);
+    cell_starts[id.x] = scan[local] - count;
+    if (local == workgroup_size - 1u) {
+        block_sums[group.x] = scan[local];
+    }
+}
+
+// Single workgroup exclusive scan over the block totals.
+@compute @workgroup_size(workgroup_size)
+fn cs_scan_blocks(@builtin(local_invocation_index) local: u32) {
+    let block_count = params.cell_count / workgroup_size;
+    if (local == 0u) {
+        scan_carry = 0u;
+    }
+    for (var base = 0u; base < block_count; base += workgroup_size) {
+        var count = 0u;
+        if (base + local < block_count) {
+            count = block_sums[base + local];
+        }
+        scan[local] = count;
+        workgroupBarrier();
+        scan_workgroup(local);
+        if (base + local < block_count) {
+            block_sums[base + local] = scan_carry + scan[local] - count;
+        }
+        workgroupBarrier();
+        if (local == workgroup_size - 1u) {
+            scan_carry += scan[local];
+        }
+        workgroupBarrier();
+    }
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_scan_add(@builtin(global_invocation_id) id: vec3u, @builtin(workgroup_id) group: vec3u) {
+    cell_starts[id.x] += block_sums[group.x];
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_scatter(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x >= params.body_count) {
+        return;
+    }
+
+    let cell = body_cells[id.x];
+    if (cell.x != invalid_cell) {
+        sorted[cell_starts[cell.x] + cell.y] = id.x;
+    }
+}
+
+// Each body resolves its own side of every contact from last step's state, so the
+// pass needs no synchronisation between bodies.
+@compute @workgroup_size(workgroup_size)
+fn cs_collide(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x >= params.body_count) {
+        return;
+    }
+
+    var body = bodies_in[id.x];
+    if (body.radius <= 0.0) {
+        bodies_out[id.x] = body;
+        return;
+    }
+
+    var correction = vec2f(0.0);
+    var impulse = vec2f(0.0);
+    let center = cell_of(body.position);
+    var visited: array<u32, 9>;
+    var visited_count = 0u;
+    for (var y = -1; y <= 1; y++) {
+        for (var x = -1; x <= 1; x++) {
+            let cell = cell_hash(center + vec2i(x, y));
+            // Neighbours can hash to the same bucket, visit it once.
+            var seen = false;
+            for (var i = 0u; i < visited_count; i++) {
+                seen = seen || visited[i] == cell;
+            }
+            if (seen) {
+                continue;
+            }
+            visited[visited_count] = cell;
+            visited_count++;
+
+            let start = cell_starts[cell];
+            let end = start + atomicLoad(&cell_counts[cell]);
+            for (var i = start; i < end; i++) {
+                let other_index = sorted[i];
+                if (other_index == id.x) {
+                    continue;
+                }
+                let other = bodies_in[other_index];
+                let delta = body.position - other.position;
+                let distance_sq = dot(delta, delta);
+                let reach = body.radius + other.radius;
+                let mass_sum = body.inv_mass + other.inv_mass;
+                if (distance_sq >= reach * reach || distance_sq <= 0.0 || mass_sum <= 0.0) {
+                    continue;
+                }
+
+                let distance = sqrt(distance_sq);
+                let normal = delta / distance;
+                let share = body.inv_mass / mass_sum;
+                correction += normal * (reach - distance) * share;
+                let approach = dot(body.velocity - other.velocity, normal);
+                if (approach < 0.0) {
+                    impulse -= normal * (1.0 + params.restitution) * approach * share;
+                }
+            }
+        }
+    }
+
+    if (body.inv_mass > 0.0) {
+        body.velocity += impulse + params.gravity;
+    }
+    body.position += correction + body.velocity;
+    body.angle += body.angular_velocity;
+    bodies_out[id.x] = body;
+}
+
+@compute @workgroup_size(workgroup_size)
+fn cs_gather(@builtin(global_invocation_id) id: vec3u) {
+    if (id.x < params.readback_count) {
+        readback_bodies[id.x] = bodies_out[readback_slots[id.x]];
+    }
+}
@@ -0,0 +1,54 @@
+// Must match Params and Body in physics2d.wgsl.
+struct Params {
+    view_projection: mat4x4<f32>,
+    gravity: vec2f,
+    cell_size: f32,
+    restitution: f32,
+    body_count: u32,
+    cell_count: u32,
+    readback_count: u32,
+    padding: u32,
+}
+
+struct Body {
+    position: vec2f,
+    velocity: vec2f,
+    radius: f32,
+    inv_mass: f32,
+    angle: f32,
+    angular_velocity: f32,
+    color: u32,
+    padding: u32,
+}
+
+struct VertexOut {
+    @builtin(position) position: vec4f,
+    @location(0) local: vec2f,
+    @location(1) color: vec4f,
+}
+
+@group(0) @binding(0) var<uniform> params: Params;
+@group(0) @binding(1) var<storage, read> bodies: array<Body>;
+
+// Drawn as a 4 vertex triangle strip per body slot, free slots collapse to nothing.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, @builtin(instance_index) instance: u32) -> VertexOut {
+    let body = bodies[instance];
+    let corner = vec2f(f32(vertex_index & 1u), f32(vertex_index >> 1u)) * 2.0 - 1.0;
+
+    var out: VertexOut;
+    out.position = params.view_projection * vec4f(body.position + corner * max(body.radius, 0.0), 0.0, 1.0);
+    out.local = corner;
+    out.color = unpack4x8unorm(body.color);
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOut) -> @location(0) vec4f {
+    let distance = length(in.local);
+    let coverage = 1.0 - smoothstep(1.0 - fwidth(distance), 1.0, distance);
+    if (coverage <= 0.0) {
+        discard;
+    }
+    return vec4f(in.color.rgb, in.color.a * coverage);
+}
@@ -0,0 +1,52 @@
+struct Camera {
+    view_projection: mat4x4<f32>,
+}
+
+// Must match tcTransform2d.
+struct Transform2d {
+    position: vec2f,
+    angle: f32,
+    scale: f32,
+}
+
+struct Instance {
+    @location(0) transform: u32,
+    @location(1) color: vec4f,
+    @location(2) size: vec2f,
+    // xy is the top left uv, zw the bottom right.
+    @location(3) uv: vec4f,
+}
+
+struct VertexOut {
+    @builtin(position) position: vec4f,
+    @location(0) uv: vec2f,
+    @location(1) color: vec4f,
+}
+
+@group(0) @binding(0) var<uniform> camera: Camera;
+@group(0) @binding(1) var atlas_sampler: sampler;
+@group(0) @binding(2) var atlas: texture_2d<f32>;
+@group(0) @binding(3) var<storage, read> transforms: array<Transform2d>;
+
+// Drawn as a 4 vertex triangle strip per instance.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, instance: Instance) -> VertexOut {
+    let transform = transforms[instance.transform];
+    let corner = vec2f(f32(vertex_index & 1u), f32(vertex_index >> 1u));
+    let local = (corner - 0.5) * instance.size * transform.scale;
+    let c = cos(transform.angle);
+    let s = sin(transform.angle);
+    let world = transform.position + vec2f(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    var out: VertexOut;
+    out.position = camera.view_projection * vec4f(world, 0.0, 1.0);
+    // Image rows run top to bottom, world y runs up.
+    out.uv = mix(instance.uv.xw, instance.uv.zy, corner);
+    out.color = instance.color;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOut) -> @location(0) vec4f {
+    return textureSample(atlas, atlas_sampler, in.uv) * in.color;
+}
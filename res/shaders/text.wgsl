@@ -0,0 +1,51 @@
+struct Camera {
+    world: mat4x4<f32>,
+    screen: mat4x4<f32>,
+}
+
+struct Instance {
+    @location(0) position: vec2f,
+    @location(1) size: vec2f,
+    @location(2) color: vec4f,
+    @location(3) screen: u32,
+    // xy is the top left uv, zw the bottom right.
+    @location(4) uv: vec4f,
+}
+
+struct VertexOut {
+    @builtin(position) position: vec4f,
+    @location(0) uv: vec2f,
+    @location(1) color: vec4f,
+}
+
+@group(0) @binding(0) var<uniform> camera: Camera;
+@group(0) @binding(1) var glyph_sampler: sampler;
+@group(0) @binding(2) var glyph_atlas: texture_2d<f32>;
+
+// Drawn as a 4 vertex triangle strip per glyph.
+@vertex
+fn vs_main(@builtin(vertex_index) vertex_index: u32, instance: Instance) -> VertexOut {
+    let corner = vec2f(f32(vertex_index & 1u), f32(vertex_index >> 1u));
+    let position = vec4f(instance.position + corner * instance.size, 0.0, 1.0);
+
+    var out: VertexOut;
+    if (instance.screen != 0u) {
+        // Overlay text always passes the depth test.
+        out.position = camera.screen * position;
+        out.position.z = 0.0;
+    } else {
+        out.position = camera.world * position;
+    }
+    out.uv = mix(instance.uv.xw, instance.uv.zy, corner);
+    out.color = instance.color;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOut) -> @location(0) vec4f {
+    // 0.5 is the outline. Smoothing over one screen pixel keeps edges sharp at any scale.
+    let distance = textureSample(glyph_atlas, glyph_sampler, in.uv).r;
+    let width = max(fwidth(distance) * 0.5, 1e-4);
+    let alpha = smoothstep(0.5 - width, 0.5 + width, distance);
+    return vec4f(in.color.rgb, in.color.a * alpha);
+}
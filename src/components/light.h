@@ -0,0 +1,15 @@
+#ifndef TC_LIGHT_H
+#define TC_LIGHT_H
+
+#include "../core/component.h"
+#include "../core/def.h"
+
+// Point light placed by the entity's tcTransform3d.
+struct tcPointLight : tkComponent
+{
+  v3 Color = v3(1.f);
+  f32 Intensity = 1.f;
+  f32 Range = 10.f;
+};
+
+#endif //TC_LIGHT_H
@@ -0,0 +1,12 @@
+#ifndef TC_MESH_H
+#define TC_MESH_H
+
+#include "../core/component.h"
+#include "../core/assets.h"
+
+struct tcMesh : tkComponent
+{
+  tkHandle<tkMeshAsset> Mesh;
+};
+
+#endif //TC_MESH_H
@@ -0,0 +1,30 @@
+#ifndef TC_PARTICLES_H
+#define TC_PARTICLES_H
+
+#include "../core/component.h"
+#include "../core/def.h"
+
+// Spawns GPU particles at the entity's tcTransform2d position. Rates, speeds and
+// lifetimes are per second.
+struct tcParticleEmitter : tkComponent
+{
+  f32 Rate = 100.f;
+  // Spawned once on the next frame, then reset, e.g. for explosions.
+  u32 Burst = 0;
+  f32 Lifetime = 1.f;
+  // Mean launch velocity; each particle is rotated by up to Spread radians and its
+  // speed scaled by up to 1 +- SpeedJitter.
+  v2 Velocity = v2(0.f, 1.f);
+  f32 Spread = 0.5f;
+  f32 SpeedJitter = 0.2f;
+  v2 Gravity = v2(0.f);
+  f32 StartSize = 0.5f;
+  f32 EndSize = 0.f;
+  v4 StartColor = v4(1.f);
+  v4 EndColor = v4(1.f, 1.f, 1.f, 0.f);
+
+  // Fractional particles carried over between frames.
+  f32 Accumulator = 0.f;
+};
+
+#endif //TC_PARTICLES_H
@@ -1,6 +1,7 @@
 #ifndef TK_PHYSICS2D_H
 #define TK_PHYSICS2D_H
 
+#include "../core/component.h"
 #include "../core/def.h"
 
 struct tcPhysics2d
@@ -9,4 +10,24 @@ struct tcPhysics2d
   f32 AngularVelocity = 0.f;
 };
 
+const u32 kInvalidGpuBody = ~0u;
+
+// Moves a tcPhysics2d body to tsPhysics2dGpu. The initial tcTransform2d and tcPhysics2d
+// are uploaded once, after that the body's state only lives on the GPU.
+struct tcGpuBody2d : tkComponent
+{
+  f32 Radius = 0.5f;
+  // Zero makes the body immovable by collisions.
+  f32 Mass = 1.f;
+  v4 Color = v4(1.f);
+  // Slot in the GPU body buffer, assigned by tsPhysics2dGpu.
+  u32 Body = kInvalidGpuBody;
+};
+
+// Copies a GPU body's state back into its tcTransform2d and tcPhysics2d every frame,
+// a few frames late. Only add it where gameplay needs to query the body.
+struct tcGpuBodyReadback : tkComponent
+{
+};
+
 #endif //TK_PHYSICS2D_H
@@ -0,0 +1,15 @@
+#ifndef TC_SPRITE_H
+#define TC_SPRITE_H
+
+#include "../core/component.h"
+#include "../core/atlas.h"
+
+// Region comes from tkSpriteAtlas::Load; Size is in world units before tcTransform2d::Scale.
+struct tcSprite : tkComponent
+{
+  u32 Region = kInvalidSpriteRegion;
+  v2 Size = v2(1.f);
+  v4 Color = v4(1.f);
+};
+
+#endif //TC_SPRITE_H
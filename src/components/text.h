@@ -0,0 +1,19 @@
+#ifndef TC_TEXT_H
+#define TC_TEXT_H
+
+#include "../core/component.h"
+#include "../core/def.h"
+
+// Drawn at the entity's tcTransform2d position, which is the start of the first
+// baseline. Screen text is placed in pixels from the bottom left of the window and
+// drawn over the scene, e.g. for debug overlays.
+struct tcText : tkComponent
+{
+  tkString Text;
+  // Em size, in world units or pixels for screen text.
+  f32 Size = 1.f;
+  v4 Color = v4(1.f);
+  bool Screen = false;
+};
+
+#endif //TC_TEXT_H
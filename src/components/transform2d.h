@@ -4,6 +4,7 @@
 #include "../core/component.h"
 #include "../core/def.h"
 
+// Mirrored to the GPU as is, see Transform2d in sprite.wgsl.
 struct tcTransform2d : tkComponent
 {
   v2 Position = v2(0.f);
@@ -0,0 +1,14 @@
+#ifndef TC_TRANSFORM3D_H
+#define TC_TRANSFORM3D_H
+
+#include "../core/component.h"
+#include "../core/def.h"
+
+struct tcTransform3d : tkComponent
+{
+  v3 Position = v3(0.f);
+  quat Rotation = quat(1.f, 0.f, 0.f, 0.f);
+  v3 Scale = v3(1.f);
+};
+
+#endif //TC_TRANSFORM3D_H
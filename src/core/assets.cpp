@@ -0,0 +1,182 @@
+#include "assets.h"
+#include "renderer.h"
+#include "logger.h"
+#include <cstring>
+
+tkAssetManager::tkAssetManager()
+{
+  Textures.SetBudget(kDefaultTexturePoolBudget);
+  Meshes.SetBudget(kDefaultMeshPoolBudget);
+}
+
+tkAssetManager& tkAssetManager::Get()
+{
+  static tkAssetManager instance;
+  return instance;
+}
+
+void tkAssetManager::Update()
+{
+  mFrame++;
+  Textures.Update(mFrame);
+  Shaders.Update(mFrame);
+  Meshes.Update(mFrame);
+}
+
+template <>
+tkString tkAssetLoader<tkTextureAsset>::Locate(const tkString& path)
+{
+  tkTextureCacheHeader header;
+  return tkTextureImporter::ReadCacheHeader(path, header) ? tkTextureImporter::GetCachePath(path) : path;
+}
+
+// Only the header and the mip tail are read up front, finer mips are streamed.
+template <>
+u64 tkAssetLoader<tkTextureAsset>::GetReadSize(const tkString& path)
+{
+  tkTextureCacheHeader header;
+  if (!tkTextureImporter::ReadCacheHeader(path, header))
+  {
+    return 0;
+  }
+  return sizeof(header) + tkTextureImporter::GetResidentBytes(header.Width, header.Height, header.MipCount, header.TailMip);
+}
+
+template <>
+bool tkAssetLoader<tkTextureAsset>::Create(tkTextureAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes)
+{
+  tkTextureCacheHeader header{};
+  if (data.size() >= sizeof(header))
+  {
+    memcpy(&header, data.data(), sizeof(header));
+  }
+  if (header.Magic == kTextureCacheMagic && header.Version == kTextureCacheVersion)
+  {
+    bytes = tkTextureImporter::GetResidentBytes(header.Width, header.Height, header.MipCount, header.TailMip);
+    if (data.size() < sizeof(header) + bytes || header.TailMip >= header.MipCount)
+    {
+      tkLogWarning("Assets: Truncated texture cache for %s", path.c_str());
+      return false;
+    }
+    tkTextureImporter::Upload(asset, header.Width, header.Height, header.MipCount, header.TailMip, header.TailMip,
+                              data.subspan(sizeof(header), bytes), path);
+    return true;
+  }
+
+  tkTextureData texture;
+  if (!tkTextureImporter::Import(data, path, texture))
+  {
+    return false;
+  }
+
+  // Stays fully resident this run, later runs stream from the cache.
+  tkTextureImporter::Create(asset, texture, path);
+  tkTextureImporter::WriteCache(path, asset);
+  bytes = tkTextureImporter::GetResidentBytes(asset.Width, asset.Height, asset.MipCount, 0);
+  return true;
+}
+
+template <>
+void tkAssetLoader<tkTextureAsset>::Destroy(tkTextureAsset& asset)
+{
+  if (asset.Texture)
+  {
+    asset.Texture.Destroy();
+  }
+}
+
+template <>
+bool tkAssetLoader<tkShaderAsset>::Create(tkShaderAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes)
+{
+  const tkString code(reinterpret_cast<const char*>(data.data()), data.size());
+
+  wgpu::ShaderModuleWGSLDescriptor wgslDesc{};
+  wgslDesc.code = code.c_str();
+
+  wgpu::ShaderModuleDescriptor shaderModuleDesc{
+    .nextInChain = &wgslDesc,
+    .label = path.c_str(),
+  };
+  asset.Module = tkRenderer::GetDevice().CreateShaderModule(&shaderModuleDesc);
+
+  bytes = 0;
+  return asset.Module.Get() != nullptr;
+}
+
+template <>
+void tkAssetLoader<tkShaderAsset>::Destroy(tkShaderAsset& asset)
+{
+}
+
+template <>
+tkString tkAssetLoader<tkMeshAsset>::Locate(const tkString& path)
+{
+  return tkMeshImporter::IsCacheValid(path) ? tkMeshImporter::GetCachePath(path) : path;
+}
+
+template <>
+bool tkAssetLoader<tkMeshAsset>::Create(tkMeshAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes)
+{
+  // A valid cache is uploaded straight from the read buffer without parsing.
+  tkMeshCacheHeader header{};
+  if (data.size() >= sizeof(header))
+  {
+    memcpy(&header, data.data(), sizeof(header));
+  }
+  if (header.Magic == kMeshCacheMagic && header.Version == kMeshCacheVersion)
+  {
+    const u64 vertexBytes = static_cast<u64>(header.VertexCount) * sizeof(tkPackedMeshVertex);
+    const u64 indexBytes = static_cast<u64>(header.IndexCount) * sizeof(u32);
+    const u64 meshletBytes = static_cast<u64>(header.MeshletCount) * sizeof(tkMeshlet);
+    if (data.size() < sizeof(header) + vertexBytes + indexBytes + meshletBytes || header.IndexCount == 0)
+    {
+      tkLogWarning("Assets: Truncated mesh cache for %s", path.c_str());
+      return false;
+    }
+
+    const u8* vertices = data.data() + sizeof(header);
+    tkMeshImporter::Upload(asset,
+      {reinterpret_cast<const tkPackedMeshVertex*>(vertices), header.VertexCount},
+      {reinterpret_cast<const u32*>(vertices + vertexBytes), header.IndexCount},
+      {reinterpret_cast<const tkMeshlet*>(vertices + vertexBytes + indexBytes), header.MeshletCount}, path);
+    asset.BoundsMin = v3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]);
+    asset.BoundsExtent = v3(header.BoundsExtent[0], header.BoundsExtent[1], header.BoundsExtent[2]);
+    bytes = vertexBytes + indexBytes + meshletBytes;
+    return true;
+  }
+
+  tkMeshData mesh;
+  if (!tkMeshImporter::ImportGltf(data, path, mesh))
+  {
+    return false;
+  }
+  tkMeshImporter::Optimize(mesh);
+
+  tkPackedMesh packed;
+  tkMeshImporter::Pack(mesh, packed);
+  tkMeshImporter::BuildMeshlets(mesh, packed);
+  tkMeshImporter::WriteCache(path, packed);
+  tkMeshImporter::Upload(asset, packed.Vertices, packed.Indices, packed.Meshlets, path);
+  asset.BoundsMin = packed.BoundsMin;
+  asset.BoundsExtent = packed.BoundsExtent;
+  bytes = packed.Vertices.size() * sizeof(tkPackedMeshVertex) + packed.Indices.size() * sizeof(u32) +
+          packed.Meshlets.size() * sizeof(tkMeshlet);
+  return true;
+}
+
+template <>
+void tkAssetLoader<tkMeshAsset>::Destroy(tkMeshAsset& asset)
+{
+  if (asset.VertexBuffer)
+  {
+    asset.VertexBuffer.Destroy();
+  }
+  if (asset.IndexBuffer)
+  {
+    asset.IndexBuffer.Destroy();
+  }
+  if (asset.MeshletBuffer)
+  {
+    asset.MeshletBuffer.Destroy();
+  }
+}
@@ -0,0 +1,400 @@
+#ifndef TK_ASSETS_H
+#define TK_ASSETS_H
+
+#include "def.h"
+#include "io.h"
+#include "mesh.h"
+#include "pack.h"
+#include "reader.h"
+#include "texture.h"
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kInvalidAssetIndex = 0xFFFFFFFF;
+const u64 kAssetUnloadDelayFrames = 120;
+// Resident GPU memory the texture and mesh pools start out with, see tkAssetPool::SetBudget.
+const u64 kDefaultTexturePoolBudget = 512ull * 1024 * 1024;
+const u64 kDefaultMeshPoolBudget = 256ull * 1024 * 1024;
+
+template <typename T>
+struct tkHandle
+{
+  u32 Index = kInvalidAssetIndex;
+  u32 Generation = 0;
+
+  [[nodiscard]] bool IsValid() const { return Index != kInvalidAssetIndex; }
+  bool operator==(const tkHandle&) const = default;
+};
+
+enum class eAssetState : u8
+{
+  Loading = 0,
+  Ready,
+  Evicted,
+  Failed,
+};
+
+enum class eAssetLoad : u8
+{
+  Async = 0,
+  Blocking,
+};
+
+struct tkShaderAsset
+{
+  wgpu::ShaderModule Module;
+};
+
+// Turns file bytes into a resident asset. Specialised per asset type in assets.cpp.
+// Locate may redirect the read to a derived file, e.g. an import cache, and
+// GetReadSize may limit the read to a prefix of it (0 reads the whole file).
+template <typename T>
+struct tkAssetLoader
+{
+  static tkString Locate(const tkString& path) { return path; }
+  static u64 GetReadSize(const tkString& path) { return 0; }
+  static bool Create(T& asset, std::span<const u8> data, const tkString& path, u64& bytes);
+  static void Destroy(T& asset);
+};
+
+template <>
+tkString tkAssetLoader<tkTextureAsset>::Locate(const tkString& path);
+template <>
+u64 tkAssetLoader<tkTextureAsset>::GetReadSize(const tkString& path);
+template <>
+bool tkAssetLoader<tkTextureAsset>::Create(tkTextureAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes);
+template <>
+void tkAssetLoader<tkTextureAsset>::Destroy(tkTextureAsset& asset);
+template <>
+bool tkAssetLoader<tkShaderAsset>::Create(tkShaderAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes);
+template <>
+void tkAssetLoader<tkShaderAsset>::Destroy(tkShaderAsset& asset);
+template <>
+tkString tkAssetLoader<tkMeshAsset>::Locate(const tkString& path);
+template <>
+bool tkAssetLoader<tkMeshAsset>::Create(tkMeshAsset& asset, std::span<const u8> data, const tkString& path, u64& bytes);
+template <>
+void tkAssetLoader<tkMeshAsset>::Destroy(tkMeshAsset& asset);
+
+template <typename T>
+class tkAssetPool
+{
+  struct tkSlot
+  {
+    T Asset{};
+    tkString Path;
+    u64 Key = 0;
+    u64 Bytes = 0;
+    u64 LastUsedFrame = 0;
+    u64 ReleasedFrame = 0;
+    u32 RefCount = 0;
+    u32 Generation = 1;
+    eAssetState State = eAssetState::Loading;
+    tkIOHandle Request;
+  };
+
+  tkDArray<tkSlot> mSlots;
+  tkDArray<u32> mFreeSlots;
+  std::unordered_map<u64, u32> mLookup;
+  u64 mResidentBytes = 0;
+  u64 mBudget = 0;
+  u64 mFrame = 0;
+
+public:
+  tkHandle<T> Acquire(const tkString& path, eAssetLoad load = eAssetLoad::Async);
+  void AddRef(tkHandle<T> handle);
+  void Release(tkHandle<T> handle);
+
+  // Returns null while the asset is loading, evicted or failed.
+  T* Get(tkHandle<T> handle);
+  // Like Get, but neither marks the asset used nor reloads it.
+  T* Peek(tkHandle<T> handle);
+  [[nodiscard]] eAssetState GetState(tkHandle<T> handle) const;
+
+  // Least recently used assets are evicted once resident bytes pass this, zero never evicts.
+  void SetBudget(u64 bytes) { mBudget = bytes; }
+  [[nodiscard]] u64 GetResidentBytes() const { return mResidentBytes; }
+
+  void Update(u64 frame);
+
+private:
+  [[nodiscard]] tkSlot* Resolve(tkHandle<T> handle);
+  [[nodiscard]] const tkSlot* Resolve(tkHandle<T> handle) const;
+  void Load(tkHandle<T> handle, eAssetLoad load);
+  void Finish(tkSlot& slot, std::span<const u8> data);
+  void Unload(tkSlot& slot);
+  void Free(u32 index);
+};
+
+class tkAssetManager
+{
+public:
+  tkAssetPool<tkTextureAsset> Textures;
+  tkAssetPool<tkShaderAsset> Shaders;
+  tkAssetPool<tkMeshAsset> Meshes;
+
+private:
+  u64 mFrame = 0;
+
+public:
+  static tkAssetManager& Get();
+
+  void Update();
+
+private:
+  tkAssetManager();
+};
+
+template <typename T>
+typename tkAssetPool<T>::tkSlot* tkAssetPool<T>::Resolve(tkHandle<T> handle)
+{
+  if (handle.Index >= mSlots.size() || mSlots[handle.Index].Generation != handle.Generation)
+  {
+    return nullptr;
+  }
+  return &mSlots[handle.Index];
+}
+
+template <typename T>
+const typename tkAssetPool<T>::tkSlot* tkAssetPool<T>::Resolve(tkHandle<T> handle) const
+{
+  if (handle.Index >= mSlots.size() || mSlots[handle.Index].Generation != handle.Generation)
+  {
+    return nullptr;
+  }
+  return &mSlots[handle.Index];
+}
+
+template <typename T>
+tkHandle<T> tkAssetPool<T>::Acquire(const tkString& path, eAssetLoad load)
+{
+  const u64 key = tkPack::HashPath(path);
+  if (auto it = mLookup.find(key); it != mLookup.end())
+  {
+    tkSlot& slot = mSlots[it->second];
+    slot.RefCount++;
+    slot.LastUsedFrame = mFrame;
+    tkHandle<T> handle{it->second, slot.Generation};
+    if (load == eAssetLoad::Blocking && slot.State != eAssetState::Ready)
+    {
+      Load(handle, load);
+    }
+    return handle;
+  }
+
+  u32 index;
+  if (!mFreeSlots.empty())
+  {
+    index = mFreeSlots.back();
+    mFreeSlots.pop_back();
+  }
+  else
+  {
+    index = static_cast<u32>(mSlots.size());
+    mSlots.emplace_back();
+  }
+
+  tkSlot& slot = mSlots[index];
+  slot.Path = path;
+  slot.Key = key;
+  slot.RefCount = 1;
+  slot.LastUsedFrame = mFrame;
+  mLookup.emplace(key, index);
+
+  tkHandle<T> handle{index, slot.Generation};
+  Load(handle, load);
+  return handle;
+}
+
+template <typename T>
+void tkAssetPool<T>::AddRef(tkHandle<T> handle)
+{
+  if (tkSlot* slot = Resolve(handle))
+  {
+    slot->RefCount++;
+  }
+}
+
+template <typename T>
+void tkAssetPool<T>::Release(tkHandle<T> handle)
+{
+  tkSlot* slot = Resolve(handle);
+  if (slot && slot->RefCount > 0 && --slot->RefCount == 0)
+  {
+    slot->ReleasedFrame = mFrame;
+  }
+}
+
+template <typename T>
+T* tkAssetPool<T>::Get(tkHandle<T> handle)
+{
+  tkSlot* slot = Resolve(handle);
+  if (!slot)
+  {
+    return nullptr;
+  }
+
+  slot->LastUsedFrame = mFrame;
+  if (slot->State == eAssetState::Evicted)
+  {
+    Load(handle, eAssetLoad::Async);
+  }
+  return slot->State == eAssetState::Ready ? &slot->Asset : nullptr;
+}
+
+template <typename T>
+T* tkAssetPool<T>::Peek(tkHandle<T> handle)
+{
+  tkSlot* slot = Resolve(handle);
+  return slot && slot->State == eAssetState::Ready ? &slot->Asset : nullptr;
+}
+
+template <typename T>
+eAssetState tkAssetPool<T>::GetState(tkHandle<T> handle) const
+{
+  const tkSlot* slot = Resolve(handle);
+  return slot ? slot->State : eAssetState::Failed;
+}
+
+template <typename T>
+void tkAssetPool<T>::Load(tkHandle<T> handle, eAssetLoad load)
+{
+  tkSlot& slot = mSlots[handle.Index];
+  slot.State = eAssetState::Loading;
+
+  if (load == eAssetLoad::Blocking)
+  {
+    slot.Request.Cancel();
+    slot.Request = {};
+    tkFileView file = tkReader::MapBinaryFile(tkAssetLoader<T>::Locate(slot.Path));
+    Finish(slot, file.GetBytes());
+    return;
+  }
+
+  // A finished read stays valid until Pump runs its callback, which clears it, so
+  // a done request is still in flight as far as the slot is concerned.
+  if (slot.Request.IsValid())
+  {
+    return;
+  }
+
+  auto callback = [this, handle](const tkIOHandle& request) {
+    tkSlot* slot = Resolve(handle);
+    if (slot && slot->State == eAssetState::Loading)
+    {
+      slot->Request = {};
+      Finish(*slot, request.GetData());
+    }
+  };
+  slot.Request = tkIOService::Get().Read(tkAssetLoader<T>::Locate(slot.Path), eIOPriority::Normal, callback, 0,
+                                         tkAssetLoader<T>::GetReadSize(slot.Path));
+}
+
+template <typename T>
+void tkAssetPool<T>::Finish(tkSlot& slot, std::span<const u8> data)
+{
+  u64 bytes = 0;
+  if (data.empty() || !tkAssetLoader<T>::Create(slot.Asset, data, slot.Path, bytes))
+  {
+    slot.State = eAssetState::Failed;
+    return;
+  }
+
+  slot.State = eAssetState::Ready;
+  slot.Bytes = bytes;
+  mResidentBytes += bytes;
+}
+
+template <typename T>
+void tkAssetPool<T>::Unload(tkSlot& slot)
+{
+  if (slot.State == eAssetState::Ready)
+  {
+    tkAssetLoader<T>::Destroy(slot.Asset);
+    T empty{};
+    if constexpr (requires { empty.Revision; })
+    {
+      // Keeps counting across reloads, or a reloaded asset would repeat an old revision.
+      empty.Revision = slot.Asset.Revision;
+    }
+    slot.Asset = std::move(empty);
+    mResidentBytes -= slot.Bytes;
+    slot.Bytes = 0;
+  }
+  slot.Request.Cancel();
+  slot.Request = {};
+}
+
+template <typename T>
+void tkAssetPool<T>::Free(u32 index)
+{
+  tkSlot& slot = mSlots[index];
+  Unload(slot);
+  mLookup.erase(slot.Key);
+  slot.Path.clear();
+  slot.Generation++;
+  slot.State = eAssetState::Failed;
+  mFreeSlots.push_back(index);
+}
+
+template <typename T>
+void tkAssetPool<T>::Update(u64 frame)
+{
+  mFrame = frame;
+
+  tkDArray<u32> candidates;
+  for (u32 i = 0; i < mSlots.size(); i++)
+  {
+    tkSlot& slot = mSlots[i];
+    if (slot.Path.empty())
+    {
+      continue;
+    }
+    if (slot.RefCount == 0 && frame - slot.ReleasedFrame >= kAssetUnloadDelayFrames)
+    {
+      Free(i);
+    }
+    else if (slot.State == eAssetState::Ready && slot.LastUsedFrame < frame)
+    {
+      candidates.push_back(i);
+    }
+  }
+
+  if (mBudget == 0 || mResidentBytes <= mBudget)
+  {
+    return;
+  }
+
+  // Unreferenced assets go first, then the least recently used. Assets used this
+  // frame are never evicted.
+  std::sort(candidates.begin(), candidates.end(), [this](u32 a, u32 b) {
+    const tkSlot& slotA = mSlots[a];
+    const tkSlot& slotB = mSlots[b];
+    if ((slotA.RefCount == 0) != (slotB.RefCount == 0))
+    {
+      return slotA.RefCount == 0;
+    }
+    return slotA.LastUsedFrame < slotB.LastUsedFrame;
+  });
+
+  for (u32 index : candidates)
+  {
+    if (mResidentBytes <= mBudget)
+    {
+      break;
+    }
+    if (mSlots[index].RefCount == 0)
+    {
+      Free(index);
+    }
+    else
+    {
+      Unload(mSlots[index]);
+      mSlots[index].State = eAssetState::Evicted;
+    }
+  }
+}
+
+#endif//TK_ASSETS_H
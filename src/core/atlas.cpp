@@ -0,0 +1,190 @@
+#include "atlas.h"
+#include "renderer.h"
+#include "texture.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+void tkSkylinePacker::Reset(u32 width, u32 height)
+{
+  mWidth = width;
+  mHeight = height;
+  mSkyline.clear();
+  mSkyline.push_back({0, 0, width});
+}
+
+bool tkSkylinePacker::Fit(u32 index, u32 width, u32 height, u32& y) const
+{
+  const u32 x = mSkyline[index].X;
+  if (x + width > mWidth)
+  {
+    return false;
+  }
+
+  // The rectangle rests on the highest node it spans.
+  y = 0;
+  u32 remaining = width;
+  for (u32 i = index; remaining > 0; i++)
+  {
+    y = std::max(y, mSkyline[i].Y);
+    if (y + height > mHeight)
+    {
+      return false;
+    }
+    remaining -= std::min(remaining, mSkyline[i].Width);
+  }
+  return true;
+}
+
+bool tkSkylinePacker::Pack(u32 width, u32 height, u32& x, u32& y)
+{
+  u32 bestIndex = kInvalidSpriteRegion;
+  u32 bestBottom = ~0u;
+  u32 bestWidth = ~0u;
+  for (u32 i = 0; i < mSkyline.size(); i++)
+  {
+    u32 top;
+    if (Fit(i, width, height, top) && (top + height < bestBottom || (top + height == bestBottom && mSkyline[i].Width < bestWidth)))
+    {
+      bestIndex = i;
+      bestBottom = top + height;
+      bestWidth = mSkyline[i].Width;
+      y = top;
+    }
+  }
+  if (bestIndex == kInvalidSpriteRegion)
+  {
+    return false;
+  }
+
+  x = mSkyline[bestIndex].X;
+  mSkyline.insert(mSkyline.begin() + bestIndex, {x, y + height, width});
+
+  // Trim the runs now covered by the new node.
+  for (u32 i = bestIndex + 1; i < mSkyline.size();)
+  {
+    const u32 coveredEnd = mSkyline[i - 1].X + mSkyline[i - 1].Width;
+    if (mSkyline[i].X >= coveredEnd)
+    {
+      break;
+    }
+    const u32 shrink = coveredEnd - mSkyline[i].X;
+    if (mSkyline[i].Width <= shrink)
+    {
+      mSkyline.erase(mSkyline.begin() + i);
+      continue;
+    }
+    mSkyline[i].X += shrink;
+    mSkyline[i].Width -= shrink;
+    break;
+  }
+
+  for (u32 i = 0; i + 1 < mSkyline.size();)
+  {
+    if (mSkyline[i].Y == mSkyline[i + 1].Y)
+    {
+      mSkyline[i].Width += mSkyline[i + 1].Width;
+      mSkyline.erase(mSkyline.begin() + i + 1);
+    }
+    else
+    {
+      i++;
+    }
+  }
+  return true;
+}
+
+u32 tkSpriteAtlas::Load(const tkString& path)
+{
+  if (auto it = mLookup.find(path); it != mLookup.end())
+  {
+    return it->second;
+  }
+
+  tkFileView file = tkReader::MapBinaryFile(path);
+  tkTextureData image;
+  if (!file.IsValid() || !tkTextureImporter::Import(file.GetBytes(), path, image))
+  {
+    tkLogWarning("SpriteAtlas: Failed to load %s", path.c_str());
+    return kInvalidSpriteRegion;
+  }
+  return Add(path, image.Width, image.Height, image.Pixels);
+}
+
+u32 tkSpriteAtlas::Add(const tkString& name, u32 width, u32 height, std::span<const u8> pixels)
+{
+  const u32 paddedWidth = width + kSpriteAtlasPadding * 2;
+  const u32 paddedHeight = height + kSpriteAtlasPadding * 2;
+  if (paddedWidth > kSpriteAtlasPageSize || paddedHeight > kSpriteAtlasPageSize)
+  {
+    tkLogWarning("SpriteAtlas: %s is %ux%u, larger than an atlas page", name.c_str(), width, height);
+    return kInvalidSpriteRegion;
+  }
+
+  // Earlier pages first so they fill up before a new one is started.
+  u32 page = 0;
+  u32 x = 0;
+  u32 y = 0;
+  while (page < mPages.size() && !mPages[page].Packer.Pack(paddedWidth, paddedHeight, x, y))
+  {
+    page++;
+  }
+  if (page == mPages.size() && (!AddPage() || !mPages[page].Packer.Pack(paddedWidth, paddedHeight, x, y)))
+  {
+    tkLogWarning("SpriteAtlas: No room for %s", name.c_str());
+    return kInvalidSpriteRegion;
+  }
+
+  // Extrude the edge texels into the padding.
+  tkDArray<u8> padded(static_cast<size_t>(paddedWidth) * paddedHeight * kTextureTexelBytes);
+  for (u32 row = 0; row < paddedHeight; row++)
+  {
+    const u32 srcRow = std::clamp(row, kSpriteAtlasPadding, height + kSpriteAtlasPadding - 1) - kSpriteAtlasPadding;
+    for (u32 column = 0; column < paddedWidth; column++)
+    {
+      const u32 srcColumn = std::clamp(column, kSpriteAtlasPadding, width + kSpriteAtlasPadding - 1) - kSpriteAtlasPadding;
+      memcpy(&padded[(static_cast<size_t>(row) * paddedWidth + column) * kTextureTexelBytes],
+             &pixels[(static_cast<size_t>(srcRow) * width + srcColumn) * kTextureTexelBytes], kTextureTexelBytes);
+    }
+  }
+
+  wgpu::ImageCopyTexture destination{.texture = mPages[page].Texture, .origin = {x, y, 0}};
+  wgpu::TextureDataLayout layout{.bytesPerRow = paddedWidth * kTextureTexelBytes, .rowsPerImage = paddedHeight};
+  wgpu::Extent3D size{paddedWidth, paddedHeight, 1};
+  tkRenderer::GetDevice().GetQueue().WriteTexture(&destination, padded.data(), padded.size(), &layout, &size);
+
+  const f32 scale = 1.f / static_cast<f32>(kSpriteAtlasPageSize);
+  const v2 origin = v2(x + kSpriteAtlasPadding, y + kSpriteAtlasPadding);
+  mRegions.push_back({
+    .Page = page,
+    .UVMin = origin * scale,
+    .UVMax = (origin + v2(width, height)) * scale,
+    .Size = v2(width, height),
+  });
+  const u32 region = static_cast<u32>(mRegions.size() - 1);
+  mLookup.emplace(name, region);
+  return region;
+}
+
+bool tkSpriteAtlas::AddPage()
+{
+  if (mPages.size() >= kMaxSpriteAtlasPages)
+  {
+    return false;
+  }
+
+  wgpu::TextureDescriptor desc{
+    .label = "Sprite Atlas",
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {kSpriteAtlasPageSize, kSpriteAtlasPageSize, 1},
+    .format = wgpu::TextureFormat::RGBA8Unorm,
+    .mipLevelCount = 1,
+    .sampleCount = 1,
+  };
+  tkPage& page = mPages.emplace_back();
+  page.Texture = tkRenderer::GetDevice().CreateTexture(&desc);
+  page.View = page.Texture.CreateView();
+  page.Packer.Reset(kSpriteAtlasPageSize, kSpriteAtlasPageSize);
+  return true;
+}
@@ -0,0 +1,76 @@
+#ifndef TK_ATLAS_H
+#define TK_ATLAS_H
+
+#include "def.h"
+#include <span>
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kSpriteAtlasPageSize = 2048;
+const u32 kMaxSpriteAtlasPages = 16;
+// Border around every sprite, filled with its edge texels so filtering never bleeds.
+const u32 kSpriteAtlasPadding = 1;
+const u32 kInvalidSpriteRegion = 0xFFFFFFFF;
+
+// Online bottom-left skyline rectangle packer. The skyline is the top edge of the
+// packed area, one node per horizontal run; each rectangle goes where its top ends
+// lowest, ties broken by the narrower run.
+class tkSkylinePacker
+{
+  struct tkSkylineNode
+  {
+    u32 X;
+    u32 Y;
+    u32 Width;
+  };
+
+  tkDArray<tkSkylineNode> mSkyline;
+  u32 mWidth = 0;
+  u32 mHeight = 0;
+
+public:
+  void Reset(u32 width, u32 height);
+  bool Pack(u32 width, u32 height, u32& x, u32& y);
+
+private:
+  bool Fit(u32 index, u32 width, u32 height, u32& y) const;
+};
+
+struct tkSpriteRegion
+{
+  u32 Page;
+  v2 UVMin;
+  v2 UVMax;
+  // Source image size in pixels.
+  v2 Size;
+};
+
+// Packs sprite images into kSpriteAtlasPageSize RGBA8 pages as they are loaded, so
+// the sprite renderer only switches textures between pages.
+class tkSpriteAtlas
+{
+  struct tkPage
+  {
+    wgpu::Texture Texture;
+    wgpu::TextureView View;
+    tkSkylinePacker Packer;
+  };
+
+  tkDArray<tkPage> mPages;
+  tkDArray<tkSpriteRegion> mRegions;
+  std::unordered_map<tkString, u32> mLookup;
+
+public:
+  // Returns the region of an image file, loading and packing it on first use.
+  u32 Load(const tkString& path);
+  u32 Add(const tkString& name, u32 width, u32 height, std::span<const u8> pixels);
+
+  [[nodiscard]] const tkSpriteRegion& GetRegion(u32 region) const { return mRegions[region]; }
+  [[nodiscard]] u32 GetPageCount() const { return static_cast<u32>(mPages.size()); }
+  [[nodiscard]] const wgpu::TextureView& GetPageView(u32 page) const { return mPages[page].View; }
+
+private:
+  bool AddPage();
+};
+
+#endif//TK_ATLAS_H
@@ -0,0 +1,129 @@
+#include "bindGroupCache.h"
+#include "hash.h"
+#include <algorithm>
+#include <span>
+
+template <typename T>
+static u64 HandleWord(const T& object)
+{
+  return reinterpret_cast<u64>(object.Get());
+}
+
+static bool SameEntry(const wgpu::BindGroupLayoutEntry& a, const wgpu::BindGroupLayoutEntry& b)
+{
+  return a.binding == b.binding && a.visibility == b.visibility &&
+         a.buffer.type == b.buffer.type && a.buffer.hasDynamicOffset == b.buffer.hasDynamicOffset &&
+         a.buffer.minBindingSize == b.buffer.minBindingSize &&
+         a.sampler.type == b.sampler.type &&
+         a.texture.sampleType == b.texture.sampleType && a.texture.viewDimension == b.texture.viewDimension &&
+         a.texture.multisampled == b.texture.multisampled &&
+         a.storageTexture.access == b.storageTexture.access && a.storageTexture.format == b.storageTexture.format &&
+         a.storageTexture.viewDimension == b.storageTexture.viewDimension;
+}
+
+static bool SameEntry(const wgpu::BindGroupEntry& a, const wgpu::BindGroupEntry& b)
+{
+  return a.binding == b.binding && a.buffer.Get() == b.buffer.Get() && a.offset == b.offset && a.size == b.size &&
+         a.sampler.Get() == b.sampler.Get() && a.textureView.Get() == b.textureView.Get();
+}
+
+template <typename T>
+static bool SameEntries(const tkDArray<T>& cached, std::span<const T> entries)
+{
+  return std::equal(cached.begin(), cached.end(), entries.begin(), entries.end(),
+                    [](const T& a, const T& b) { return SameEntry(a, b); });
+}
+
+void tkBindGroupCache::Setup(wgpu::Device& device)
+{
+  mDevice = device;
+  mLayouts.clear();
+  mBindGroups.clear();
+}
+
+void tkBindGroupCache::BeginFrame()
+{
+  mFrame++;
+  for (auto it = mBindGroups.begin(); it != mBindGroups.end();)
+  {
+    std::erase_if(it->second, [this](const tkCachedBindGroup& entry) { return mFrame - entry.LastUsed > kBindGroupCacheLifetime; });
+    it = it->second.empty() ? mBindGroups.erase(it) : std::next(it);
+  }
+}
+
+u64 tkBindGroupCache::Hash(const wgpu::BindGroupLayoutDescriptor& desc)
+{
+  u64 hash = kHashOffsetBasis;
+  for (const wgpu::BindGroupLayoutEntry& entry : std::span(desc.entries, desc.entryCount))
+  {
+    tkHashWord(hash, entry.binding);
+    tkHashWord(hash, static_cast<u64>(entry.visibility));
+    tkHashWord(hash, static_cast<u64>(entry.buffer.type) | static_cast<u64>(entry.buffer.hasDynamicOffset) << 32);
+    tkHashWord(hash, entry.buffer.minBindingSize);
+    tkHashWord(hash, static_cast<u64>(entry.sampler.type));
+    tkHashWord(hash, static_cast<u64>(entry.texture.sampleType) | static_cast<u64>(entry.texture.viewDimension) << 32);
+    tkHashWord(hash, static_cast<u64>(entry.storageTexture.access) | static_cast<u64>(entry.storageTexture.format) << 32);
+  }
+  return hash;
+}
+
+u64 tkBindGroupCache::Hash(const wgpu::BindGroupDescriptor& desc)
+{
+  u64 hash = kHashOffsetBasis;
+  tkHashWord(hash, HandleWord(desc.layout));
+  for (const wgpu::BindGroupEntry& entry : std::span(desc.entries, desc.entryCount))
+  {
+    tkHashWord(hash, entry.binding);
+    tkHashWord(hash, HandleWord(entry.buffer));
+    tkHashWord(hash, entry.offset);
+    tkHashWord(hash, entry.size);
+    tkHashWord(hash, HandleWord(entry.sampler));
+    tkHashWord(hash, HandleWord(entry.textureView));
+  }
+  return hash;
+}
+
+wgpu::BindGroupLayout tkBindGroupCache::GetLayout(const wgpu::BindGroupLayoutDescriptor& desc)
+{
+  const std::span<const wgpu::BindGroupLayoutEntry> entries(desc.entries, desc.entryCount);
+  if (desc.nextInChain || std::any_of(entries.begin(), entries.end(), [](const auto& entry) { return entry.nextInChain != nullptr; }))
+  {
+    return mDevice.CreateBindGroupLayout(&desc);
+  }
+
+  tkDArray<tkCachedLayout>& bucket = mLayouts[Hash(desc)];
+  for (const tkCachedLayout& cached : bucket)
+  {
+    if (SameEntries(cached.Entries, entries))
+    {
+      return cached.Layout;
+    }
+  }
+
+  wgpu::BindGroupLayout layout = mDevice.CreateBindGroupLayout(&desc);
+  bucket.push_back({tkDArray<wgpu::BindGroupLayoutEntry>(entries.begin(), entries.end()), layout});
+  return layout;
+}
+
+wgpu::BindGroup tkBindGroupCache::GetBindGroup(const wgpu::BindGroupDescriptor& desc)
+{
+  const std::span<const wgpu::BindGroupEntry> entries(desc.entries, desc.entryCount);
+  if (desc.nextInChain || std::any_of(entries.begin(), entries.end(), [](const auto& entry) { return entry.nextInChain != nullptr; }))
+  {
+    return mDevice.CreateBindGroup(&desc);
+  }
+
+  tkDArray<tkCachedBindGroup>& bucket = mBindGroups[Hash(desc)];
+  for (tkCachedBindGroup& cached : bucket)
+  {
+    if (cached.Layout.Get() == desc.layout.Get() && SameEntries(cached.Entries, entries))
+    {
+      cached.LastUsed = mFrame;
+      return cached.BindGroup;
+    }
+  }
+
+  wgpu::BindGroup bindGroup = mDevice.CreateBindGroup(&desc);
+  bucket.push_back({desc.layout, tkDArray<wgpu::BindGroupEntry>(entries.begin(), entries.end()), bindGroup, mFrame});
+  return bindGroup;
+}
@@ -0,0 +1,54 @@
+#ifndef TK_BIND_GROUP_CACHE_H
+#define TK_BIND_GROUP_CACHE_H
+
+#include "def.h"
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+// Unused bind groups are released after this many frames.
+const u32 kBindGroupCacheLifetime = 120;
+
+// Deduplicates bind group layouts and bind groups by their descriptor contents, so
+// code can describe what it wants every frame or every load and only pay for creation
+// the first time.
+//
+// Layouts live as long as the cache. Bind groups hold references to their buffers,
+// samplers and views, so a cached group never points at a recycled handle; groups not
+// asked for in kBindGroupCacheLifetime frames are dropped with those references, which
+// frees resources their owners have already let go of. Descriptors with a chained
+// struct are not cached.
+class tkBindGroupCache
+{
+  struct tkCachedLayout
+  {
+    tkDArray<wgpu::BindGroupLayoutEntry> Entries;
+    wgpu::BindGroupLayout Layout;
+  };
+
+  struct tkCachedBindGroup
+  {
+    wgpu::BindGroupLayout Layout;
+    tkDArray<wgpu::BindGroupEntry> Entries;
+    wgpu::BindGroup BindGroup;
+    u32 LastUsed;
+  };
+
+  wgpu::Device mDevice;
+  std::unordered_map<u64, tkDArray<tkCachedLayout>> mLayouts;
+  std::unordered_map<u64, tkDArray<tkCachedBindGroup>> mBindGroups;
+  u32 mFrame = 0;
+
+public:
+  void Setup(wgpu::Device& device);
+  // Advances the frame and drops bind groups that have gone unused.
+  void BeginFrame();
+
+  wgpu::BindGroupLayout GetLayout(const wgpu::BindGroupLayoutDescriptor& desc);
+  wgpu::BindGroup GetBindGroup(const wgpu::BindGroupDescriptor& desc);
+
+private:
+  static u64 Hash(const wgpu::BindGroupLayoutDescriptor& desc);
+  static u64 Hash(const wgpu::BindGroupDescriptor& desc);
+};
+
+#endif//TK_BIND_GROUP_CACHE_H
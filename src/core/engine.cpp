@@ -2,6 +2,11 @@
 #include "def.h"
 #include "entt/entt.hpp"
 #include "renderer.h"
+#include "io.h"
+#include "assets.h"
+#include "pack.h"
+#include "reader.h"
+#include <filesystem>
 #include "../systems/sPhysics2d.h"
 
 tkEngine& tkEngine::Get()
@@ -37,6 +42,11 @@ i32 tkEngine::Init()
 {
   bRunning = true;
 
+  if (std::filesystem::exists(tkReader::ResolvePath(kAssetPack)))
+  {
+    tkPack::Mount(kAssetPack);
+  }
+
   UpdateSystems.push_back(new tsPhysics2d());
 
   tkScene* pScene = new tkScene();
@@ -67,8 +77,10 @@ i32 tkEngine::MainLoop()
   while(!ShouldExit())
   {
     PollEvents();
+    tkIOService::Get().Pump();
     Update();
     tkRenderer::Get().Render();
+    tkAssetManager::Get().Update();
   }
   return TK_EXIT_SUCCESS;
 }
@@ -93,4 +105,9 @@ void tkEngine::Update()
   {
     system->Update();
   }
+
+  for(tkScene* pScene : LoadedScenes)
+  {
+    pScene->Update();
+  }
 }
@@ -0,0 +1,203 @@
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+#include "font.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+// Decodes one UTF-8 sequence, malformed bytes come out as themselves.
+static u32 NextCodepoint(const tkString& text, size_t& i)
+{
+  const u8 lead = static_cast<u8>(text[i++]);
+  const u32 length = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+  if (length == 0 || i + length > text.size())
+  {
+    return lead;
+  }
+
+  u32 codepoint = lead & (0x3F >> length);
+  for (u32 n = 0; n < length; n++)
+  {
+    codepoint = (codepoint << 6) | (static_cast<u8>(text[i++]) & 0x3F);
+  }
+  return codepoint;
+}
+
+tkGlyphCache::tkGlyphCache() = default;
+tkGlyphCache::~tkGlyphCache() = default;
+
+void tkGlyphCache::Setup(wgpu::Device& device)
+{
+  wgpu::TextureDescriptor desc{
+    .label = "Glyph Atlas",
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {kGlyphAtlasSize, kGlyphAtlasSize, 1},
+    .format = wgpu::TextureFormat::R8Unorm,
+    .mipLevelCount = 1,
+    .sampleCount = 1,
+  };
+  mTexture = device.CreateTexture(&desc);
+  mView = mTexture.CreateView();
+}
+
+bool tkGlyphCache::LoadFont(const tkString& path)
+{
+  tkFileView file = tkReader::MapBinaryFile(path);
+  if (!file.IsValid())
+  {
+    tkLogWarning("GlyphCache: Failed to open %s", path.c_str());
+    return false;
+  }
+
+  auto font = std::make_unique<stbtt_fontinfo>();
+  const u8* data = file.GetBytes().data();
+  if (!stbtt_InitFont(font.get(), data, stbtt_GetFontOffsetForIndex(data, 0)))
+  {
+    tkLogWarning("GlyphCache: %s is not a TrueType font", path.c_str());
+    return false;
+  }
+
+  i32 ascent, descent, lineGap;
+  stbtt_GetFontVMetrics(font.get(), &ascent, &descent, &lineGap);
+  mFontFile = file;
+  mFont = std::move(font);
+  mScale = stbtt_ScaleForPixelHeight(mFont.get(), kGlyphSdfSize);
+  mLineAdvance = static_cast<f32>(ascent - descent + lineGap) * mScale / kGlyphSdfSize;
+
+  // Cells and layouts both depend on the font.
+  mCells.assign(kGlyphCellsPerRow * kGlyphCellsPerRow, {});
+  mLookup.clear();
+  mLayouts.clear();
+  return true;
+}
+
+void tkGlyphCache::BeginFrame()
+{
+  mFrame++;
+  if (mFrame % kTextLayoutRetainFrames == 0)
+  {
+    std::erase_if(mLayouts, [this](const auto& entry) { return entry.second.LastFrame + kTextLayoutRetainFrames < mFrame; });
+  }
+}
+
+const tkTextLayout& tkGlyphCache::GetLayout(const tkString& text)
+{
+  auto [it, inserted] = mLayouts.try_emplace(text);
+  tkTextLayout& layout = it->second;
+  layout.LastFrame = mFrame;
+  if (!inserted || !IsLoaded())
+  {
+    return layout;
+  }
+
+  const f32 em = 1.f / kGlyphSdfSize;
+  const f32 padding = static_cast<f32>(kGlyphSdfPadding);
+  v2 pen = v2(0.f);
+  u32 previous = 0;
+  for (size_t i = 0; i < text.size();)
+  {
+    const u32 codepoint = NextCodepoint(text, i);
+    if (codepoint == '\n')
+    {
+      pen = v2(0.f, pen.y - mLineAdvance);
+      previous = 0;
+      continue;
+    }
+
+    if (previous != 0)
+    {
+      pen.x += static_cast<f32>(stbtt_GetCodepointKernAdvance(mFont.get(), previous, codepoint)) * mScale * em;
+    }
+    previous = codepoint;
+
+    i32 advance, bearing;
+    stbtt_GetCodepointHMetrics(mFont.get(), codepoint, &advance, &bearing);
+
+    // Same box stbtt_GetCodepointSDF rasterizes, flipped to y up.
+    i32 x0, y0, x1, y1;
+    stbtt_GetCodepointBitmapBox(mFont.get(), codepoint, mScale, mScale, &x0, &y0, &x1, &y1);
+    if (x1 > x0 && y1 > y0)
+    {
+      // GetGlyph crops oversized glyphs to the top left of a cell, crop the quad to match.
+      const f32 cell = static_cast<f32>(kGlyphCellSize);
+      const f32 width = std::min(static_cast<f32>(x1 - x0) + padding * 2.f, cell);
+      const f32 height = std::min(static_cast<f32>(y1 - y0) + padding * 2.f, cell);
+      layout.Glyphs.push_back({
+        .Codepoint = codepoint,
+        .Offset = pen + v2(static_cast<f32>(x0) - padding, -static_cast<f32>(y0) + padding - height) * em,
+        .Size = v2(width, height) * em,
+      });
+    }
+    pen.x += static_cast<f32>(advance) * mScale * em;
+  }
+  return layout;
+}
+
+bool tkGlyphCache::GetGlyph(wgpu::Queue& queue, u32 codepoint, v4& uv)
+{
+  auto cellUV = [](u32 cell, u32 width, u32 height) {
+    const f32 scale = 1.f / static_cast<f32>(kGlyphAtlasSize);
+    const v2 origin = v2(cell % kGlyphCellsPerRow, cell / kGlyphCellsPerRow) * static_cast<f32>(kGlyphCellSize);
+    return v4(origin * scale, (origin + v2(width, height)) * scale);
+  };
+
+  if (auto it = mLookup.find(codepoint); it != mLookup.end())
+  {
+    tkCell& cell = mCells[it->second];
+    cell.LastUsed = mFrame;
+    uv = cellUV(it->second, cell.Width, cell.Height);
+    return true;
+  }
+
+  u32 victim = 0;
+  for (u32 cell = 1; cell < mCells.size(); cell++)
+  {
+    if (mCells[cell].LastUsed < mCells[victim].LastUsed)
+    {
+      victim = cell;
+    }
+  }
+  if (mCells[victim].LastUsed == mFrame)
+  {
+    tkLogWarning("GlyphCache: Atlas full, dropping glyph U+%04X", codepoint);
+    return false;
+  }
+
+  i32 width, height, xoff, yoff;
+  u8* sdf = stbtt_GetCodepointSDF(mFont.get(), mScale, static_cast<i32>(codepoint), kGlyphSdfPadding, 128,
+                                  128.f / static_cast<f32>(kGlyphSdfPadding), &width, &height, &xoff, &yoff);
+  if (!sdf)
+  {
+    return false;
+  }
+
+  // Oversized glyphs are cropped to the cell. The whole cell is rewritten so
+  // filtering at the glyph edge never reads the previous occupant.
+  const u32 w = std::min(static_cast<u32>(width), kGlyphCellSize);
+  const u32 h = std::min(static_cast<u32>(height), kGlyphCellSize);
+  tkArray<u8, kGlyphCellSize * kGlyphCellSize> cellPixels{};
+  for (u32 row = 0; row < h; row++)
+  {
+    memcpy(&cellPixels[row * kGlyphCellSize], &sdf[row * width], w);
+  }
+  stbtt_FreeSDF(sdf, nullptr);
+
+  if (mCells[victim].LastUsed != 0)
+  {
+    mLookup.erase(mCells[victim].Codepoint);
+  }
+  mCells[victim] = {codepoint, w, h, mFrame};
+  mLookup.emplace(codepoint, victim);
+
+  wgpu::ImageCopyTexture destination{
+    .texture = mTexture,
+    .origin = {(victim % kGlyphCellsPerRow) * kGlyphCellSize, (victim / kGlyphCellsPerRow) * kGlyphCellSize, 0},
+  };
+  wgpu::TextureDataLayout layout{.bytesPerRow = kGlyphCellSize, .rowsPerImage = kGlyphCellSize};
+  wgpu::Extent3D size{kGlyphCellSize, kGlyphCellSize, 1};
+  queue.WriteTexture(&destination, cellPixels.data(), cellPixels.size(), &layout, &size);
+
+  uv = cellUV(victim, w, h);
+  return true;
+}
@@ -0,0 +1,80 @@
+#ifndef TK_FONT_H
+#define TK_FONT_H
+
+#include "def.h"
+#include "reader.h"
+#include <memory>
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+struct stbtt_fontinfo;
+
+const u32 kGlyphAtlasSize = 1024;
+const u32 kGlyphCellSize = 48;
+const u32 kGlyphCellsPerRow = kGlyphAtlasSize / kGlyphCellSize;
+// Glyphs are rasterized once at this em size; the distance field is what keeps them
+// sharp when drawn larger or smaller.
+const f32 kGlyphSdfSize = 32.f;
+// Distance in pixels covered by the field on each side of the outline.
+const u32 kGlyphSdfPadding = 6;
+// Layouts unused for this many frames are dropped.
+const u64 kTextLayoutRetainFrames = 120;
+
+// Glyph quad relative to the text origin, in ems with y up.
+struct tkGlyphQuad
+{
+  u32 Codepoint;
+  v2 Offset;
+  v2 Size;
+};
+
+struct tkTextLayout
+{
+  tkDArray<tkGlyphQuad> Glyphs;
+  u64 LastFrame = 0;
+};
+
+// Signed distance field glyphs in a single R8 atlas of fixed size cells. Cells are
+// rasterized on first use and recycled least recently used first, so any amount of
+// text shares one texture. Layouts are cached per string and only reference
+// codepoints, so they stay valid when their glyphs are evicted.
+class tkGlyphCache
+{
+  struct tkCell
+  {
+    u32 Codepoint = 0;
+    u32 Width = 0;
+    u32 Height = 0;
+    u64 LastUsed = 0;
+  };
+
+  tkFileView mFontFile;
+  std::unique_ptr<stbtt_fontinfo> mFont;
+  f32 mScale = 0.f;
+  f32 mLineAdvance = 0.f;
+
+  wgpu::Texture mTexture;
+  wgpu::TextureView mView;
+  tkDArray<tkCell> mCells;
+  std::unordered_map<u32, u32> mLookup;
+  std::unordered_map<tkString, tkTextLayout> mLayouts;
+  u64 mFrame = 0;
+
+public:
+  tkGlyphCache();
+  ~tkGlyphCache();
+
+  void Setup(wgpu::Device& device);
+  bool LoadFont(const tkString& path);
+  [[nodiscard]] bool IsLoaded() const { return mScale > 0.f; }
+
+  void BeginFrame();
+  const tkTextLayout& GetLayout(const tkString& text);
+  // Atlas uv rect (min xy, max zw) of a glyph, rasterizing it on a miss. False when
+  // the glyph has no outline or every cell is already in use this frame.
+  bool GetGlyph(wgpu::Queue& queue, u32 codepoint, v4& uv);
+
+  [[nodiscard]] const wgpu::TextureView& GetView() const { return mView; }
+};
+
+#endif//TK_FONT_H
@@ -0,0 +1,158 @@
+#include "geometry.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+static bool IsStrip(wgpu::PrimitiveTopology topology)
+{
+  return topology == wgpu::PrimitiveTopology::LineStrip || topology == wgpu::PrimitiveTopology::TriangleStrip;
+}
+
+static u32 GetListPrimitiveSize(wgpu::PrimitiveTopology topology)
+{
+  switch (topology)
+  {
+    case wgpu::PrimitiveTopology::LineList: return 2;
+    case wgpu::PrimitiveTopology::TriangleList: return 3;
+    default: return 1;
+  }
+}
+
+static wgpu::Buffer CreateGeometryBuffer(wgpu::Device& device, const char* label, wgpu::BufferUsage usage, const void* data, u64 size)
+{
+  // Writes must be a multiple of 4 bytes.
+  const u64 alignedSize = (size + 3) & ~u64(3);
+  wgpu::BufferDescriptor desc{
+    .label = label,
+    .usage = usage | wgpu::BufferUsage::CopyDst,
+    .size = std::max<u64>(alignedSize, 4),
+  };
+  wgpu::Buffer buffer = device.CreateBuffer(&desc);
+  const u64 bodySize = size & ~u64(3);
+  device.GetQueue().WriteBuffer(buffer, 0, data, bodySize);
+  if (bodySize != size)
+  {
+    u32 tail = 0;
+    memcpy(&tail, static_cast<const u8*>(data) + bodySize, size - bodySize);
+    device.GetQueue().WriteBuffer(buffer, bodySize, &tail, sizeof(tail));
+  }
+  return buffer;
+}
+
+void tkIndexedGeometry::Upload(wgpu::Device& device, const char* label, std::span<const u8> vertices, u32 vertexStride,
+                               std::span<const u32> indices, wgpu::PrimitiveTopology topology, eIndexPreference preference)
+{
+  mBatches.clear();
+  mVertexBuffer = CreateGeometryBuffer(device, label, wgpu::BufferUsage::Vertex, vertices.data(), vertices.size());
+
+  // Below 64K vertices every index stays under the 16-bit restart value.
+  const u64 vertexCount = vertices.size() / vertexStride;
+  tkDArray<u16> compact;
+  if (vertexCount <= kMaxCompactVertices)
+  {
+    compact.reserve(indices.size());
+    for (u32 index : indices)
+    {
+      compact.push_back(index == kGeometryRestartIndex ? u16(0xFFFF) : static_cast<u16>(index));
+    }
+    mBatches.push_back({0, static_cast<u32>(indices.size()), 0});
+  }
+  else if (preference == eIndexPreference::Compact && !SplitCompact(indices, topology, compact))
+  {
+    tkLogWarning("IndexedGeometry: %s has a strip spanning more than 64K vertices, using 32-bit indices", label);
+    compact.clear();
+    mBatches.clear();
+  }
+
+  if (!mBatches.empty())
+  {
+    mFormat = wgpu::IndexFormat::Uint16;
+    mIndexBuffer = CreateGeometryBuffer(device, label, wgpu::BufferUsage::Index, compact.data(), compact.size() * sizeof(u16));
+    return;
+  }
+
+  mFormat = wgpu::IndexFormat::Uint32;
+  mIndexBuffer = CreateGeometryBuffer(device, label, wgpu::BufferUsage::Index, indices.data(), indices.size_bytes());
+  mBatches.push_back({0, static_cast<u32>(indices.size()), 0});
+}
+
+bool tkIndexedGeometry::SplitCompact(std::span<const u32> indices, wgpu::PrimitiveTopology topology, tkDArray<u16>& compact)
+{
+  compact.reserve(indices.size());
+  const bool strip = IsStrip(topology);
+  const u32 listSize = GetListPrimitiveSize(topology);
+
+  u32 batchStart = 0;
+  u32 batchMin = ~0u;
+  u32 batchMax = 0;
+  auto flush = [&](u32 end) {
+    for (u32 i = batchStart; i < end; i++)
+    {
+      compact.push_back(indices[i] == kGeometryRestartIndex ? u16(0xFFFF) : static_cast<u16>(indices[i] - batchMin));
+    }
+    mBatches.push_back({batchStart, end - batchStart, static_cast<i32>(batchMin)});
+  };
+
+  // Batches are only split between primitives: at restarts for strips, every
+  // primitive for lists.
+  for (u32 unitStart = 0; unitStart < indices.size();)
+  {
+    u32 unitEnd = unitStart;
+    u32 unitMin = ~0u;
+    u32 unitMax = 0;
+    for (u32 n = 0; unitEnd < indices.size() && (strip || n < listSize); unitEnd++, n++)
+    {
+      const u32 index = indices[unitEnd];
+      if (index == kGeometryRestartIndex)
+      {
+        if (strip)
+        {
+          unitEnd++;
+          break;
+        }
+        continue;
+      }
+      unitMin = std::min(unitMin, index);
+      unitMax = std::max(unitMax, index);
+    }
+
+    if (unitMin != ~0u)
+    {
+      if (unitMax - unitMin >= kMaxCompactVertices)
+      {
+        return false;
+      }
+      if (batchMin != ~0u && std::max(batchMax, unitMax) - std::min(batchMin, unitMin) >= kMaxCompactVertices)
+      {
+        flush(unitStart);
+        batchStart = unitStart;
+        batchMin = ~0u;
+        batchMax = 0;
+      }
+      batchMin = std::min(batchMin, unitMin);
+      batchMax = std::max(batchMax, unitMax);
+    }
+    unitStart = unitEnd;
+  }
+
+  if (batchMin != ~0u)
+  {
+    flush(static_cast<u32>(indices.size()));
+  }
+  return true;
+}
+
+void tkIndexedGeometry::Draw(wgpu::RenderPassEncoder& pass) const
+{
+  if (!mIndexBuffer)
+  {
+    return;
+  }
+
+  pass.SetVertexBuffer(0, mVertexBuffer);
+  pass.SetIndexBuffer(mIndexBuffer, mFormat);
+  for (const tkGeometryBatch& batch : mBatches)
+  {
+    pass.DrawIndexed(batch.IndexCount, 1, batch.FirstIndex, batch.BaseVertex, 0);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef TK_GEOMETRY_H
+#define TK_GEOMETRY_H
+
+#include "def.h"
+#include <span>
+#include <webgpu/webgpu_cpp.h>
+
+// Ends a strip in the indices given to tkIndexedGeometry, whatever format is uploaded.
+const u32 kGeometryRestartIndex = 0xFFFFFFFF;
+const u32 kMaxCompactVertices = 0xFFFF;
+
+enum class eIndexPreference : u8
+{
+  // 16-bit when every index fits below the restart value, otherwise 32-bit in one draw.
+  Auto = 0,
+  // Always 16-bit, splitting into batches of at most 64K vertices with their own base
+  // vertex. Halves index bandwidth at the cost of a draw per batch.
+  Compact,
+};
+
+struct tkGeometryBatch
+{
+  u32 FirstIndex;
+  u32 IndexCount;
+  i32 BaseVertex;
+};
+
+// Vertex and index buffer pair with the index format chosen from the vertex count.
+// Strip restarts are rewritten to the restart value of the chosen format, so a real
+// vertex 65535 never ends a strip.
+class tkIndexedGeometry
+{
+  wgpu::Buffer mVertexBuffer;
+  wgpu::Buffer mIndexBuffer;
+  wgpu::IndexFormat mFormat = wgpu::IndexFormat::Uint16;
+  tkDArray<tkGeometryBatch> mBatches;
+
+public:
+  void Upload(wgpu::Device& device, const char* label, std::span<const u8> vertices, u32 vertexStride,
+              std::span<const u32> indices, wgpu::PrimitiveTopology topology, eIndexPreference preference = eIndexPreference::Auto);
+  void Draw(wgpu::RenderPassEncoder& pass) const;
+
+  [[nodiscard]] wgpu::IndexFormat GetFormat() const { return mFormat; }
+  [[nodiscard]] const tkDArray<tkGeometryBatch>& GetBatches() const { return mBatches; }
+
+private:
+  bool SplitCompact(std::span<const u32> indices, wgpu::PrimitiveTopology topology, tkDArray<u16>& compact);
+};
+
+#endif//TK_GEOMETRY_H
@@ -0,0 +1,37 @@
+#include "gpuMirror.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+void tkGpuPagedBuffer::Sync(wgpu::Device& device, std::span<const void* const> pages, u64 size)
+{
+  // Storage bindings cannot be empty, so the buffer always holds at least one page.
+  const u64 capacity = std::bit_ceil(std::max<u64>(pages.size(), 1)) * mPageBytes;
+  if (capacity > GetBufferSize())
+  {
+    wgpu::BufferDescriptor desc{
+      .label = mLabel,
+      .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+      .size = capacity,
+    };
+    mBuffer = device.CreateBuffer(&desc);
+    // A fresh buffer has none of the old contents, so every page counts as changed.
+    mShadow.clear();
+  }
+
+  const u64 previousSize = mShadow.size();
+  mShadow.resize(size);
+  wgpu::Queue queue = device.GetQueue();
+  for (size_t page = 0; page < pages.size(); page++)
+  {
+    const u64 offset = page * mPageBytes;
+    const u64 bytes = std::min(mPageBytes, size - offset);
+    u8* shadow = mShadow.data() + offset;
+    if (offset + bytes <= previousSize && memcmp(shadow, pages[page], bytes) == 0)
+    {
+      continue;
+    }
+    memcpy(shadow, pages[page], bytes);
+    queue.WriteBuffer(mBuffer, offset, pages[page], bytes);
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef TK_GPU_MIRROR_H
+#define TK_GPU_MIRROR_H
+
+#include "def.h"
+#include "registry.h"
+#include <span>
+#include <webgpu/webgpu_cpp.h>
+
+// GPU copy of data held in fixed size CPU pages. Each sync compares every page with
+// what was last uploaded and only writes the pages that changed.
+class tkGpuPagedBuffer
+{
+  wgpu::Buffer mBuffer;
+  // Contents of the last upload, page for page.
+  tkDArray<u8> mShadow;
+  const char* mLabel;
+  u64 mPageBytes;
+
+public:
+  tkGpuPagedBuffer(const char* label, u64 pageBytes) : mLabel(label), mPageBytes(pageBytes) {}
+
+  void Sync(wgpu::Device& device, std::span<const void* const> pages, u64 size);
+
+  [[nodiscard]] const wgpu::Buffer& GetBuffer() const { return mBuffer; }
+  [[nodiscard]] u64 GetBufferSize() const { return mBuffer ? mBuffer.GetSize() : 0; }
+};
+
+// Storage buffer laid out exactly like the EnTT storage of C, so shaders can index it
+// with GetIndex(entity). EnTT packs components into fixed size pages and those pages
+// are uploaded straight from the registry's memory, without repacking entity by entity.
+// C must already match the layout the shader declares.
+template <typename C>
+class tkGpuMirror
+{
+  static_assert(sizeof(C) % 4 == 0, "buffer writes must be a multiple of 4 bytes");
+
+  tkGpuPagedBuffer mBuffer;
+  tkDArray<const void*> mPages;
+
+public:
+  explicit tkGpuMirror(const char* label) : mBuffer(label, entt::component_traits<C>::page_size * sizeof(C)) {}
+
+  void Sync(wgpu::Device& device)
+  {
+    auto& storage = tkRegistry::Get().storage<C>();
+    const u64 pageSize = entt::component_traits<C>::page_size;
+    const u64 pageCount = (storage.size() + pageSize - 1) / pageSize;
+    const auto pages = storage.raw();
+    mPages.clear();
+    for (u64 i = 0; i < pageCount; i++)
+    {
+      mPages.push_back(pages[i]);
+    }
+    mBuffer.Sync(device, mPages, storage.size() * sizeof(C));
+  }
+
+  // Only valid until the storage changes, i.e. for the frame it was synced in.
+  [[nodiscard]] u32 GetIndex(entt::entity entity) const { return static_cast<u32>(tkRegistry::Get().storage<C>().index(entity)); }
+  [[nodiscard]] const wgpu::Buffer& GetBuffer() const { return mBuffer.GetBuffer(); }
+  [[nodiscard]] u64 GetBufferSize() const { return mBuffer.GetBufferSize(); }
+};
+
+#endif//TK_GPU_MIRROR_H
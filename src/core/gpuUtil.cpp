@@ -0,0 +1,56 @@
+#include "gpuUtil.h"
+
+const wgpu::BlendState kAlphaBlendState{
+  .color = {
+    .operation = wgpu::BlendOperation::Add,
+    .srcFactor = wgpu::BlendFactor::SrcAlpha,
+    .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha,
+  },
+  .alpha = {
+    .operation = wgpu::BlendOperation::Add,
+    .srcFactor = wgpu::BlendFactor::One,
+    .dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha,
+  },
+};
+
+wgpu::BindGroupLayoutEntry tkBufferLayoutEntry(u32 binding, wgpu::ShaderStage visibility, wgpu::BufferBindingType type, bool dynamic)
+{
+  return wgpu::BindGroupLayoutEntry{
+    .binding = binding,
+    .visibility = visibility,
+    .buffer = {.type = type, .hasDynamicOffset = dynamic},
+  };
+}
+
+wgpu::Buffer tkCreateBuffer(wgpu::Device& device, const char* label, wgpu::BufferUsage usage, u64 size)
+{
+  wgpu::BufferDescriptor desc{
+    .label = label,
+    .usage = usage | wgpu::BufferUsage::CopyDst,
+    .size = size,
+  };
+  return device.CreateBuffer(&desc);
+}
+
+wgpu::ComputePipeline tkCreateComputePipeline(wgpu::Device& device, const char* label, std::span<const wgpu::BindGroupLayout> layouts,
+                                              const wgpu::ShaderModule& module, const char* entryPoint)
+{
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+    .bindGroupLayoutCount = layouts.size(),
+    .bindGroupLayouts = layouts.data(),
+  };
+  wgpu::ComputePipelineDescriptor desc{
+    .label = label,
+    .layout = device.CreatePipelineLayout(&pipelineLayoutDesc),
+    .compute = {.module = module, .entryPoint = entryPoint},
+  };
+  return device.CreateComputePipeline(&desc);
+}
+
+wgpu::ColorTargetState tkAlphaBlendTarget()
+{
+  return wgpu::ColorTargetState{
+    .format = wgpu::TextureFormat::BGRA8Unorm,
+    .blend = &kAlphaBlendState,
+  };
+}
@@ -0,0 +1,21 @@
+#ifndef TK_GPU_UTIL_H
+#define TK_GPU_UTIL_H
+
+#include "def.h"
+#include <span>
+#include <webgpu/webgpu_cpp.h>
+
+// Straight alpha over the frame, keeping destination alpha coverage.
+extern const wgpu::BlendState kAlphaBlendState;
+
+[[nodiscard]] wgpu::BindGroupLayoutEntry tkBufferLayoutEntry(u32 binding, wgpu::ShaderStage visibility, wgpu::BufferBindingType type,
+                                                             bool dynamic = false);
+// Always CopyDst on top of usage, every buffer here is filled from the queue.
+[[nodiscard]] wgpu::Buffer tkCreateBuffer(wgpu::Device& device, const char* label, wgpu::BufferUsage usage, u64 size);
+[[nodiscard]] wgpu::ComputePipeline tkCreateComputePipeline(wgpu::Device& device, const char* label, std::span<const wgpu::BindGroupLayout> layouts,
+                                                            const wgpu::ShaderModule& module, const char* entryPoint);
+
+// Swap chain target blended with kAlphaBlendState, see tkRenderer::GetBlendedDepthState.
+[[nodiscard]] wgpu::ColorTargetState tkAlphaBlendTarget();
+
+#endif//TK_GPU_UTIL_H
@@ -0,0 +1,16 @@
+#ifndef TK_HASH_H
+#define TK_HASH_H
+
+#include "def.h"
+
+const u64 kHashOffsetBasis = 0xcbf29ce484222325ull;
+const u64 kHashPrime = 0x100000001b3ull;
+
+// FNV-1a step. Start from kHashOffsetBasis and mix in one byte or word at a time.
+inline void tkHashWord(u64& hash, u64 word)
+{
+  hash ^= word;
+  hash *= kHashPrime;
+}
+
+#endif//TK_HASH_H
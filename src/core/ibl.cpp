@@ -0,0 +1,393 @@
+#include "ibl.h"
+#include "texture.h"
+#include "renderer.h"
+#include "reader.h"
+#include "pack.h"
+#include "logger.h"
+#include "stb_image.h"
+#include "meshoptimizer.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+const u32 kIblWorkgroupSize = 8;
+const u32 kIrradianceSampleCount = 512;
+const u32 kPrefilterSampleCount = 256;
+const u32 kBrdfLutSampleCount = 1024;
+const u32 kTexelBytes = 4 * sizeof(u16);
+// minUniformBufferOffsetAlignment, one params slot per dispatch.
+const u32 kParamsStride = 256;
+
+// Texture subresources in cache order.
+static tkDArray<tkTextureRegion> GetRegions(const wgpu::Texture& irradiance, const wgpu::Texture& prefilter, const wgpu::Texture& lut)
+{
+  tkDArray<tkTextureRegion> regions;
+  regions.push_back({irradiance, 0, irradiance.GetWidth(), irradiance.GetWidth(), 6});
+  for (u32 mip = 0; mip < prefilter.GetMipLevelCount(); mip++)
+  {
+    const u32 size = std::max(prefilter.GetWidth() >> mip, 1u);
+    regions.push_back({prefilter, mip, size, size, 6});
+  }
+  regions.push_back({lut, 0, lut.GetWidth(), lut.GetWidth(), 1});
+  return regions;
+}
+
+static wgpu::Texture CreateCubeTexture(wgpu::Device& device, const char* label, u32 size, u32 mips, wgpu::TextureUsage usage)
+{
+  wgpu::TextureDescriptor desc{
+    .label = label,
+    .usage = usage,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {size, size, 6},
+    .format = wgpu::TextureFormat::RGBA16Float,
+    .mipLevelCount = mips,
+    .sampleCount = 1,
+  };
+  return device.CreateTexture(&desc);
+}
+
+static wgpu::TextureView CreateArrayView(const wgpu::Texture& texture, u32 mip)
+{
+  wgpu::TextureViewDescriptor desc{
+    .format = wgpu::TextureFormat::RGBA16Float,
+    .dimension = wgpu::TextureViewDimension::e2DArray,
+    .baseMipLevel = mip,
+    .mipLevelCount = 1,
+    .baseArrayLayer = 0,
+    .arrayLayerCount = 6,
+  };
+  return texture.CreateView(&desc);
+}
+
+static wgpu::TextureView CreateCubeView(const wgpu::Texture& texture)
+{
+  wgpu::TextureViewDescriptor desc{
+    .format = wgpu::TextureFormat::RGBA16Float,
+    .dimension = wgpu::TextureViewDimension::Cube,
+    .baseMipLevel = 0,
+    .mipLevelCount = texture.GetMipLevelCount(),
+    .baseArrayLayer = 0,
+    .arrayLayerCount = 6,
+  };
+  return texture.CreateView(&desc);
+}
+
+static wgpu::ComputePipeline CreatePipeline(wgpu::Device& device, wgpu::ShaderModule module, const char* entryPoint)
+{
+  wgpu::ComputePipelineDescriptor desc{
+    .label = entryPoint,
+    .compute = {.module = module, .entryPoint = entryPoint},
+  };
+  return device.CreateComputePipeline(&desc);
+}
+
+static void Dispatch(wgpu::Device& device, wgpu::ComputePassEncoder& pass, const wgpu::ComputePipeline& pipeline,
+                     std::span<const wgpu::BindGroupEntry> entries, u32 size, u32 layers)
+{
+  wgpu::BindGroupDescriptor desc{
+    .layout = pipeline.GetBindGroupLayout(0),
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  const u32 groups = (size + kIblWorkgroupSize - 1) / kIblWorkgroupSize;
+  pass.SetPipeline(pipeline);
+  pass.SetBindGroup(0, device.CreateBindGroup(&desc));
+  pass.DispatchWorkgroups(groups, groups, layers);
+}
+
+void tkImageBasedLighting::Setup(wgpu::Device& device, wgpu::ShaderModule module)
+{
+  mEquirectPipeline = CreatePipeline(device, module, "cs_equirect_to_cube");
+  mDownsamplePipeline = CreatePipeline(device, module, "cs_downsample");
+  mIrradiancePipeline = CreatePipeline(device, module, "cs_irradiance");
+  mPrefilterPipeline = CreatePipeline(device, module, "cs_prefilter");
+  mBrdfLutPipeline = CreatePipeline(device, module, "cs_brdf_lut");
+
+  wgpu::SamplerDescriptor samplerDesc{
+    .label = "IBL",
+    .addressModeU = wgpu::AddressMode::ClampToEdge,
+    .addressModeV = wgpu::AddressMode::ClampToEdge,
+    .addressModeW = wgpu::AddressMode::ClampToEdge,
+    .magFilter = wgpu::FilterMode::Linear,
+    .minFilter = wgpu::FilterMode::Linear,
+    .mipmapFilter = wgpu::MipmapFilterMode::Linear,
+  };
+  mSampler = tkRenderer::Get().GetSampler(samplerDesc);
+
+  auto textureEntry = [](u32 binding, wgpu::TextureViewDimension dimension) {
+    return wgpu::BindGroupLayoutEntry{
+      .binding = binding,
+      .visibility = wgpu::ShaderStage::Fragment,
+      .texture = {.sampleType = wgpu::TextureSampleType::Float, .viewDimension = dimension},
+    };
+  };
+  const tkArray<wgpu::BindGroupLayoutEntry, 4> entries = {
+    wgpu::BindGroupLayoutEntry{.binding = 0, .visibility = wgpu::ShaderStage::Fragment, .sampler = {.type = wgpu::SamplerBindingType::Filtering}},
+    textureEntry(1, wgpu::TextureViewDimension::Cube),
+    textureEntry(2, wgpu::TextureViewDimension::Cube),
+    textureEntry(3, wgpu::TextureViewDimension::e2D),
+  };
+  wgpu::BindGroupLayoutDescriptor layoutDesc{.label = "IBL Shading", .entryCount = entries.size(), .entries = entries.data()};
+  mShadingLayout = device.CreateBindGroupLayout(&layoutDesc);
+
+  // Flat ambient until an environment is loaded: constant irradiance and radiance, and a
+  // LUT that passes F0 through unchanged.
+  CreateTextures(device, 1, 1, 1, 1);
+  const u16 ambient = meshopt_quantizeHalf(0.03f);
+  const u16 one = meshopt_quantizeHalf(1.f);
+  const tkArray<u16, 6 * 4> faces = {
+    ambient, ambient, ambient, one, ambient, ambient, ambient, one, ambient, ambient, ambient, one,
+    ambient, ambient, ambient, one, ambient, ambient, ambient, one, ambient, ambient, ambient, one,
+  };
+  const tkArray<u16, 4> lut = {one, 0, 0, one};
+
+  wgpu::Queue queue = device.GetQueue();
+  wgpu::TextureDataLayout layout{.bytesPerRow = kTexelBytes, .rowsPerImage = 1};
+  wgpu::Extent3D cubeSize{1, 1, 6};
+  wgpu::Extent3D lutSize{1, 1, 1};
+  wgpu::ImageCopyTexture irradiance{.texture = mIrradianceTexture};
+  wgpu::ImageCopyTexture prefilter{.texture = mPrefilterTexture};
+  wgpu::ImageCopyTexture brdf{.texture = mBrdfLutTexture};
+  queue.WriteTexture(&irradiance, faces.data(), sizeof(faces), &layout, &cubeSize);
+  queue.WriteTexture(&prefilter, faces.data(), sizeof(faces), &layout, &cubeSize);
+  queue.WriteTexture(&brdf, lut.data(), sizeof(lut), &layout, &lutSize);
+  CreateShadingBindGroup(device);
+}
+
+bool tkImageBasedLighting::LoadEnvironment(wgpu::Device& device, const tkString& path)
+{
+  if (LoadCache(device, path))
+  {
+    CreateShadingBindGroup(device);
+    return true;
+  }
+
+  tkFileView file = tkReader::MapBinaryFile(path);
+  if (!file.IsValid())
+  {
+    tkLogWarning("IBL: Failed to read environment %s", path.c_str());
+    return false;
+  }
+
+  i32 width = 0;
+  i32 height = 0;
+  i32 channels = 0;
+  std::span<const u8> bytes = file.GetBytes();
+  f32* pixels = stbi_loadf_from_memory(bytes.data(), static_cast<i32>(bytes.size()), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    tkLogWarning("IBL: Failed to decode environment %s", path.c_str());
+    return false;
+  }
+
+  // Half floats keep the source filterable; rgba32float would need an extra feature.
+  const size_t texelCount = static_cast<size_t>(width) * height * 4;
+  tkDArray<u16> halfs(texelCount);
+  for (size_t i = 0; i < texelCount; i++)
+  {
+    halfs[i] = meshopt_quantizeHalf(pixels[i]);
+  }
+  stbi_image_free(pixels);
+
+  wgpu::TextureDescriptor equirectDesc{
+    .label = path.c_str(),
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {static_cast<u32>(width), static_cast<u32>(height), 1},
+    .format = wgpu::TextureFormat::RGBA16Float,
+    .mipLevelCount = 1,
+    .sampleCount = 1,
+  };
+  wgpu::Texture equirect = device.CreateTexture(&equirectDesc);
+  wgpu::ImageCopyTexture destination{.texture = equirect};
+  wgpu::TextureDataLayout layout{.bytesPerRow = static_cast<u32>(width) * kTexelBytes, .rowsPerImage = static_cast<u32>(height)};
+  device.GetQueue().WriteTexture(&destination, halfs.data(), halfs.size() * sizeof(u16), &layout, &equirectDesc.size);
+
+  CreateTextures(device, kIrradianceCubeSize, kPrefilterCubeSize, kPrefilterMipCount, kBrdfLutSize);
+
+  wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+  Generate(device, encoder, equirect.CreateView());
+  WriteCache(device, encoder, path);
+  CreateShadingBindGroup(device);
+  return true;
+}
+
+void tkImageBasedLighting::CreateTextures(wgpu::Device& device, u32 irradianceSize, u32 prefilterSize, u32 prefilterMips, u32 lutSize)
+{
+  const wgpu::TextureUsage usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::StorageBinding |
+                                   wgpu::TextureUsage::CopySrc | wgpu::TextureUsage::CopyDst;
+  mIrradianceTexture = CreateCubeTexture(device, "IBL Irradiance", irradianceSize, 1, usage);
+  mPrefilterTexture = CreateCubeTexture(device, "IBL Prefiltered", prefilterSize, prefilterMips, usage);
+
+  wgpu::TextureDescriptor lutDesc{
+    .label = "IBL BRDF LUT",
+    .usage = usage,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {lutSize, lutSize, 1},
+    .format = wgpu::TextureFormat::RGBA16Float,
+    .mipLevelCount = 1,
+    .sampleCount = 1,
+  };
+  mBrdfLutTexture = device.CreateTexture(&lutDesc);
+}
+
+void tkImageBasedLighting::CreateShadingBindGroup(wgpu::Device& device)
+{
+  const tkArray<wgpu::BindGroupEntry, 4> entries = {{
+    {.binding = 0, .sampler = mSampler},
+    {.binding = 1, .textureView = CreateCubeView(mIrradianceTexture)},
+    {.binding = 2, .textureView = CreateCubeView(mPrefilterTexture)},
+    {.binding = 3, .textureView = tkRenderer::Get().GetTextureView(mBrdfLutTexture)},
+  }};
+  wgpu::BindGroupDescriptor desc{.label = "IBL Shading", .layout = mShadingLayout, .entryCount = entries.size(), .entries = entries.data()};
+  mShadingBindGroup = device.CreateBindGroup(&desc);
+}
+
+void tkImageBasedLighting::Generate(wgpu::Device& device, wgpu::CommandEncoder& encoder, const wgpu::TextureView& equirect)
+{
+  const u32 environmentMips = std::bit_width(kEnvironmentCubeSize);
+  wgpu::Texture environment = CreateCubeTexture(device, "IBL Environment", kEnvironmentCubeSize, environmentMips,
+                                                wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::StorageBinding);
+  wgpu::TextureView environmentView = CreateCubeView(environment);
+
+  // Slot 0 irradiance, 1..kPrefilterMipCount prefilter mips, last the LUT.
+  tkDArray<tkIblFilterParams> params;
+  params.push_back({0.f, static_cast<f32>(kEnvironmentCubeSize), kIrradianceSampleCount});
+  for (u32 mip = 0; mip < kPrefilterMipCount; mip++)
+  {
+    const f32 roughness = static_cast<f32>(mip) / static_cast<f32>(kPrefilterMipCount - 1);
+    params.push_back({roughness, static_cast<f32>(kEnvironmentCubeSize), mip == 0 ? 1 : kPrefilterSampleCount});
+  }
+  params.push_back({0.f, 0.f, kBrdfLutSampleCount});
+
+  wgpu::BufferDescriptor paramsDesc{
+    .label = "IBL Params",
+    .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+    .size = params.size() * kParamsStride,
+  };
+  wgpu::Buffer paramsBuffer = device.CreateBuffer(&paramsDesc);
+  for (u32 i = 0; i < params.size(); i++)
+  {
+    device.GetQueue().WriteBuffer(paramsBuffer, i * kParamsStride, &params[i], sizeof(tkIblFilterParams));
+  }
+  auto paramsEntry = [&](u32 slot) {
+    return wgpu::BindGroupEntry{.binding = 6, .buffer = paramsBuffer, .offset = slot * kParamsStride, .size = sizeof(tkIblFilterParams)};
+  };
+
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+
+  const tkArray<wgpu::BindGroupEntry, 3> equirectEntries = {{
+    {.binding = 0, .sampler = mSampler},
+    {.binding = 1, .textureView = equirect},
+    {.binding = 4, .textureView = CreateArrayView(environment, 0)},
+  }};
+  Dispatch(device, pass, mEquirectPipeline, equirectEntries, kEnvironmentCubeSize, 6);
+
+  // Box filtered mip chain for filtered importance sampling.
+  for (u32 mip = 1; mip < environmentMips; mip++)
+  {
+    const tkArray<wgpu::BindGroupEntry, 2> downsampleEntries = {{
+      {.binding = 3, .textureView = CreateArrayView(environment, mip - 1)},
+      {.binding = 4, .textureView = CreateArrayView(environment, mip)},
+    }};
+    Dispatch(device, pass, mDownsamplePipeline, downsampleEntries, kEnvironmentCubeSize >> mip, 6);
+  }
+
+  const tkArray<wgpu::BindGroupEntry, 4> irradianceEntries = {
+    wgpu::BindGroupEntry{.binding = 0, .sampler = mSampler},
+    wgpu::BindGroupEntry{.binding = 2, .textureView = environmentView},
+    wgpu::BindGroupEntry{.binding = 4, .textureView = CreateArrayView(mIrradianceTexture, 0)},
+    paramsEntry(0),
+  };
+  Dispatch(device, pass, mIrradiancePipeline, irradianceEntries, mIrradianceTexture.GetWidth(), 6);
+
+  for (u32 mip = 0; mip < kPrefilterMipCount; mip++)
+  {
+    const tkArray<wgpu::BindGroupEntry, 4> prefilterEntries = {
+      wgpu::BindGroupEntry{.binding = 0, .sampler = mSampler},
+      wgpu::BindGroupEntry{.binding = 2, .textureView = environmentView},
+      wgpu::BindGroupEntry{.binding = 4, .textureView = CreateArrayView(mPrefilterTexture, mip)},
+      paramsEntry(1 + mip),
+    };
+    Dispatch(device, pass, mPrefilterPipeline, prefilterEntries, mPrefilterTexture.GetWidth() >> mip, 6);
+  }
+
+  const tkArray<wgpu::BindGroupEntry, 2> lutEntries = {
+    wgpu::BindGroupEntry{.binding = 5, .textureView = tkRenderer::Get().GetTextureView(mBrdfLutTexture)},
+    paramsEntry(static_cast<u32>(params.size() - 1)),
+  };
+  Dispatch(device, pass, mBrdfLutPipeline, lutEntries, mBrdfLutTexture.GetWidth(), 1);
+
+  pass.End();
+}
+
+void tkImageBasedLighting::WriteCache(wgpu::Device& device, wgpu::CommandEncoder& encoder, const tkString& path)
+{
+  tkIblCacheHeader header{
+    .Magic = kIblCacheMagic,
+    .Version = kIblCacheVersion,
+    .IrradianceSize = mIrradianceTexture.GetWidth(),
+    .PrefilterSize = mPrefilterTexture.GetWidth(),
+    .PrefilterMipCount = mPrefilterTexture.GetMipLevelCount(),
+    .BrdfLutSize = mBrdfLutTexture.GetWidth(),
+  };
+  tkReader::GetFileStamp(path, header.SourceSize, header.SourceTime);
+
+  tkTextureImporter::WriteRegions(device, encoder, tkReader::ResolvePath(GetCachePath(path)),
+                                  std::span(reinterpret_cast<const u8*>(&header), sizeof(header)),
+                                  GetRegions(mIrradianceTexture, mPrefilterTexture, mBrdfLutTexture), kTexelBytes, "IBL Readback");
+}
+
+bool tkImageBasedLighting::LoadCache(wgpu::Device& device, const tkString& path)
+{
+  tkFileView file = tkReader::MapBinaryFile(GetCachePath(path));
+  if (!file.IsValid() || file.GetSize() < sizeof(tkIblCacheHeader))
+  {
+    return false;
+  }
+
+  tkIblCacheHeader header;
+  memcpy(&header, file.GetBytes().data(), sizeof(header));
+  u64 size;
+  i64 time;
+  tkReader::GetFileStamp(path, size, time);
+  if (header.Magic != kIblCacheMagic || header.Version != kIblCacheVersion ||
+      header.SourceSize != size || header.SourceTime != time)
+  {
+    return false;
+  }
+
+  CreateTextures(device, header.IrradianceSize, header.PrefilterSize, header.PrefilterMipCount, header.BrdfLutSize);
+  tkDArray<tkTextureRegion> regions = GetRegions(mIrradianceTexture, mPrefilterTexture, mBrdfLutTexture);
+
+  u64 expected = sizeof(header);
+  for (const tkTextureRegion& region : regions)
+  {
+    expected += static_cast<u64>(region.Width) * region.Height * region.Layers * kTexelBytes;
+  }
+  if (file.GetSize() != expected)
+  {
+    tkLogWarning("IBL: Cache for %s is truncated", path.c_str());
+    return false;
+  }
+
+  wgpu::Queue queue = device.GetQueue();
+  u64 offset = sizeof(header);
+  for (const tkTextureRegion& region : regions)
+  {
+    const u64 bytes = static_cast<u64>(region.Width) * region.Height * region.Layers * kTexelBytes;
+    wgpu::ImageCopyTexture destination{.texture = region.Texture, .mipLevel = region.Mip};
+    wgpu::TextureDataLayout layout{.bytesPerRow = region.Width * kTexelBytes, .rowsPerImage = region.Height};
+    wgpu::Extent3D extent{region.Width, region.Height, region.Layers};
+    queue.WriteTexture(&destination, file.GetBytes().data() + offset, bytes, &layout, &extent);
+    offset += bytes;
+  }
+  return true;
+}
+
+tkString tkImageBasedLighting::GetCachePath(const tkString& path)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(tkPack::HashPath(path)));
+  return tkString("cache/") + name + ".tkibl";
+}
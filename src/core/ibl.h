@@ -0,0 +1,77 @@
+#ifndef TK_IBL_H
+#define TK_IBL_H
+
+#include "def.h"
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kEnvironmentCubeSize = 512;
+const u32 kIrradianceCubeSize = 32;
+const u32 kPrefilterCubeSize = 128;
+const u32 kPrefilterMipCount = 5;
+const u32 kBrdfLutSize = 256;
+
+const u32 kIblCacheMagic = 0x42494B54; // "TKIB"
+const u32 kIblCacheVersion = 1;
+
+// Followed by the irradiance faces, every prefiltered mip and the BRDF LUT as tightly
+// packed rgba16float texels.
+struct tkIblCacheHeader
+{
+  u32 Magic;
+  u32 Version;
+  u64 SourceSize;
+  i64 SourceTime;
+  u32 IrradianceSize;
+  u32 PrefilterSize;
+  u32 PrefilterMipCount;
+  u32 BrdfLutSize;
+};
+
+// Matches FilterParams in ibl.wgsl.
+struct tkIblFilterParams
+{
+  f32 Roughness;
+  f32 SourceSize;
+  u32 SampleCount;
+  u32 Padding;
+};
+
+// Split-sum image based lighting. LoadEnvironment convolves an equirectangular HDR into
+// an irradiance cube, GGX prefiltered specular mips and a BRDF LUT on the GPU once, and
+// caches the results under cache/ so later runs only upload them. Until an environment
+// is loaded the shading group holds a flat dim ambient.
+class tkImageBasedLighting
+{
+  wgpu::ComputePipeline mEquirectPipeline;
+  wgpu::ComputePipeline mDownsamplePipeline;
+  wgpu::ComputePipeline mIrradiancePipeline;
+  wgpu::ComputePipeline mPrefilterPipeline;
+  wgpu::ComputePipeline mBrdfLutPipeline;
+
+  wgpu::Sampler mSampler;
+  wgpu::BindGroupLayout mShadingLayout;
+  wgpu::BindGroup mShadingBindGroup;
+
+  wgpu::Texture mIrradianceTexture;
+  wgpu::Texture mPrefilterTexture;
+  wgpu::Texture mBrdfLutTexture;
+
+public:
+  void Setup(wgpu::Device& device, wgpu::ShaderModule module);
+  bool LoadEnvironment(wgpu::Device& device, const tkString& path);
+
+  [[nodiscard]] const wgpu::BindGroupLayout& GetBindGroupLayout() const { return mShadingLayout; }
+  [[nodiscard]] const wgpu::BindGroup& GetBindGroup() const { return mShadingBindGroup; }
+
+private:
+  void CreateTextures(wgpu::Device& device, u32 irradianceSize, u32 prefilterSize, u32 prefilterMips, u32 lutSize);
+  void CreateShadingBindGroup(wgpu::Device& device);
+
+  void Generate(wgpu::Device& device, wgpu::CommandEncoder& encoder, const wgpu::TextureView& equirect);
+  void WriteCache(wgpu::Device& device, wgpu::CommandEncoder& encoder, const tkString& path);
+  bool LoadCache(wgpu::Device& device, const tkString& path);
+
+  static tkString GetCachePath(const tkString& path);
+};
+
+#endif//TK_IBL_H
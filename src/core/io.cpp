@@ -0,0 +1,413 @@
+#include "io.h"
+#include "reader.h"
+#include "pack.h"
+#include "logger.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(TK_HAS_IO_URING)
+#include <liburing.h>
+#endif
+
+const u32 kIOWorkerCount = 4;
+const u32 kIOUringDepth = 64;
+const u32 kIOSyncReadsPerPump = 4;
+
+void tkIOHandle::Cancel() const
+{
+  if (mRequest)
+  {
+    mRequest->bCancelled = true;
+  }
+}
+
+#if defined(_WIN32)
+static bool ReadFileRange(const tkString& path, u64 offset, u64 size, tkDArray<u8>& out)
+{
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return false;
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || offset > static_cast<u64>(fileSize.QuadPart))
+  {
+    CloseHandle(file);
+    return false;
+  }
+  if (size == 0)
+  {
+    size = static_cast<u64>(fileSize.QuadPart) - offset;
+  }
+
+  out.resize(size);
+  u64 done = 0;
+  while (done < size)
+  {
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset + done);
+    overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+    DWORD read = 0;
+    const DWORD chunk = static_cast<DWORD>(std::min<u64>(size - done, 1u << 30));
+    if (!ReadFile(file, out.data() + done, chunk, &read, &overlapped) || read == 0)
+    {
+      break;
+    }
+    done += read;
+  }
+  CloseHandle(file);
+  out.resize(done);
+  return done == size;
+}
+#else
+static bool ReadFileRange(const tkString& path, u64 offset, u64 size, tkDArray<u8>& out)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || offset > static_cast<u64>(st.st_size))
+  {
+    close(fd);
+    return false;
+  }
+  if (size == 0)
+  {
+    size = static_cast<u64>(st.st_size) - offset;
+  }
+
+  out.resize(size);
+  u64 done = 0;
+  while (done < size)
+  {
+    const ssize_t read = pread(fd, out.data() + done, size - done, static_cast<off_t>(offset + done));
+    if (read <= 0)
+    {
+      break;
+    }
+    done += static_cast<u64>(read);
+  }
+  close(fd);
+  out.resize(done);
+  return done == size;
+}
+#endif
+
+tkIOService& tkIOService::Get()
+{
+  static tkIOService instance;
+  return instance;
+}
+
+tkIOService::tkIOService()
+{
+#if defined(TK_HAS_IO_URING)
+  mWorkers.emplace_back(&tkIOService::UringMain, this);
+#elif !defined(__EMSCRIPTEN__)
+  const u32 count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, kIOWorkerCount);
+  for (u32 i = 0; i < count; i++)
+  {
+    mWorkers.emplace_back(&tkIOService::WorkerMain, this);
+  }
+#endif
+}
+
+tkIOService::~tkIOService()
+{
+  {
+    std::lock_guard lock(mMutex);
+    bStop = true;
+  }
+  mCondition.notify_all();
+  for (std::thread& worker : mWorkers)
+  {
+    worker.join();
+  }
+}
+
+tkIOHandle tkIOService::Read(const tkString& path, eIOPriority priority, tkIOCallback callback, u64 offset, u64 size)
+{
+  auto request = std::make_shared<tkIORequest>();
+  request->Path = path;
+  request->Offset = offset;
+  request->Size = size;
+  request->Priority = priority;
+  request->Callback = std::move(callback);
+
+  {
+    std::lock_guard lock(mMutex);
+    request->Sequence = mSequence++;
+    mQueue.push(request);
+  }
+  mCondition.notify_one();
+  return tkIOHandle(std::move(request));
+}
+
+void tkIOService::Pump()
+{
+#if defined(__EMSCRIPTEN__)
+  // Preloaded files already live in memory, so the web build reads a few per frame inline.
+  for (u32 i = 0; i < kIOSyncReadsPerPump; i++)
+  {
+    std::shared_ptr<tkIORequest> request = PopRequest(false);
+    if (!request)
+    {
+      break;
+    }
+    Process(request);
+  }
+#endif
+
+  tkDArray<std::shared_ptr<tkIORequest>> completed;
+  {
+    std::lock_guard lock(mMutex);
+    completed.swap(mCompleted);
+  }
+
+  for (const std::shared_ptr<tkIORequest>& request : completed)
+  {
+    if (request->bCancelled)
+    {
+      request->Status = eIOStatus::Cancelled;
+      continue;
+    }
+    request->Callback(tkIOHandle(request));
+  }
+}
+
+std::shared_ptr<tkIORequest> tkIOService::PopRequest(bool wait)
+{
+  std::unique_lock lock(mMutex);
+  if (wait)
+  {
+    mCondition.wait(lock, [this] { return bStop || !mQueue.empty(); });
+  }
+  if (bStop || mQueue.empty())
+  {
+    return nullptr;
+  }
+
+  std::shared_ptr<tkIORequest> request = mQueue.top();
+  mQueue.pop();
+  return request;
+}
+
+void tkIOService::Complete(const std::shared_ptr<tkIORequest>& request, eIOStatus status)
+{
+  if (request->bCancelled)
+  {
+    status = eIOStatus::Cancelled;
+  }
+  if (status == eIOStatus::Failed)
+  {
+    tkLogWarning("IOService: Failed to read %s", request->Path.c_str());
+  }
+  if (status != eIOStatus::Completed)
+  {
+    request->Data.clear();
+  }
+
+  // Callbacks may inspect the status, so it is published before they are queued.
+  request->Status = status;
+  if (request->Callback && status != eIOStatus::Cancelled)
+  {
+    std::lock_guard lock(mMutex);
+    mCompleted.push_back(request);
+  }
+}
+
+void tkIOService::Process(const std::shared_ptr<tkIORequest>& request)
+{
+  if (request->bCancelled)
+  {
+    Complete(request, eIOStatus::Cancelled);
+    return;
+  }
+
+  if (ReadPacked(request))
+  {
+    return;
+  }
+
+  const bool success = ReadFileRange(tkReader::ResolvePath(request->Path), request->Offset, request->Size, request->Data);
+  Complete(request, success ? eIOStatus::Completed : eIOStatus::Failed);
+}
+
+bool tkIOService::ReadPacked(const std::shared_ptr<tkIORequest>& request)
+{
+  tkFileView packed = tkPack::Find(request->Path);
+  if (!packed.IsValid())
+  {
+    return false;
+  }
+
+  const u64 size = request->Size ? request->Size : packed.GetSize() - std::min<u64>(request->Offset, packed.GetSize());
+  if (request->Offset + size > packed.GetSize())
+  {
+    Complete(request, eIOStatus::Failed);
+    return true;
+  }
+
+  const u8* data = packed.GetBytes().data() + request->Offset;
+  request->Data.assign(data, data + size);
+  Complete(request, eIOStatus::Completed);
+  return true;
+}
+
+void tkIOService::WorkerMain()
+{
+  while (std::shared_ptr<tkIORequest> request = PopRequest(true))
+  {
+    Process(request);
+  }
+}
+
+#if defined(TK_HAS_IO_URING)
+void tkIOService::UringMain()
+{
+  io_uring ring;
+  if (io_uring_queue_init(kIOUringDepth, &ring, 0) != 0)
+  {
+    tkLogWarning("IOService: io_uring unavailable, falling back to a blocking worker");
+    WorkerMain();
+    return;
+  }
+
+  struct tkUringRead
+  {
+    std::shared_ptr<tkIORequest> Request;
+    int Fd = -1;
+    u64 Size = 0;
+    u64 Done = 0;
+  };
+
+  auto submitRead = [&ring](tkUringRead* read) {
+    io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_read(sqe, read->Fd, read->Request->Data.data() + read->Done,
+                       static_cast<unsigned>(std::min<u64>(read->Size - read->Done, 1u << 30)),
+                       read->Request->Offset + read->Done);
+    io_uring_sqe_set_data(sqe, read);
+  };
+
+  u32 inFlight = 0;
+  while (true)
+  {
+    tkDArray<std::shared_ptr<tkIORequest>> batch;
+    {
+      std::unique_lock lock(mMutex);
+      if (inFlight == 0)
+      {
+        mCondition.wait(lock, [this] { return bStop || !mQueue.empty(); });
+      }
+      if (bStop && inFlight == 0)
+      {
+        break;
+      }
+      while (!bStop && inFlight + batch.size() < kIOUringDepth && !mQueue.empty())
+      {
+        batch.push_back(mQueue.top());
+        mQueue.pop();
+      }
+    }
+
+    for (const std::shared_ptr<tkIORequest>& request : batch)
+    {
+      if (request->bCancelled)
+      {
+        Complete(request, eIOStatus::Cancelled);
+        continue;
+      }
+
+      if (ReadPacked(request))
+      {
+        continue;
+      }
+
+      int fd = open(tkReader::ResolvePath(request->Path).c_str(), O_RDONLY);
+      struct stat st{};
+      if (fd < 0 || fstat(fd, &st) != 0 || request->Offset > static_cast<u64>(st.st_size))
+      {
+        if (fd >= 0)
+        {
+          close(fd);
+        }
+        Complete(request, eIOStatus::Failed);
+        continue;
+      }
+
+      const u64 size = request->Size ? request->Size : static_cast<u64>(st.st_size) - request->Offset;
+      if (size == 0)
+      {
+        close(fd);
+        Complete(request, eIOStatus::Completed);
+        continue;
+      }
+
+      request->Data.resize(size);
+      submitRead(new tkUringRead{request, fd, size, 0});
+      inFlight++;
+    }
+    io_uring_submit(&ring);
+
+    if (inFlight == 0)
+    {
+      continue;
+    }
+
+    io_uring_cqe* cqe = nullptr;
+    if (io_uring_wait_cqe(&ring, &cqe) != 0)
+    {
+      continue;
+    }
+
+    bool resubmit = false;
+    while (cqe)
+    {
+      tkUringRead* read = static_cast<tkUringRead*>(io_uring_cqe_get_data(cqe));
+      const i32 result = cqe->res;
+      io_uring_cqe_seen(&ring, cqe);
+
+      if (result > 0)
+      {
+        read->Done += static_cast<u64>(result);
+      }
+      if (result > 0 && read->Done < read->Size && !read->Request->bCancelled)
+      {
+        submitRead(read);
+        resubmit = true;
+      }
+      else
+      {
+        close(read->Fd);
+        Complete(read->Request, read->Done == read->Size ? eIOStatus::Completed : eIOStatus::Failed);
+        delete read;
+        inFlight--;
+      }
+
+      if (io_uring_peek_cqe(&ring, &cqe) != 0)
+      {
+        cqe = nullptr;
+      }
+    }
+
+    if (resubmit)
+    {
+      io_uring_submit(&ring);
+    }
+  }
+
+  io_uring_queue_exit(&ring);
+}
+#endif
@@ -0,0 +1,113 @@
+#ifndef TK_IO_H
+#define TK_IO_H
+
+#include "def.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <string_view>
+#include <thread>
+
+enum class eIOPriority : u8
+{
+  Low = 0,
+  Normal,
+  High,
+  Critical,
+};
+
+enum class eIOStatus : u8
+{
+  Pending = 0,
+  Completed,
+  Failed,
+  Cancelled,
+};
+
+class tkIOHandle;
+using tkIOCallback = std::function<void(const tkIOHandle&)>;
+
+struct tkIORequest
+{
+  tkString Path;
+  u64 Offset = 0;
+  u64 Size = 0;
+  eIOPriority Priority = eIOPriority::Normal;
+  u64 Sequence = 0;
+  tkIOCallback Callback;
+  tkDArray<u8> Data;
+  std::atomic<eIOStatus> Status = eIOStatus::Pending;
+  std::atomic<bool> bCancelled = false;
+};
+
+class tkIOHandle
+{
+  std::shared_ptr<tkIORequest> mRequest;
+
+public:
+  tkIOHandle() = default;
+  explicit tkIOHandle(std::shared_ptr<tkIORequest> request) : mRequest(std::move(request)) {}
+
+  [[nodiscard]] bool IsValid() const { return mRequest != nullptr; }
+  [[nodiscard]] eIOStatus GetStatus() const { return mRequest ? mRequest->Status.load() : eIOStatus::Failed; }
+  [[nodiscard]] bool IsDone() const { return GetStatus() != eIOStatus::Pending; }
+  [[nodiscard]] const tkString& GetPath() const { return mRequest->Path; }
+
+  // Only valid once the status is Completed.
+  [[nodiscard]] std::span<const u8> GetData() const { return mRequest->Data; }
+  [[nodiscard]] std::string_view GetText() const { return {reinterpret_cast<const char*>(mRequest->Data.data()), mRequest->Data.size()}; }
+  [[nodiscard]] tkDArray<u8> TakeData() const { return std::move(mRequest->Data); }
+
+  void Cancel() const;
+};
+
+// Reads resource files off the main thread. Completion callbacks always run on the
+// main thread, from Pump.
+class tkIOService
+{
+  struct tkRequestOrder
+  {
+    bool operator()(const std::shared_ptr<tkIORequest>& a, const std::shared_ptr<tkIORequest>& b) const
+    {
+      if (a->Priority != b->Priority)
+      {
+        return a->Priority < b->Priority;
+      }
+      return a->Sequence > b->Sequence;
+    }
+  };
+
+  std::priority_queue<std::shared_ptr<tkIORequest>, tkDArray<std::shared_ptr<tkIORequest>>, tkRequestOrder> mQueue;
+  tkDArray<std::shared_ptr<tkIORequest>> mCompleted;
+  tkDArray<std::thread> mWorkers;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  u64 mSequence = 0;
+  bool bStop = false;
+
+public:
+  static tkIOService& Get();
+
+  tkIOHandle Read(const tkString& path, eIOPriority priority = eIOPriority::Normal, tkIOCallback callback = {}, u64 offset = 0, u64 size = 0);
+  void Pump();
+
+private:
+  tkIOService();
+  ~tkIOService();
+
+  std::shared_ptr<tkIORequest> PopRequest(bool wait);
+  void Complete(const std::shared_ptr<tkIORequest>& request, eIOStatus status);
+  void Process(const std::shared_ptr<tkIORequest>& request);
+  bool ReadPacked(const std::shared_ptr<tkIORequest>& request);
+
+  void WorkerMain();
+#if defined(TK_HAS_IO_URING)
+  void UringMain();
+#endif
+};
+
+#endif//TK_IO_H
@@ -0,0 +1,119 @@
+#include "lighting.h"
+#include "registry.h"
+#include "logger.h"
+#include "../components/light.h"
+#include "../components/transform3d.h"
+#include <algorithm>
+
+const u32 kLightBinWorkgroupSize = 64;
+
+void tkLightClusters::Setup(wgpu::Device& device, wgpu::ShaderModule module)
+{
+  wgpu::BufferDescriptor paramsDesc{
+    .label = "Light Params",
+    .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+    .size = sizeof(tkLightParams),
+  };
+  wgpu::BufferDescriptor lightDesc{
+    .label = "Lights",
+    .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+    .size = kMaxLights * sizeof(tkGpuLight),
+  };
+  wgpu::BufferDescriptor countDesc{
+    .label = "Light Cluster Counts",
+    .usage = wgpu::BufferUsage::Storage,
+    .size = kLightClusterCount * sizeof(u32),
+  };
+  wgpu::BufferDescriptor indexDesc{
+    .label = "Light Cluster Indices",
+    .usage = wgpu::BufferUsage::Storage,
+    .size = kLightClusterCount * kMaxLightsPerCluster * sizeof(u32),
+  };
+  mParamsBuffer = device.CreateBuffer(&paramsDesc);
+  mLightBuffer = device.CreateBuffer(&lightDesc);
+  mClusterCountBuffer = device.CreateBuffer(&countDesc);
+  mClusterLightBuffer = device.CreateBuffer(&indexDesc);
+
+  auto layoutEntry = [](u32 binding, wgpu::ShaderStage visibility, wgpu::BufferBindingType type) {
+    return wgpu::BindGroupLayoutEntry{.binding = binding, .visibility = visibility, .buffer = {.type = type}};
+  };
+  const tkArray<wgpu::BindGroupLayoutEntry, 4> binEntries = {
+    layoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform),
+    layoutEntry(1, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    layoutEntry(2, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    layoutEntry(3, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+  };
+  const tkArray<wgpu::BindGroupLayoutEntry, 4> shadingEntries = {
+    layoutEntry(0, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::Uniform),
+    layoutEntry(1, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::ReadOnlyStorage),
+    layoutEntry(2, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::ReadOnlyStorage),
+    layoutEntry(3, wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::ReadOnlyStorage),
+  };
+  wgpu::BindGroupLayoutDescriptor binLayoutDesc{.label = "Light Binning", .entryCount = binEntries.size(), .entries = binEntries.data()};
+  wgpu::BindGroupLayoutDescriptor shadingLayoutDesc{.label = "Light Shading", .entryCount = shadingEntries.size(), .entries = shadingEntries.data()};
+  mBinLayout = device.CreateBindGroupLayout(&binLayoutDesc);
+  mShadingLayout = device.CreateBindGroupLayout(&shadingLayoutDesc);
+
+  const tkArray<wgpu::BindGroupEntry, 4> entries = {{
+    {.binding = 0, .buffer = mParamsBuffer, .size = paramsDesc.size},
+    {.binding = 1, .buffer = mLightBuffer, .size = lightDesc.size},
+    {.binding = 2, .buffer = mClusterCountBuffer, .size = countDesc.size},
+    {.binding = 3, .buffer = mClusterLightBuffer, .size = indexDesc.size},
+  }};
+  wgpu::BindGroupDescriptor binDesc{.layout = mBinLayout, .entryCount = entries.size(), .entries = entries.data()};
+  wgpu::BindGroupDescriptor shadingDesc{.layout = mShadingLayout, .entryCount = entries.size(), .entries = entries.data()};
+  mBinBindGroup = device.CreateBindGroup(&binDesc);
+  mShadingBindGroup = device.CreateBindGroup(&shadingDesc);
+
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mBinLayout,
+  };
+  wgpu::ComputePipelineDescriptor pipelineDesc{
+    .label = "Light Binning",
+    .layout = device.CreatePipelineLayout(&pipelineLayoutDesc),
+    .compute = {.module = module, .entryPoint = "cs_main"},
+  };
+  mBinPipeline = device.CreateComputePipeline(&pipelineDesc);
+}
+
+void tkLightClusters::Update(wgpu::Device& device, wgpu::CommandEncoder& encoder, const m4& view, const m4& projection)
+{
+  mLights.clear();
+  auto lights = tkRegistry::Get().view<tcTransform3d, tcPointLight>();
+  for (auto entity : lights)
+  {
+    const tcTransform3d& transform = lights.get<tcTransform3d>(entity);
+    const tcPointLight& light = lights.get<tcPointLight>(entity);
+    mLights.push_back({transform.Position, light.Range, light.Color, light.Intensity});
+  }
+  if (mLights.size() > kMaxLights)
+  {
+    tkLogWarning("Lighting: %zu point lights exceed the limit of %u", mLights.size(), kMaxLights);
+    mLights.resize(kMaxLights);
+  }
+
+  // Near and far recovered from a -1..1 depth perspective matrix.
+  tkLightParams params{
+    .View = view,
+    .InverseProjection = glm::inverse(projection),
+    .ScreenSize = v2(kWindowWidth, kWindowHeight),
+    .Near = projection[3][2] / (projection[2][2] - 1.f),
+    .Far = projection[3][2] / (projection[2][2] + 1.f),
+    .LightCount = static_cast<u32>(mLights.size()),
+  };
+
+  wgpu::Queue queue = device.GetQueue();
+  queue.WriteBuffer(mParamsBuffer, 0, &params, sizeof(params));
+  if (!mLights.empty())
+  {
+    queue.WriteBuffer(mLightBuffer, 0, mLights.data(), mLights.size() * sizeof(tkGpuLight));
+  }
+
+  // Runs with zero lights too so the cluster counts are reset.
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+  pass.SetPipeline(mBinPipeline);
+  pass.SetBindGroup(0, mBinBindGroup);
+  pass.DispatchWorkgroups((kLightClusterCount + kLightBinWorkgroupSize - 1) / kLightBinWorkgroupSize);
+  pass.End();
+}
@@ -0,0 +1,62 @@
+#ifndef TK_LIGHTING_H
+#define TK_LIGHTING_H
+
+#include "def.h"
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kLightClustersX = 16;
+const u32 kLightClustersY = 16;
+const u32 kLightClustersZ = 24;
+const u32 kLightClusterCount = kLightClustersX * kLightClustersY * kLightClustersZ;
+const u32 kMaxLightsPerCluster = 128;
+const u32 kMaxLights = 4096;
+
+// Matches Light in lightCluster.wgsl and meshlet.wgsl.
+struct tkGpuLight
+{
+  v3 Position;
+  f32 Range;
+  v3 Color;
+  f32 Intensity;
+};
+
+// Matches LightParams in lightCluster.wgsl and meshlet.wgsl.
+struct tkLightParams
+{
+  m4 View;
+  m4 InverseProjection;
+  v2 ScreenSize;
+  f32 Near;
+  f32 Far;
+  u32 LightCount;
+  u32 Padding[3];
+};
+
+// Clustered forward lighting. Point lights are uploaded to a storage buffer each frame
+// and a compute pass bins them into a froxel grid (screen tiles times logarithmic
+// depth slices). Shading passes bind GetBindGroup() and only loop over the lights
+// of the fragment's cluster.
+class tkLightClusters
+{
+  wgpu::ComputePipeline mBinPipeline;
+  wgpu::BindGroupLayout mBinLayout;
+  wgpu::BindGroupLayout mShadingLayout;
+  wgpu::BindGroup mBinBindGroup;
+  wgpu::BindGroup mShadingBindGroup;
+
+  wgpu::Buffer mParamsBuffer;
+  wgpu::Buffer mLightBuffer;
+  wgpu::Buffer mClusterCountBuffer;
+  wgpu::Buffer mClusterLightBuffer;
+
+  tkDArray<tkGpuLight> mLights;
+
+public:
+  void Setup(wgpu::Device& device, wgpu::ShaderModule module);
+  void Update(wgpu::Device& device, wgpu::CommandEncoder& encoder, const m4& view, const m4& projection);
+
+  [[nodiscard]] const wgpu::BindGroupLayout& GetBindGroupLayout() const { return mShadingLayout; }
+  [[nodiscard]] const wgpu::BindGroup& GetBindGroup() const { return mShadingBindGroup; }
+};
+
+#endif//TK_LIGHTING_H
@@ -1,3 +1,6 @@
+#ifndef TK_LOGGER_H
+#define TK_LOGGER_H
+
 enum class ELogLevel
 {
       Info = 0,
@@ -9,3 +12,5 @@ void tkLog(ELogLevel logLevel, const char* format, ...);
 void tkLogInfo(const char* format, ...);
 void tkLogWarning(const char* format, ...);
 void tkLogError(const char* format, ...);
+
+#endif//TK_LOGGER_H
@@ -0,0 +1,154 @@
+#include "mappedFile.h"
+#include "logger.h"
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+tkMappedFile::~tkMappedFile()
+{
+  Close();
+}
+
+tkMappedFile::tkMappedFile(tkMappedFile&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+tkMappedFile& tkMappedFile::operator=(tkMappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    Close();
+    mData = std::exchange(other.mData, nullptr);
+    mSize = std::exchange(other.mSize, 0);
+#if defined(_WIN32)
+    mFileHandle = std::exchange(other.mFileHandle, nullptr);
+    mMappingHandle = std::exchange(other.mMappingHandle, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+u64 tkMappedFile::GetPageSize()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwPageSize;
+}
+
+bool tkMappedFile::Open(const tkString& path)
+{
+  Close();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    tkLogWarning("MappedFile::Open: Failed to open file %s", path.c_str());
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    tkLogWarning("MappedFile::Open: File %s is empty", path.c_str());
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (view == nullptr)
+  {
+    tkLogWarning("MappedFile::Open: Failed to map file %s", path.c_str());
+    if (mapping)
+    {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return false;
+  }
+
+  mFileHandle = file;
+  mMappingHandle = mapping;
+  mData = static_cast<const u8*>(view);
+  mSize = static_cast<u64>(size.QuadPart);
+  return true;
+}
+
+void tkMappedFile::Close()
+{
+  if (mData)
+  {
+    UnmapViewOfFile(mData);
+  }
+  if (mMappingHandle)
+  {
+    CloseHandle(mMappingHandle);
+  }
+  if (mFileHandle)
+  {
+    CloseHandle(mFileHandle);
+  }
+  mData = nullptr;
+  mSize = 0;
+  mMappingHandle = nullptr;
+  mFileHandle = nullptr;
+}
+#else
+u64 tkMappedFile::GetPageSize()
+{
+  return static_cast<u64>(sysconf(_SC_PAGESIZE));
+}
+
+bool tkMappedFile::Open(const tkString& path)
+{
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    tkLogWarning("MappedFile::Open: Failed to open file %s", path.c_str());
+    return false;
+  }
+
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    tkLogWarning("MappedFile::Open: File %s is empty", path.c_str());
+    close(fd);
+    return false;
+  }
+
+  void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED)
+  {
+    tkLogWarning("MappedFile::Open: Failed to map file %s", path.c_str());
+    return false;
+  }
+
+  mData = static_cast<const u8*>(view);
+  mSize = static_cast<u64>(st.st_size);
+  return true;
+}
+
+void tkMappedFile::Close()
+{
+  if (mData)
+  {
+    munmap(const_cast<u8*>(mData), static_cast<size_t>(mSize));
+  }
+  mData = nullptr;
+  mSize = 0;
+}
+#endif
@@ -0,0 +1,34 @@
+#ifndef TK_MAPPED_FILE_H
+#define TK_MAPPED_FILE_H
+
+#include "def.h"
+
+class tkMappedFile
+{
+  const u8* mData = nullptr;
+  u64 mSize = 0;
+#if defined(_WIN32)
+  void* mFileHandle = nullptr;
+  void* mMappingHandle = nullptr;
+#endif
+
+public:
+  tkMappedFile() = default;
+  ~tkMappedFile();
+
+  tkMappedFile(const tkMappedFile&) = delete;
+  tkMappedFile& operator=(const tkMappedFile&) = delete;
+  tkMappedFile(tkMappedFile&& other) noexcept;
+  tkMappedFile& operator=(tkMappedFile&& other) noexcept;
+
+  bool Open(const tkString& path);
+  void Close();
+
+  [[nodiscard]] bool IsOpen() const { return mData != nullptr; }
+  [[nodiscard]] const u8* GetData() const { return mData; }
+  [[nodiscard]] u64 GetSize() const { return mSize; }
+
+  static u64 GetPageSize();
+};
+
+#endif//TK_MAPPED_FILE_H
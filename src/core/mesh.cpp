@@ -0,0 +1,601 @@
+#include "mesh.h"
+#include "renderer.h"
+#include "reader.h"
+#include "pack.h"
+#include "logger.h"
+#include "tiny_gltf.h"
+#include "meshoptimizer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+static bool ReadFloats(const tinygltf::Model& model, i32 accessorIndex, u32 components, f32 fill, tkDArray<f32>& out)
+{
+  if (accessorIndex < 0 || accessorIndex >= static_cast<i32>(model.accessors.size()))
+  {
+    return false;
+  }
+
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  if (accessor.bufferView < 0)
+  {
+    return false;
+  }
+  const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+
+  const u32 available = static_cast<u32>(tinygltf::GetNumComponentsInType(static_cast<u32>(accessor.type)));
+  const u32 componentSize = static_cast<u32>(tinygltf::GetComponentSizeInBytes(static_cast<u32>(accessor.componentType)));
+  const i32 stride = accessor.ByteStride(view);
+  if (stride <= 0 || available == 0)
+  {
+    return false;
+  }
+
+  const u64 start = view.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 && start + (accessor.count - 1) * stride + available * componentSize > buffer.data.size())
+  {
+    return false;
+  }
+
+  out.assign(accessor.count * components, fill);
+  for (size_t i = 0; i < accessor.count; i++)
+  {
+    const u8* element = buffer.data.data() + start + i * stride;
+    for (u32 c = 0; c < std::min(components, available); c++)
+    {
+      const u8* value = element + c * componentSize;
+      f32 result = 0.f;
+      switch (accessor.componentType)
+      {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+          memcpy(&result, value, sizeof(f32));
+          break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+          result = accessor.normalized ? *value / 255.f : *value;
+          break;
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+          result = accessor.normalized ? std::max(*reinterpret_cast<const i8*>(value) / 127.f, -1.f) : *reinterpret_cast<const i8*>(value);
+          break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        {
+          u16 v;
+          memcpy(&v, value, sizeof(v));
+          result = accessor.normalized ? v / 65535.f : v;
+          break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        {
+          i16 v;
+          memcpy(&v, value, sizeof(v));
+          result = accessor.normalized ? std::max(v / 32767.f, -1.f) : v;
+          break;
+        }
+        default:
+          return false;
+      }
+      out[i * components + c] = result;
+    }
+  }
+  return true;
+}
+
+static bool ReadIndices(const tinygltf::Model& model, i32 accessorIndex, u32 vertexCount, u32 baseVertex, tkDArray<u32>& out)
+{
+  if (accessorIndex < 0)
+  {
+    for (u32 i = 0; i < vertexCount; i++)
+    {
+      out.push_back(baseVertex + i);
+    }
+    return true;
+  }
+
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  if (accessor.bufferView < 0)
+  {
+    return false;
+  }
+  const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+  const u32 size = static_cast<u32>(tinygltf::GetComponentSizeInBytes(static_cast<u32>(accessor.componentType)));
+  const i32 stride = accessor.ByteStride(view);
+  const u64 start = view.byteOffset + accessor.byteOffset;
+  if (stride <= 0 || (accessor.count > 0 && start + (accessor.count - 1) * stride + size > buffer.data.size()))
+  {
+    return false;
+  }
+
+  for (size_t i = 0; i < accessor.count; i++)
+  {
+    const u8* value = buffer.data.data() + start + i * stride;
+    u32 index = 0;
+    switch (accessor.componentType)
+    {
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        index = *value;
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      {
+        u16 v;
+        memcpy(&v, value, sizeof(v));
+        index = v;
+        break;
+      }
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        memcpy(&index, value, sizeof(index));
+        break;
+      default:
+        return false;
+    }
+    if (index >= vertexCount)
+    {
+      return false;
+    }
+    out.push_back(baseVertex + index);
+  }
+  return true;
+}
+
+static void GenerateNormals(tkMeshData& mesh, u32 firstVertex, u32 firstIndex)
+{
+  for (u32 i = firstIndex; i + 2 < mesh.Indices.size(); i += 3)
+  {
+    tkMeshVertex& a = mesh.Vertices[mesh.Indices[i]];
+    tkMeshVertex& b = mesh.Vertices[mesh.Indices[i + 1]];
+    tkMeshVertex& c = mesh.Vertices[mesh.Indices[i + 2]];
+    const v3 normal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+    a.Normal += normal;
+    b.Normal += normal;
+    c.Normal += normal;
+  }
+  for (u32 i = firstVertex; i < mesh.Vertices.size(); i++)
+  {
+    const f32 length = glm::length(mesh.Vertices[i].Normal);
+    mesh.Vertices[i].Normal = length > 0.f ? mesh.Vertices[i].Normal / length : v3(0.f, 0.f, 1.f);
+  }
+}
+
+// Per-triangle UV gradients accumulated per vertex, then Gram-Schmidt against the normal.
+static void GenerateTangents(tkMeshData& mesh, u32 firstVertex, u32 firstIndex)
+{
+  tkDArray<v3> bitangents(mesh.Vertices.size() - firstVertex, v3(0.f));
+  for (u32 i = firstIndex; i + 2 < mesh.Indices.size(); i += 3)
+  {
+    const u32 i0 = mesh.Indices[i];
+    const u32 i1 = mesh.Indices[i + 1];
+    const u32 i2 = mesh.Indices[i + 2];
+    const tkMeshVertex& a = mesh.Vertices[i0];
+    const tkMeshVertex& b = mesh.Vertices[i1];
+    const tkMeshVertex& c = mesh.Vertices[i2];
+
+    const v3 e1 = b.Position - a.Position;
+    const v3 e2 = c.Position - a.Position;
+    const v2 d1 = b.UV - a.UV;
+    const v2 d2 = c.UV - a.UV;
+    const f32 det = d1.x * d2.y - d2.x * d1.y;
+    if (std::abs(det) < 1e-12f)
+    {
+      continue;
+    }
+
+    const f32 r = 1.f / det;
+    const v3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+    const v3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+    for (u32 index : {i0, i1, i2})
+    {
+      mesh.Vertices[index].Tangent += tangent;
+      bitangents[index - firstVertex] += bitangent;
+    }
+  }
+
+  for (u32 i = firstVertex; i < mesh.Vertices.size(); i++)
+  {
+    tkMeshVertex& vertex = mesh.Vertices[i];
+    v3 tangent = vertex.Tangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Tangent);
+    if (glm::length(tangent) < 1e-6f)
+    {
+      tangent = glm::cross(vertex.Normal, std::abs(vertex.Normal.x) < 0.9f ? v3(1.f, 0.f, 0.f) : v3(0.f, 1.f, 0.f));
+    }
+    vertex.Tangent = glm::normalize(tangent);
+    const f32 handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), bitangents[i - firstVertex]) < 0.f ? -1.f : 1.f;
+    vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * handedness;
+  }
+}
+
+static bool AppendPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const m4& transform, tkMeshData& mesh)
+{
+  if (primitive.mode != -1 && primitive.mode != TINYGLTF_MODE_TRIANGLES)
+  {
+    return true;
+  }
+
+  auto attribute = [&primitive](const char* name) {
+    auto it = primitive.attributes.find(name);
+    return it == primitive.attributes.end() ? -1 : it->second;
+  };
+
+  tkDArray<f32> positions, normals, tangents, colors, uvs;
+  if (!ReadFloats(model, attribute("POSITION"), 3, 0.f, positions))
+  {
+    return false;
+  }
+  const bool hasNormals = ReadFloats(model, attribute("NORMAL"), 3, 0.f, normals);
+  const bool hasTangents = hasNormals && ReadFloats(model, attribute("TANGENT"), 4, 1.f, tangents);
+  const bool hasColors = ReadFloats(model, attribute("COLOR_0"), 4, 1.f, colors);
+  const bool hasUVs = ReadFloats(model, attribute("TEXCOORD_0"), 2, 0.f, uvs);
+
+  const u32 firstVertex = static_cast<u32>(mesh.Vertices.size());
+  const u32 firstIndex = static_cast<u32>(mesh.Indices.size());
+  const u32 count = static_cast<u32>(positions.size() / 3);
+  const m3 normalMatrix = glm::transpose(glm::inverse(m3(transform)));
+
+  mesh.Vertices.resize(firstVertex + count);
+  for (u32 i = 0; i < count; i++)
+  {
+    tkMeshVertex& vertex = mesh.Vertices[firstVertex + i];
+    vertex.Position = v3(transform * v4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.f));
+    vertex.Normal = hasNormals ? glm::normalize(normalMatrix * v3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2])) : v3(0.f);
+    vertex.Tangent = hasTangents ? glm::normalize(m3(transform) * v3(tangents[i * 4], tangents[i * 4 + 1], tangents[i * 4 + 2])) : v3(0.f);
+    vertex.Bitangent = hasTangents ? glm::cross(vertex.Normal, vertex.Tangent) * tangents[i * 4 + 3] : v3(0.f);
+    vertex.Color = hasColors ? v4(colors[i * 4], colors[i * 4 + 1], colors[i * 4 + 2], colors[i * 4 + 3]) : v4(1.f);
+    vertex.UV = hasUVs ? v2(uvs[i * 2], uvs[i * 2 + 1]) : v2(0.f);
+  }
+
+  if (!ReadIndices(model, primitive.indices, count, firstVertex, mesh.Indices))
+  {
+    return false;
+  }
+  mesh.Indices.resize(firstIndex + (mesh.Indices.size() - firstIndex) / 3 * 3);
+
+  if (!hasNormals)
+  {
+    GenerateNormals(mesh, firstVertex, firstIndex);
+  }
+  if (!hasTangents)
+  {
+    GenerateTangents(mesh, firstVertex, firstIndex);
+  }
+  return true;
+}
+
+static m4 GetNodeTransform(const tinygltf::Node& node)
+{
+  if (node.matrix.size() == 16)
+  {
+    m4 matrix;
+    for (u32 i = 0; i < 16; i++)
+    {
+      matrix[i / 4][i % 4] = static_cast<f32>(node.matrix[i]);
+    }
+    return matrix;
+  }
+
+  m4 matrix(1.f);
+  if (node.translation.size() == 3)
+  {
+    matrix = glm::translate(matrix, v3(node.translation[0], node.translation[1], node.translation[2]));
+  }
+  if (node.rotation.size() == 4)
+  {
+    matrix *= glm::mat4_cast(quat(static_cast<f32>(node.rotation[3]), static_cast<f32>(node.rotation[0]),
+                                  static_cast<f32>(node.rotation[1]), static_cast<f32>(node.rotation[2])));
+  }
+  if (node.scale.size() == 3)
+  {
+    matrix = glm::scale(matrix, v3(node.scale[0], node.scale[1], node.scale[2]));
+  }
+  return matrix;
+}
+
+static bool AppendNode(const tinygltf::Model& model, i32 nodeIndex, const m4& parent, tkMeshData& mesh, u32 depth)
+{
+  if (nodeIndex < 0 || nodeIndex >= static_cast<i32>(model.nodes.size()) || depth > 64)
+  {
+    return false;
+  }
+
+  const tinygltf::Node& node = model.nodes[nodeIndex];
+  const m4 transform = parent * GetNodeTransform(node);
+  if (node.mesh >= 0 && node.mesh < static_cast<i32>(model.meshes.size()))
+  {
+    for (const tinygltf::Primitive& primitive : model.meshes[node.mesh].primitives)
+    {
+      if (!AppendPrimitive(model, primitive, transform, mesh))
+      {
+        return false;
+      }
+    }
+  }
+
+  for (i32 child : node.children)
+  {
+    if (!AppendNode(model, child, transform, mesh, depth + 1))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool tkMeshImporter::ImportGltf(std::span<const u8> data, const tkString& path, tkMeshData& mesh)
+{
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string error;
+  std::string warning;
+  const std::string baseDir = std::filesystem::path(tkReader::ResolvePath(path)).parent_path().string();
+
+  const bool binary = data.size() >= 4 && memcmp(data.data(), "glTF", 4) == 0;
+  const bool loaded = binary ?
+    loader.LoadBinaryFromMemory(&model, &error, &warning, data.data(), static_cast<u32>(data.size()), baseDir) :
+    loader.LoadASCIIFromString(&model, &error, &warning, reinterpret_cast<const char*>(data.data()), static_cast<u32>(data.size()), baseDir);
+  if (!loaded)
+  {
+    tkLogWarning("MeshImporter: Failed to load %s: %s", path.c_str(), error.c_str());
+    return false;
+  }
+
+  bool success = true;
+  if (model.scenes.empty())
+  {
+    for (const tinygltf::Mesh& gltfMesh : model.meshes)
+    {
+      for (const tinygltf::Primitive& primitive : gltfMesh.primitives)
+      {
+        success = success && AppendPrimitive(model, primitive, m4(1.f), mesh);
+      }
+    }
+  }
+  else
+  {
+    const tinygltf::Scene& scene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+    for (i32 node : scene.nodes)
+    {
+      success = success && AppendNode(model, node, m4(1.f), mesh, 0);
+    }
+  }
+
+  if (!success || mesh.Indices.empty())
+  {
+    tkLogWarning("MeshImporter: %s has no readable triangle geometry", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void tkMeshImporter::Optimize(tkMeshData& mesh)
+{
+  const size_t indexCount = mesh.Indices.size();
+  tkDArray<u32> remap(mesh.Vertices.size());
+  const size_t vertexCount = meshopt_generateVertexRemap(remap.data(), mesh.Indices.data(), indexCount,
+                                                         mesh.Vertices.data(), mesh.Vertices.size(), sizeof(tkMeshVertex));
+
+  tkDArray<tkMeshVertex> vertices(vertexCount);
+  meshopt_remapVertexBuffer(vertices.data(), mesh.Vertices.data(), mesh.Vertices.size(), sizeof(tkMeshVertex), remap.data());
+  meshopt_remapIndexBuffer(mesh.Indices.data(), mesh.Indices.data(), indexCount, remap.data());
+
+  meshopt_optimizeVertexCache(mesh.Indices.data(), mesh.Indices.data(), indexCount, vertexCount);
+  // Allow up to 5% more cache misses in exchange for front-to-back triangle order.
+  meshopt_optimizeOverdraw(mesh.Indices.data(), mesh.Indices.data(), indexCount,
+                           &vertices[0].Position.x, vertexCount, sizeof(tkMeshVertex), 1.05f);
+
+  mesh.Vertices.resize(vertexCount);
+  meshopt_optimizeVertexFetch(mesh.Vertices.data(), mesh.Indices.data(), indexCount, vertices.data(), vertexCount, sizeof(tkMeshVertex));
+}
+
+static i16 QuantizeSnorm(f32 value)
+{
+  return static_cast<i16>(std::round(glm::clamp(value, -1.f, 1.f) * 32767.f));
+}
+
+static void EncodeOctahedral(v3 n, i16 out[2])
+{
+  n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  v2 p(n.x, n.y);
+  if (n.z < 0.f)
+  {
+    p = v2((1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f), (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f));
+  }
+  out[0] = QuantizeSnorm(p.x);
+  out[1] = QuantizeSnorm(p.y);
+}
+
+void tkMeshImporter::Pack(const tkMeshData& mesh, tkPackedMesh& packed)
+{
+  v3 min(std::numeric_limits<f32>::max());
+  v3 max(std::numeric_limits<f32>::lowest());
+  for (const tkMeshVertex& vertex : mesh.Vertices)
+  {
+    min = glm::min(min, vertex.Position);
+    max = glm::max(max, vertex.Position);
+  }
+  packed.BoundsMin = min;
+  packed.BoundsExtent = glm::max(max - min, v3(1e-6f));
+  packed.Indices = mesh.Indices;
+  packed.Vertices.resize(mesh.Vertices.size());
+
+  for (size_t i = 0; i < mesh.Vertices.size(); i++)
+  {
+    const tkMeshVertex& vertex = mesh.Vertices[i];
+    tkPackedMeshVertex& out = packed.Vertices[i];
+
+    const v3 position = (vertex.Position - packed.BoundsMin) / packed.BoundsExtent;
+    for (u32 c = 0; c < 3; c++)
+    {
+      out.Position[c] = static_cast<u16>(meshopt_quantizeUnorm(position[c], 16));
+    }
+    const bool flipped = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.f;
+    out.Position[3] = flipped ? 0 : 0xFFFF;
+
+    EncodeOctahedral(vertex.Normal, out.Normal);
+    EncodeOctahedral(vertex.Tangent, out.Tangent);
+    for (u32 c = 0; c < 4; c++)
+    {
+      out.Color[c] = static_cast<u8>(meshopt_quantizeUnorm(vertex.Color[c], 8));
+    }
+    out.UV[0] = meshopt_quantizeHalf(vertex.UV.x);
+    out.UV[1] = meshopt_quantizeHalf(vertex.UV.y);
+  }
+}
+
+void tkMeshImporter::BuildMeshlets(const tkMeshData& mesh, tkPackedMesh& packed)
+{
+  const size_t maxMeshlets = meshopt_buildMeshletsBound(mesh.Indices.size(), kMeshletMaxVertices, kMeshletMaxTriangles);
+  tkDArray<meshopt_Meshlet> meshlets(maxMeshlets);
+  tkDArray<u32> meshletVertices(maxMeshlets * kMeshletMaxVertices);
+  tkDArray<u8> meshletTriangles(maxMeshlets * kMeshletMaxTriangles * 3);
+
+  const f32* positions = &mesh.Vertices[0].Position.x;
+  const size_t count = meshopt_buildMeshlets(meshlets.data(), meshletVertices.data(), meshletTriangles.data(),
+                                             mesh.Indices.data(), mesh.Indices.size(), positions, mesh.Vertices.size(),
+                                             sizeof(tkMeshVertex), kMeshletMaxVertices, kMeshletMaxTriangles, 0.25f);
+
+  packed.Indices.clear();
+  packed.Meshlets.resize(count);
+  for (size_t m = 0; m < count; m++)
+  {
+    const meshopt_Meshlet& meshlet = meshlets[m];
+    const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshletVertices[meshlet.vertex_offset],
+                                                               &meshletTriangles[meshlet.triangle_offset], meshlet.triangle_count,
+                                                               positions, mesh.Vertices.size(), sizeof(tkMeshVertex));
+
+    tkMeshlet& out = packed.Meshlets[m];
+    out.Center = v3(bounds.center[0], bounds.center[1], bounds.center[2]);
+    out.Radius = bounds.radius;
+    out.ConeAxis = v3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+    out.ConeCutoff = bounds.cone_cutoff;
+    out.ConeApex = v3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+    out.TriangleOffset = static_cast<u32>(packed.Indices.size() / 3);
+    out.TriangleCount = meshlet.triangle_count;
+
+    for (u32 i = 0; i < meshlet.triangle_count * 3; i++)
+    {
+      packed.Indices.push_back(meshletVertices[meshlet.vertex_offset + meshletTriangles[meshlet.triangle_offset + i]]);
+    }
+  }
+}
+
+tkString tkMeshImporter::GetCachePath(const tkString& path)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(tkPack::HashPath(path)));
+  return tkString("cache/") + name + ".tkmesh";
+}
+
+bool tkMeshImporter::IsCacheValid(const tkString& path)
+{
+  std::ifstream file(tkReader::ResolvePath(GetCachePath(path)), std::ios::in | std::ios::binary);
+  tkMeshCacheHeader header{};
+  if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+  {
+    return false;
+  }
+
+  u64 size;
+  i64 time;
+  tkReader::GetFileStamp(path, size, time);
+  return header.Magic == kMeshCacheMagic && header.Version == kMeshCacheVersion &&
+         header.SourceSize == size && header.SourceTime == time;
+}
+
+bool tkMeshImporter::WriteCache(const tkString& path, const tkPackedMesh& mesh)
+{
+  const std::string cachePath = tkReader::ResolvePath(GetCachePath(path));
+  std::error_code error;
+  std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+  std::ofstream file(cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    tkLogWarning("MeshImporter: Failed to write cache %s", cachePath.c_str());
+    return false;
+  }
+
+  tkMeshCacheHeader header{
+    .Magic = kMeshCacheMagic,
+    .Version = kMeshCacheVersion,
+    .VertexCount = static_cast<u32>(mesh.Vertices.size()),
+    .IndexCount = static_cast<u32>(mesh.Indices.size()),
+    .MeshletCount = static_cast<u32>(mesh.Meshlets.size()),
+  };
+  tkReader::GetFileStamp(path, header.SourceSize, header.SourceTime);
+  for (u32 c = 0; c < 3; c++)
+  {
+    header.BoundsMin[c] = mesh.BoundsMin[c];
+    header.BoundsExtent[c] = mesh.BoundsExtent[c];
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(mesh.Vertices.data()), static_cast<std::streamsize>(mesh.Vertices.size() * sizeof(tkPackedMeshVertex)));
+  file.write(reinterpret_cast<const char*>(mesh.Indices.data()), static_cast<std::streamsize>(mesh.Indices.size() * sizeof(u32)));
+  file.write(reinterpret_cast<const char*>(mesh.Meshlets.data()), static_cast<std::streamsize>(mesh.Meshlets.size() * sizeof(tkMeshlet)));
+  return file.good();
+}
+
+void tkMeshImporter::Upload(tkMeshAsset& asset, std::span<const tkPackedMeshVertex> vertices, std::span<const u32> indices,
+                            std::span<const tkMeshlet> meshlets, const tkString& label)
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+  const u64 vertexBytes = vertices.size_bytes();
+  const u64 indexBytes = indices.size_bytes();
+  const u64 meshletBytes = meshlets.size_bytes();
+
+  wgpu::BufferDescriptor stagingDesc{
+    .label = label.c_str(),
+    .usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc,
+    .size = vertexBytes + indexBytes + meshletBytes,
+    .mappedAtCreation = true,
+  };
+  wgpu::Buffer staging = device.CreateBuffer(&stagingDesc);
+  u8* mapped = static_cast<u8*>(staging.GetMappedRange());
+  memcpy(mapped, vertices.data(), vertexBytes);
+  memcpy(mapped + vertexBytes, indices.data(), indexBytes);
+  memcpy(mapped + vertexBytes + indexBytes, meshlets.data(), meshletBytes);
+  staging.Unmap();
+
+  // Storage usage lets the meshlet path pull vertices and indices in the vertex shader.
+  wgpu::BufferDescriptor vertexDesc{
+    .label = label.c_str(),
+    .usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+    .size = vertexBytes,
+  };
+  wgpu::BufferDescriptor indexDesc{
+    .label = label.c_str(),
+    .usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+    .size = indexBytes,
+  };
+  wgpu::BufferDescriptor meshletDesc{
+    .label = label.c_str(),
+    .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+    .size = meshletBytes,
+  };
+  asset.VertexBuffer = device.CreateBuffer(&vertexDesc);
+  asset.IndexBuffer = device.CreateBuffer(&indexDesc);
+  asset.MeshletBuffer = device.CreateBuffer(&meshletDesc);
+  asset.VertexCount = static_cast<u32>(vertices.size());
+  asset.IndexCount = static_cast<u32>(indices.size());
+  asset.MeshletCount = static_cast<u32>(meshlets.size());
+
+  wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+  encoder.CopyBufferToBuffer(staging, 0, asset.VertexBuffer, 0, vertexBytes);
+  encoder.CopyBufferToBuffer(staging, vertexBytes, asset.IndexBuffer, 0, indexBytes);
+  encoder.CopyBufferToBuffer(staging, vertexBytes + indexBytes, asset.MeshletBuffer, 0, meshletBytes);
+  wgpu::CommandBuffer commands = encoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+}
+
+tkArray<wgpu::VertexAttribute, 5> tkMeshImporter::GetVertexAttributes()
+{
+  return {{
+    {.format = wgpu::VertexFormat::Unorm16x4, .offset = offsetof(tkPackedMeshVertex, Position), .shaderLocation = 0},
+    {.format = wgpu::VertexFormat::Snorm16x2, .offset = offsetof(tkPackedMeshVertex, Normal), .shaderLocation = 1},
+    {.format = wgpu::VertexFormat::Snorm16x2, .offset = offsetof(tkPackedMeshVertex, Tangent), .shaderLocation = 2},
+    {.format = wgpu::VertexFormat::Unorm8x4, .offset = offsetof(tkPackedMeshVertex, Color), .shaderLocation = 3},
+    {.format = wgpu::VertexFormat::Float16x2, .offset = offsetof(tkPackedMeshVertex, UV), .shaderLocation = 4},
+  }};
+}
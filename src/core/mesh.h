@@ -0,0 +1,116 @@
+#ifndef TK_MESH_H
+#define TK_MESH_H
+
+#include "def.h"
+#include <span>
+#include <webgpu/webgpu_cpp.h>
+
+// Full precision vertex produced by the importer.
+struct tkMeshVertex
+{
+  v3 Position;
+  v3 Normal;
+  v3 Tangent;
+  v3 Bitangent;
+  v4 Color;
+  v2 UV;
+};
+
+struct tkMeshData
+{
+  tkDArray<tkMeshVertex> Vertices;
+  tkDArray<u32> Indices;
+};
+
+// Quantized vertex matching VertexInput in pbr.wgsl, 24 bytes instead of 72.
+// Position is unorm16 within the mesh bounds, its w holds the tangent handedness.
+// Normal and tangent are octahedral snorm16, UV is half float.
+struct tkPackedMeshVertex
+{
+  u16 Position[4];
+  i16 Normal[2];
+  i16 Tangent[2];
+  u8 Color[4];
+  u16 UV[2];
+};
+
+const u32 kMeshletMaxVertices = 64;
+const u32 kMeshletMaxTriangles = 124;
+
+// Cluster of up to kMeshletMaxTriangles triangles with culling bounds in model space.
+// Matches Meshlet in meshlet.wgsl and meshletCull.wgsl.
+struct tkMeshlet
+{
+  v3 Center;
+  f32 Radius;
+  v3 ConeAxis;
+  f32 ConeCutoff;
+  v3 ConeApex;
+  u32 TriangleOffset;
+  u32 TriangleCount;
+  u32 Padding[3];
+};
+
+// Indices are ordered meshlet by meshlet, so a plain indexed draw and the
+// meshlet path read the same buffer.
+struct tkPackedMesh
+{
+  tkDArray<tkPackedMeshVertex> Vertices;
+  tkDArray<u32> Indices;
+  tkDArray<tkMeshlet> Meshlets;
+  v3 BoundsMin{0.f};
+  v3 BoundsExtent{0.f};
+};
+
+struct tkMeshAsset
+{
+  wgpu::Buffer VertexBuffer;
+  wgpu::Buffer IndexBuffer;
+  wgpu::Buffer MeshletBuffer;
+  u32 VertexCount = 0;
+  u32 IndexCount = 0;
+  u32 MeshletCount = 0;
+  // Dequantization: position = BoundsMin + packed.xyz * BoundsExtent.
+  v3 BoundsMin{0.f};
+  v3 BoundsExtent{0.f};
+};
+
+const u32 kMeshCacheMagic = 0x534D4B54; // "TKMS"
+const u32 kMeshCacheVersion = 3;
+
+struct tkMeshCacheHeader
+{
+  u32 Magic;
+  u32 Version;
+  u32 VertexCount;
+  u32 IndexCount;
+  u32 MeshletCount;
+  u32 Padding;
+  u64 SourceSize;
+  i64 SourceTime;
+  f32 BoundsMin[3];
+  f32 BoundsExtent[3];
+};
+
+class tkMeshImporter
+{
+public:
+  // Flattens the default scene of a .gltf or .glb file into one mesh in model space.
+  static bool ImportGltf(std::span<const u8> data, const tkString& path, tkMeshData& mesh);
+
+  // Welds duplicate vertices, then reorders for the post-transform cache, overdraw and vertex fetch.
+  static void Optimize(tkMeshData& mesh);
+  static void Pack(const tkMeshData& mesh, tkPackedMesh& packed);
+  // Splits the packed mesh into meshlets and reorders its indices to match.
+  static void BuildMeshlets(const tkMeshData& mesh, tkPackedMesh& packed);
+
+  static tkString GetCachePath(const tkString& path);
+  static bool IsCacheValid(const tkString& path);
+  static bool WriteCache(const tkString& path, const tkPackedMesh& mesh);
+
+  static void Upload(tkMeshAsset& asset, std::span<const tkPackedMeshVertex> vertices, std::span<const u32> indices,
+                     std::span<const tkMeshlet> meshlets, const tkString& label);
+  static tkArray<wgpu::VertexAttribute, 5> GetVertexAttributes();
+};
+
+#endif//TK_MESH_H
@@ -0,0 +1,116 @@
+#include "mipmap.h"
+#include "logger.h"
+#include <algorithm>
+
+const u32 kMipTileSize = 64;
+
+struct tkMipFormat
+{
+  wgpu::TextureFormat Format;
+  const char* Name;
+};
+
+// Storage capable formats without optional features.
+static const tkArray<tkMipFormat, 2> kMipFormats = {{
+  {wgpu::TextureFormat::RGBA8Unorm, "rgba8unorm"},
+  {wgpu::TextureFormat::RGBA16Float, "rgba16float"},
+}};
+
+void tkMipGenerator::Setup(wgpu::Device& device, std::string_view source)
+{
+  const std::string_view token = kMipFormats[0].Name;
+  for (const tkMipFormat& format : kMipFormats)
+  {
+    tkString code(source);
+    for (size_t pos = code.find(token); pos != tkString::npos; pos = code.find(token, pos + 1))
+    {
+      code.replace(pos, token.size(), format.Name);
+    }
+
+    wgpu::ShaderModuleWGSLDescriptor wgslDesc{};
+    wgslDesc.code = code.c_str();
+    wgpu::ShaderModuleDescriptor moduleDesc{
+      .nextInChain = &wgslDesc,
+      .label = "Mipmap",
+    };
+    wgpu::ShaderModule module = device.CreateShaderModule(&moduleDesc);
+
+    tkVariant& variant = mVariants.emplace_back();
+    variant.Format = format.Format;
+    for (u32 i = 0; i < kMipsPerDispatch; i++)
+    {
+      wgpu::ConstantEntry constant{.key = "mip_count", .value = static_cast<double>(i + 1)};
+      wgpu::ComputePipelineDescriptor pipelineDesc{
+        .label = "Mipmap",
+        .compute = {.module = module, .entryPoint = "cs_main", .constantCount = 1, .constants = &constant},
+      };
+      variant.Pipelines[i] = device.CreateComputePipeline(&pipelineDesc);
+    }
+
+    wgpu::TextureDescriptor dummyDesc{
+      .label = "Mipmap Dummy",
+      .usage = wgpu::TextureUsage::StorageBinding,
+      .dimension = wgpu::TextureDimension::e2D,
+      .size = {1, 1, 1},
+      .format = format.Format,
+      .mipLevelCount = 1,
+      .sampleCount = 1,
+    };
+    variant.Dummy = device.CreateTexture(&dummyDesc).CreateView();
+  }
+}
+
+bool tkMipGenerator::Supports(wgpu::TextureFormat format) const
+{
+  return std::any_of(mVariants.begin(), mVariants.end(), [format](const tkVariant& variant) { return variant.Format == format; });
+}
+
+void tkMipGenerator::Generate(wgpu::Device& device, wgpu::CommandEncoder& encoder, const wgpu::Texture& texture) const
+{
+  auto it = std::find_if(mVariants.begin(), mVariants.end(), [&texture](const tkVariant& variant) {
+    return variant.Format == texture.GetFormat();
+  });
+  if (it == mVariants.end())
+  {
+    tkLogWarning("MipGenerator: Unsupported texture format %u", static_cast<u32>(texture.GetFormat()));
+    return;
+  }
+
+  auto createView = [&texture](u32 mip) {
+    wgpu::TextureViewDescriptor viewDesc{
+      .format = texture.GetFormat(),
+      .dimension = wgpu::TextureViewDimension::e2D,
+      .baseMipLevel = mip,
+      .mipLevelCount = 1,
+      .baseArrayLayer = 0,
+      .arrayLayerCount = 1,
+    };
+    return texture.CreateView(&viewDesc);
+  };
+
+  const u32 mipCount = texture.GetMipLevelCount();
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+  for (u32 base = 0; base + 1 < mipCount; base += kMipsPerDispatch)
+  {
+    const u32 count = std::min(kMipsPerDispatch, mipCount - base - 1);
+    tkArray<wgpu::BindGroupEntry, kMipsPerDispatch + 1> entries;
+    entries[0] = {.binding = 0, .textureView = createView(base)};
+    for (u32 i = 0; i < kMipsPerDispatch; i++)
+    {
+      entries[i + 1] = {.binding = i + 1, .textureView = i < count ? createView(base + 1 + i) : it->Dummy};
+    }
+
+    const wgpu::ComputePipeline& pipeline = it->Pipelines[count - 1];
+    wgpu::BindGroupDescriptor bindGroupDesc{
+      .layout = pipeline.GetBindGroupLayout(0),
+      .entryCount = entries.size(),
+      .entries = entries.data(),
+    };
+    const u32 width = std::max(texture.GetWidth() >> base, 1u);
+    const u32 height = std::max(texture.GetHeight() >> base, 1u);
+    pass.SetPipeline(pipeline);
+    pass.SetBindGroup(0, device.CreateBindGroup(&bindGroupDesc));
+    pass.DispatchWorkgroups((width + kMipTileSize - 1) / kMipTileSize, (height + kMipTileSize - 1) / kMipTileSize);
+  }
+  pass.End();
+}
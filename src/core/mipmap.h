@@ -0,0 +1,31 @@
+#ifndef TK_MIPMAP_H
+#define TK_MIPMAP_H
+
+#include "def.h"
+#include <string_view>
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kMipsPerDispatch = 4;
+
+// Fills mips 1.. of a 2D texture from its mip 0 with mipmap.wgsl. The texture needs
+// TextureBinding and StorageBinding usage, which render targets opt into the same way.
+class tkMipGenerator
+{
+  struct tkVariant
+  {
+    wgpu::TextureFormat Format;
+    // Indexed by the number of mips written per dispatch, minus one.
+    tkArray<wgpu::ComputePipeline, kMipsPerDispatch> Pipelines;
+    wgpu::TextureView Dummy;
+  };
+
+  tkDArray<tkVariant> mVariants;
+
+public:
+  void Setup(wgpu::Device& device, std::string_view source);
+
+  [[nodiscard]] bool Supports(wgpu::TextureFormat format) const;
+  void Generate(wgpu::Device& device, wgpu::CommandEncoder& encoder, const wgpu::Texture& texture) const;
+};
+
+#endif//TK_MIPMAP_H
@@ -0,0 +1,95 @@
+#include "objectCache.h"
+#include "hash.h"
+#include <bit>
+
+template <size_t N>
+static u64 HashKey(const tkArray<u32, N>& key, u64 hash = kHashOffsetBasis)
+{
+  for (u32 word : key)
+  {
+    tkHashWord(hash, word);
+  }
+  return hash;
+}
+
+void tkSamplerCache::Setup(wgpu::Device& device)
+{
+  mDevice = device;
+  mSamplers.clear();
+}
+
+wgpu::Sampler tkSamplerCache::Get(const wgpu::SamplerDescriptor& desc)
+{
+  if (desc.nextInChain)
+  {
+    return mDevice.CreateSampler(&desc);
+  }
+
+  const tkArray<u32, 10> key = {
+    static_cast<u32>(desc.addressModeU),
+    static_cast<u32>(desc.addressModeV),
+    static_cast<u32>(desc.addressModeW),
+    static_cast<u32>(desc.magFilter),
+    static_cast<u32>(desc.minFilter),
+    static_cast<u32>(desc.mipmapFilter),
+    std::bit_cast<u32>(desc.lodMinClamp),
+    std::bit_cast<u32>(desc.lodMaxClamp),
+    static_cast<u32>(desc.compare),
+    static_cast<u32>(desc.maxAnisotropy),
+  };
+  tkDArray<tkCachedSampler>& bucket = mSamplers[HashKey(key)];
+  for (const tkCachedSampler& cached : bucket)
+  {
+    if (cached.Key == key)
+    {
+      return cached.Sampler;
+    }
+  }
+
+  wgpu::Sampler sampler = mDevice.CreateSampler(&desc);
+  bucket.push_back({key, sampler});
+  return sampler;
+}
+
+void tkTextureViewCache::BeginFrame()
+{
+  mFrame++;
+  for (auto it = mViews.begin(); it != mViews.end();)
+  {
+    std::erase_if(it->second, [this](const tkCachedView& entry) { return mFrame - entry.LastUsed > kTextureViewCacheLifetime; });
+    it = it->second.empty() ? mViews.erase(it) : std::next(it);
+  }
+}
+
+wgpu::TextureView tkTextureViewCache::Get(const wgpu::Texture& texture, const wgpu::TextureViewDescriptor& desc)
+{
+  if (desc.nextInChain)
+  {
+    return texture.CreateView(&desc);
+  }
+
+  const tkArray<u32, 7> key = {
+    static_cast<u32>(desc.format),
+    static_cast<u32>(desc.dimension),
+    desc.baseMipLevel,
+    desc.mipLevelCount,
+    desc.baseArrayLayer,
+    desc.arrayLayerCount,
+    static_cast<u32>(desc.aspect),
+  };
+  u64 hash = kHashOffsetBasis;
+  tkHashWord(hash, reinterpret_cast<u64>(texture.Get()));
+  tkDArray<tkCachedView>& bucket = mViews[HashKey(key, hash)];
+  for (tkCachedView& cached : bucket)
+  {
+    if (cached.Texture.Get() == texture.Get() && cached.Key == key)
+    {
+      cached.LastUsed = mFrame;
+      return cached.View;
+    }
+  }
+
+  wgpu::TextureView view = texture.CreateView(&desc);
+  bucket.push_back({texture, key, view, mFrame});
+  return view;
+}
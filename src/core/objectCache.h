@@ -0,0 +1,52 @@
+#ifndef TK_OBJECT_CACHE_H
+#define TK_OBJECT_CACHE_H
+
+#include "def.h"
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+// Unused texture views are released after this many frames.
+const u32 kTextureViewCacheLifetime = 300;
+
+// Hands out one sampler per distinct SamplerDescriptor, so equal descriptors share a
+// handle and bind groups built from them can be deduplicated. Labels are ignored and
+// samplers live as long as the cache.
+class tkSamplerCache
+{
+  struct tkCachedSampler
+  {
+    tkArray<u32, 10> Key;
+    wgpu::Sampler Sampler;
+  };
+
+  wgpu::Device mDevice;
+  std::unordered_map<u64, tkDArray<tkCachedSampler>> mSamplers;
+
+public:
+  void Setup(wgpu::Device& device);
+  wgpu::Sampler Get(const wgpu::SamplerDescriptor& desc);
+};
+
+// Hands out one view per texture and TextureViewDescriptor. A default descriptor
+// means the whole texture, as with Texture::CreateView(). Views keep their texture
+// alive, so those unused for kTextureViewCacheLifetime frames are dropped.
+class tkTextureViewCache
+{
+  struct tkCachedView
+  {
+    wgpu::Texture Texture;
+    tkArray<u32, 7> Key;
+    wgpu::TextureView View;
+    u32 LastUsed;
+  };
+
+  std::unordered_map<u64, tkDArray<tkCachedView>> mViews;
+  u32 mFrame = 0;
+
+public:
+  // Advances the frame and drops views that have gone unused.
+  void BeginFrame();
+  wgpu::TextureView Get(const wgpu::Texture& texture, const wgpu::TextureViewDescriptor& desc = {});
+};
+
+#endif//TK_OBJECT_CACHE_H
@@ -0,0 +1,305 @@
+#include "pack.h"
+#include "hash.h"
+#include "mappedFile.h"
+#include "logger.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <lz4.h>
+#include <zstd.h>
+
+const u32 kPackZstdLevel = 19;
+
+// Entries that shrink by less than this are stored raw so they stay mappable.
+const f32 kPackMinCompressionRatio = 0.9f;
+
+std::mutex tkPack::sMountMutex;
+tkDArray<std::shared_ptr<tkPack>> tkPack::sMounted;
+
+static u64 AlignPackOffset(u64 offset)
+{
+  return (offset + kPackAlignment - 1) & ~(kPackAlignment - 1);
+}
+
+u64 tkPack::HashPath(std::string_view path)
+{
+  while (path.starts_with("./"))
+  {
+    path.remove_prefix(2);
+  }
+
+  u64 hash = kHashOffsetBasis;
+  for (char c : path)
+  {
+    tkHashWord(hash, static_cast<u8>(c == '\\' ? '/' : c));
+  }
+  return hash;
+}
+
+bool tkPack::Open(const tkString& path)
+{
+  std::shared_ptr<tkMappedFile> file = std::make_shared<tkMappedFile>();
+  if (!file->Open(path))
+  {
+    return false;
+  }
+
+  const u8* base = file->GetData();
+  const u64 size = file->GetSize();
+  const tkPackHeader* header = reinterpret_cast<const tkPackHeader*>(base);
+  if (size < sizeof(tkPackHeader) || header->Magic != kPackMagic || header->Version != kPackVersion ||
+      header->IndexOffset + static_cast<u64>(header->EntryCount) * sizeof(tkPackEntry) > size)
+  {
+    tkLogWarning("Pack::Open: %s is not a version %u pack", path.c_str(), kPackVersion);
+    return false;
+  }
+
+  const tkPackEntry* entries = reinterpret_cast<const tkPackEntry*>(base + header->IndexOffset);
+  for (u32 i = 0; i < header->EntryCount; i++)
+  {
+    if (entries[i].Offset + entries[i].StoredSize > size || (i > 0 && entries[i].Hash <= entries[i - 1].Hash))
+    {
+      tkLogWarning("Pack::Open: %s has a corrupt index", path.c_str());
+      return false;
+    }
+  }
+
+  std::error_code error;
+  const auto writeTime = std::filesystem::last_write_time(path, error);
+  mFile = tkFileView(file, base, static_cast<size_t>(size));
+  mHeader = header;
+  mEntries = entries;
+  mTime = error ? 0 : static_cast<i64>(writeTime.time_since_epoch().count());
+  return true;
+}
+
+const tkPackEntry* tkPack::FindEntry(u64 hash) const
+{
+  const tkPackEntry* end = mEntries + mHeader->EntryCount;
+  const tkPackEntry* entry = std::lower_bound(mEntries, end, hash, [](const tkPackEntry& e, u64 h) { return e.Hash < h; });
+  return entry != end && entry->Hash == hash ? entry : nullptr;
+}
+
+tkFileView tkPack::Read(const tkPackEntry& entry) const
+{
+  if (entry.Compression == ePackCompression::None)
+  {
+    return mFile.Slice(static_cast<size_t>(entry.Offset), static_cast<size_t>(entry.Size));
+  }
+
+  auto data = std::make_shared<tkDArray<u8>>(entry.Size);
+  const char* source = reinterpret_cast<const char*>(mFile.GetBytes().data() + entry.Offset);
+  bool success = false;
+  if (entry.Compression == ePackCompression::LZ4)
+  {
+    const i32 result = LZ4_decompress_safe(source, reinterpret_cast<char*>(data->data()), static_cast<i32>(entry.StoredSize), static_cast<i32>(entry.Size));
+    success = result == static_cast<i32>(entry.Size);
+  }
+  else if (entry.Compression == ePackCompression::Zstd)
+  {
+    const size_t result = ZSTD_decompress(data->data(), data->size(), source, static_cast<size_t>(entry.StoredSize));
+    success = !ZSTD_isError(result) && result == entry.Size;
+  }
+
+  if (!success)
+  {
+    tkLogWarning("Pack::Read: Failed to decompress entry %llx", static_cast<unsigned long long>(entry.Hash));
+    return {};
+  }
+
+  const u8* bytes = data->data();
+  return tkFileView(std::move(data), bytes, static_cast<size_t>(entry.Size));
+}
+
+bool tkPack::Mount(const tkString& path)
+{
+  auto pack = std::make_shared<tkPack>();
+  if (!pack->Open(tkReader::ResolvePath(path)))
+  {
+    return false;
+  }
+
+  std::lock_guard lock(sMountMutex);
+  sMounted.insert(sMounted.begin(), std::move(pack));
+  return true;
+}
+
+void tkPack::UnmountAll()
+{
+  std::lock_guard lock(sMountMutex);
+  sMounted.clear();
+}
+
+tkFileView tkPack::Find(std::string_view path)
+{
+  const u64 hash = HashPath(path);
+
+  // Only the lookup holds the mount lock, decompression runs outside it. The
+  // shared_ptr keeps the pack and its index alive if it is unmounted meanwhile.
+  std::shared_ptr<tkPack> found;
+  const tkPackEntry* entry = nullptr;
+  {
+    std::lock_guard lock(sMountMutex);
+    for (const std::shared_ptr<tkPack>& pack : sMounted)
+    {
+      if ((entry = pack->FindEntry(hash)))
+      {
+        found = pack;
+        break;
+      }
+    }
+  }
+  return found ? found->Read(*entry) : tkFileView();
+}
+
+bool tkPack::Contains(std::string_view path)
+{
+  const u64 hash = HashPath(path);
+
+  std::lock_guard lock(sMountMutex);
+  return std::any_of(sMounted.begin(), sMounted.end(), [hash](const std::shared_ptr<tkPack>& pack) { return pack->FindEntry(hash) != nullptr; });
+}
+
+bool tkPack::GetStamp(std::string_view path, u64& size, i64& time)
+{
+  const u64 hash = HashPath(path);
+
+  std::lock_guard lock(sMountMutex);
+  for (const std::shared_ptr<tkPack>& pack : sMounted)
+  {
+    if (const tkPackEntry* entry = pack->FindEntry(hash))
+    {
+      size = entry->Size;
+      time = pack->mTime;
+      return true;
+    }
+  }
+  return false;
+}
+
+void tkPackBuilder::AddFile(const tkString& path, const tkString& sourcePath, ePackCompression compression)
+{
+  mEntries.push_back({path, sourcePath, compression});
+}
+
+void tkPackBuilder::AddDirectory(const tkString& directory, ePackCompression compression)
+{
+  for (const auto& file : std::filesystem::recursive_directory_iterator(directory))
+  {
+    if (file.is_regular_file() && file.path().extension() != ".tkpak")
+    {
+      AddFile(std::filesystem::relative(file.path(), directory).generic_string(), file.path().string(), compression);
+    }
+  }
+}
+
+static bool CompressEntry(ePackCompression compression, const tkDArray<u8>& source, tkDArray<u8>& out)
+{
+  if (compression == ePackCompression::LZ4)
+  {
+    out.resize(static_cast<size_t>(LZ4_compressBound(static_cast<i32>(source.size()))));
+    const i32 size = LZ4_compress_default(reinterpret_cast<const char*>(source.data()), reinterpret_cast<char*>(out.data()),
+                                          static_cast<i32>(source.size()), static_cast<i32>(out.size()));
+    out.resize(static_cast<size_t>(std::max(size, 0)));
+    return size > 0;
+  }
+  if (compression == ePackCompression::Zstd)
+  {
+    out.resize(ZSTD_compressBound(source.size()));
+    const size_t size = ZSTD_compress(out.data(), out.size(), source.data(), source.size(), kPackZstdLevel);
+    if (ZSTD_isError(size))
+    {
+      return false;
+    }
+    out.resize(size);
+    return true;
+  }
+  return false;
+}
+
+bool tkPackBuilder::Write(const tkString& outputPath) const
+{
+  struct tkBuiltEntry
+  {
+    tkPackEntry Entry;
+    tkDArray<u8> Data;
+  };
+
+  tkDArray<tkBuiltEntry> built;
+  built.reserve(mEntries.size());
+  for (const tkPendingEntry& pending : mEntries)
+  {
+    std::ifstream file(pending.SourcePath, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+      tkLogWarning("PackBuilder::Write: Failed to open %s", pending.SourcePath.c_str());
+      return false;
+    }
+
+    tkDArray<u8> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    tkBuiltEntry entry{.Entry = {.Hash = tkPack::HashPath(pending.Path), .Size = source.size()}};
+
+    tkDArray<u8> compressed;
+    if (!source.empty() && CompressEntry(pending.Compression, source, compressed) &&
+        static_cast<f32>(compressed.size()) < static_cast<f32>(source.size()) * kPackMinCompressionRatio)
+    {
+      entry.Entry.Compression = pending.Compression;
+      entry.Data = std::move(compressed);
+    }
+    else
+    {
+      entry.Entry.Compression = ePackCompression::None;
+      entry.Data = std::move(source);
+    }
+    entry.Entry.StoredSize = entry.Data.size();
+    built.push_back(std::move(entry));
+  }
+
+  std::sort(built.begin(), built.end(), [](const tkBuiltEntry& a, const tkBuiltEntry& b) { return a.Entry.Hash < b.Entry.Hash; });
+  for (u32 i = 1; i < built.size(); i++)
+  {
+    if (built[i].Entry.Hash == built[i - 1].Entry.Hash)
+    {
+      tkLogWarning("PackBuilder::Write: Path hash collision in %s", outputPath.c_str());
+      return false;
+    }
+  }
+
+  tkPackHeader header{
+    .Magic = kPackMagic,
+    .Version = kPackVersion,
+    .EntryCount = static_cast<u32>(built.size()),
+    .IndexOffset = sizeof(tkPackHeader),
+  };
+
+  u64 offset = header.IndexOffset + built.size() * sizeof(tkPackEntry);
+  for (tkBuiltEntry& entry : built)
+  {
+    entry.Entry.Offset = AlignPackOffset(offset);
+    offset = entry.Entry.Offset + entry.Entry.StoredSize;
+  }
+
+  std::ofstream file(outputPath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    tkLogWarning("PackBuilder::Write: Failed to open %s", outputPath.c_str());
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const tkBuiltEntry& entry : built)
+  {
+    file.write(reinterpret_cast<const char*>(&entry.Entry), sizeof(tkPackEntry));
+  }
+
+  offset = header.IndexOffset + built.size() * sizeof(tkPackEntry);
+  const tkDArray<char> padding(kPackAlignment, 0);
+  for (const tkBuiltEntry& entry : built)
+  {
+    file.write(padding.data(), static_cast<std::streamsize>(entry.Entry.Offset - offset));
+    file.write(reinterpret_cast<const char*>(entry.Data.data()), static_cast<std::streamsize>(entry.Data.size()));
+    offset = entry.Entry.Offset + entry.Entry.StoredSize;
+  }
+
+  return file.good();
+}
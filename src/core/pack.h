@@ -0,0 +1,86 @@
+#ifndef TK_PACK_H
+#define TK_PACK_H
+
+#include "def.h"
+#include "reader.h"
+#include <memory>
+#include <mutex>
+
+const u32 kPackMagic = 0x4B504B54; // "TKPK"
+const u32 kPackVersion = 1;
+const u64 kPackAlignment = 64 * 1024;
+const char* const kAssetPack = "assets.tkpak";
+
+enum class ePackCompression : u32
+{
+  None = 0,
+  LZ4,
+  Zstd,
+};
+
+struct tkPackHeader
+{
+  u32 Magic;
+  u32 Version;
+  u32 EntryCount;
+  u32 Padding;
+  u64 IndexOffset;
+};
+
+// Index entries are sorted by path hash. Entry data starts on a kPackAlignment
+// boundary so uncompressed entries can be handed out straight from the mapping.
+struct tkPackEntry
+{
+  u64 Hash;
+  u64 Offset;
+  u64 StoredSize;
+  u64 Size;
+  ePackCompression Compression;
+  u32 Padding;
+};
+
+class tkPack
+{
+  tkFileView mFile;
+  const tkPackHeader* mHeader = nullptr;
+  const tkPackEntry* mEntries = nullptr;
+  // Modification time of the pack file, stamps every entry in it.
+  i64 mTime = 0;
+
+  static std::mutex sMountMutex;
+  static tkDArray<std::shared_ptr<tkPack>> sMounted;
+
+public:
+  bool Open(const tkString& path);
+  [[nodiscard]] const tkPackEntry* FindEntry(u64 hash) const;
+  [[nodiscard]] tkFileView Read(const tkPackEntry& entry) const;
+
+  static u64 HashPath(std::string_view path);
+
+  // Mounted packs are searched newest first, so patches can shadow earlier packs.
+  static bool Mount(const tkString& path);
+  static void UnmountAll();
+  static tkFileView Find(std::string_view path);
+  static bool Contains(std::string_view path);
+  // Unpacked size of the entry and the modification time of the pack holding it.
+  static bool GetStamp(std::string_view path, u64& size, i64& time);
+};
+
+class tkPackBuilder
+{
+  struct tkPendingEntry
+  {
+    tkString Path;
+    tkString SourcePath;
+    ePackCompression Compression;
+  };
+
+  tkDArray<tkPendingEntry> mEntries;
+
+public:
+  void AddFile(const tkString& path, const tkString& sourcePath, ePackCompression compression);
+  void AddDirectory(const tkString& directory, ePackCompression compression);
+  bool Write(const tkString& outputPath) const;
+};
+
+#endif//TK_PACK_H
@@ -1,6 +1,10 @@
-#include "Reader.h"
+#include "reader.h"
 #include "def.h"
+#include "mappedFile.h"
+#include "pack.h"
 #include <fstream>
+#include <cstring>
+#include <filesystem>
 
 #if defined(__EMSCRIPTEN__)
 #define RESOURCE_PATH std::string("res/")
@@ -8,6 +12,12 @@
 #define RESOURCE_PATH std::string("res/")
 #endif
 
+tkFileView::tkFileView(std::shared_ptr<const void> owner, const uint8_t* data, size_t size) :
+  m_Owner(std::move(owner)),
+  m_Data(data),
+  m_Size(size)
+{}
+
 tkReader::tkReader(const EReaderType type, const EReaderMode mode, const EReaderFormat format) :
   m_Type(type),
   m_Mode(mode),
@@ -46,7 +56,7 @@ bool tkReader::Open(const std::string& path)
     return false;
   }
 
-  int flags = 0;
+  std::ios::openmode flags{};
   if (m_Mode == EReaderMode::Read)
   {
     flags |= std::ios::in;
@@ -65,7 +75,7 @@ bool tkReader::Open(const std::string& path)
     flags |= std::ios::binary;
   }
 
-  m_File.open(std::string("../res/") + path, flags);
+  m_File.open(ResolvePath(path), flags);
   if (!m_File.is_open())
   {
     printf("Reader::Open: Failed to open file %s\n", (RESOURCE_PATH + path).c_str());
@@ -98,12 +108,17 @@ std::string tkReader::Read()
     return "";
   }
 
-  std::string line;
   std::string content;
-  while (std::getline(m_File, line))
+  m_File.seekg(0, std::ios::end);
+  const std::streamoff size = m_File.tellg();
+  if (size > 0)
   {
-    content += line + "\n";
+    content.resize(static_cast<size_t>(size));
+    m_File.seekg(0, std::ios::beg);
+    m_File.read(content.data(), size);
+    content.resize(static_cast<size_t>(m_File.gcount()));
   }
+  m_File.clear();
 
   Close();
   return content;
@@ -115,17 +130,118 @@ std::string tkReader::Read(const std::string &path)
   return Read();
 }
 
+tkFileView tkReader::Map(const std::string& path) const
+{
+  if (m_Type != EReaderType::File)
+  {
+    printf("Reader::Map: Reader type is not File\n");
+    return {};
+  }
+
+  if (tkFileView packed = tkPack::Find(path); packed.IsValid())
+  {
+    return packed;
+  }
+  return MapLoose(path);
+}
+
+tkFileView tkReader::MapLoose(const std::string& path)
+{
+  auto file = std::make_shared<tkMappedFile>();
+  if (!file->Open(ResolvePath(path)))
+  {
+    return {};
+  }
+  const uint8_t* data = file->GetData();
+  const size_t size = static_cast<size_t>(file->GetSize());
+  return tkFileView(std::move(file), data, size);
+}
+
 const char* tkReader::ReadCStr()
 {
   tkReader& reader = tkReader::TextFileReader();
-  reader.SetMemory(reader.Read().c_str());
+  reader.SetMemory(reader.Read());
   return reader.GetMemory();
 }
 
+std::string tkReader::ResolvePath(const std::string& path)
+{
+  return std::string("../res/") + path;
+}
+
+bool tkReader::Exists(const std::string& path)
+{
+  if (tkPack::Contains(path))
+  {
+    return true;
+  }
+  std::error_code error;
+  return std::filesystem::exists(ResolvePath(path), error);
+}
+
+bool tkReader::GetFileStamp(const std::string& path, uint64_t& size, int64_t& time)
+{
+  if (tkPack::GetStamp(path, size, time))
+  {
+    return true;
+  }
+
+  std::error_code error;
+  const std::string resolved = ResolvePath(path);
+  size = std::filesystem::file_size(resolved, error);
+  if (!error)
+  {
+    time = static_cast<int64_t>(std::filesystem::last_write_time(resolved, error).time_since_epoch().count());
+  }
+  if (error)
+  {
+    size = 0;
+    time = 0;
+    return false;
+  }
+  return true;
+}
+
 const char *tkReader::ReadTextFile(const std::string &path)
 {
-  tkReader::TextFileReader().Open(path);
-  return ReadCStr();
+  tkReader& reader = tkReader::TextFileReader();
+
+  // Pack entries are followed by the next entry or end with their heap buffer,
+  // so they are always copied out with a terminator.
+  if (tkFileView packed = tkPack::Find(path); packed.IsValid())
+  {
+    reader.SetMemory(packed.GetText());
+    return reader.GetMemory();
+  }
+
+  tkFileView view = MapLoose(path);
+  if (!view.IsValid())
+  {
+    reader.ClearMemory();
+    return "";
+  }
+
+  // The rest of the last mapped page is zero filled, so the mapping is already
+  // null terminated unless the file ends exactly on a page boundary.
+  if (view.GetSize() % tkMappedFile::GetPageSize() != 0)
+  {
+    reader.ClearMemory();
+    reader.m_View = std::move(view);
+    return reader.m_View.GetText().data();
+  }
+
+  reader.SetMemory(view.GetText());
+  return reader.GetMemory();
+}
+
+tkFileView tkReader::MapTextFile(const std::string& path)
+{
+  return tkReader::TextFileReader().Map(path);
+}
+
+tkFileView tkReader::MapBinaryFile(const std::string& path)
+{
+  return tkReader::CreateBinaryFileReader().Map(path);
 }
 
 tkReader::~tkReader()
@@ -141,6 +257,7 @@ bool tkReader::IsMemoryValid() const
 
 void tkReader::ClearMemory()
 {
+  m_View = {};
   if(IsMemoryValid())
   {
     delete[] m_Memory;
@@ -148,12 +265,12 @@ void tkReader::ClearMemory()
   }
 }
 
-void tkReader::SetMemory(const char *memory)
+void tkReader::SetMemory(std::string_view memory)
 {
   ClearMemory();
-  i32 len = strlen(memory) + 1;
-  m_Memory = new char[len];
-  strcpy_s(m_Memory, len, memory);
+  m_Memory = new char[memory.size() + 1];
+  memcpy(m_Memory, memory.data(), memory.size());
+  m_Memory[memory.size()] = '\0';
 }
 
 const char *tkReader::GetMemory()
@@ -2,8 +2,12 @@
 #define TK_READER_H
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <memory>
 #include <fstream>
 #include <vector>
+#include <cstdint>
 
 enum class EReaderType
 {
@@ -24,6 +28,23 @@ enum class EReaderFormat
     Text
 };
 
+// Read-only view of a whole file. The mapping lives as long as any copy of the view.
+class tkFileView
+{
+    std::shared_ptr<const void> m_Owner;
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+public:
+    tkFileView() = default;
+    tkFileView(std::shared_ptr<const void> owner, const uint8_t* data, size_t size);
+
+    [[nodiscard]] bool IsValid() const { return m_Owner != nullptr; }
+    [[nodiscard]] size_t GetSize() const { return m_Size; }
+    [[nodiscard]] std::span<const uint8_t> GetBytes() const { return {m_Data, m_Size}; }
+    [[nodiscard]] std::string_view GetText() const { return {reinterpret_cast<const char*>(m_Data), m_Size}; }
+    [[nodiscard]] tkFileView Slice(size_t offset, size_t size) const { return {m_Owner, m_Data + offset, size}; }
+};
+
 class tkReader
 {
 private:
@@ -32,16 +53,27 @@ private:
     EReaderFormat m_Format;
 
     char* m_Memory = nullptr;
+    tkFileView m_View;
 
     std::fstream m_File;
 public:
     static const char* ReadTextFile(const std::string& path);
+    static tkFileView MapTextFile(const std::string& path);
+    static tkFileView MapBinaryFile(const std::string& path);
+    static std::string ResolvePath(const std::string& path);
+    // True when the path is in a mounted pack or exists as a loose file.
+    static bool Exists(const std::string& path);
+    // Size and modification time of a resource, zero when it does not exist. Packed
+    // resources are stamped with the time of their pack, so rebuilding it invalidates them.
+    static bool GetFileStamp(const std::string& path, uint64_t& size, int64_t& time);
 private:
     tkReader(EReaderType type = EReaderType::File, EReaderMode mode = EReaderMode::Read, EReaderFormat format = EReaderFormat::Text);
     ~tkReader();
     bool Open(const std::string& path);
     std::string Read(const std::string& path);
     std::string Read();
+    tkFileView Map(const std::string& path) const;
+    static tkFileView MapLoose(const std::string& path);
     [[maybe_unused]] static tkReader& TextFileReader();
     [[maybe_unused]] static tkReader& CreateBinaryFileReader();
     [[maybe_unused]] static tkReader& CreateTextMemoryReader();
@@ -50,7 +82,7 @@ private:
     [[nodiscard]] bool IsMemoryValid() const;
     void ClearMemory();
     const char* GetMemory();
-    void SetMemory(const char* memory);
+    void SetMemory(std::string_view memory);
     void Close();
 };
 
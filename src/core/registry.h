@@ -1,7 +1,9 @@
 #ifndef TK_REGISTRY_H
 #define TK_REGISTRY_H
 
-#include "entt/entt.hpp"
+#include "entt/entt.hpp"
+#include "def.h"
+#include "logger.h"
 
 class tkRegistry
 {
@@ -9,6 +11,32 @@ class tkRegistry
 
 public:
 	static entt::registry& Get();
+
+	template <typename... C>
+	static tkDArray<entt::entity> CreateEntities(u32 count, const C&... components)
+	{
+		entt::registry& registry = Get();
+		tkDArray<entt::entity> entities(count);
+		registry.storage<entt::entity>().reserve(registry.storage<entt::entity>().size() + count);
+		(registry.storage<C>().reserve(registry.storage<C>().size() + count), ...);
+		registry.create(entities.begin(), entities.end());
+		(registry.insert<C>(entities.begin(), entities.end(), components), ...);
+		return entities;
+	}
+
+	template <typename C>
+	static void AddComponents(const tkDArray<entt::entity>& entities, const tkDArray<C>& components)
+	{
+		if (components.size() < entities.size())
+		{
+			tkLogError("Registry::AddComponents: %zu components for %zu entities", components.size(), entities.size());
+			return;
+		}
+
+		entt::registry& registry = Get();
+		registry.storage<C>().reserve(registry.storage<C>().size() + entities.size());
+		registry.insert<C>(entities.begin(), entities.end(), components.begin());
+	}
 };
 
 #endif//TK_REGISTRY_H
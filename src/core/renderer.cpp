@@ -8,8 +8,14 @@
 #include <chrono>
 #include <glm/gtc/matrix_transform.hpp>
 #include "../components/shape2d.h"
+#include "../systems/sPhysics2dGpu.h"
 #include "../systems/sRender2d.h"
+#include "../systems/sRenderMesh.h"
+#include "../systems/sRenderParticles.h"
+#include "../systems/sRenderSprite.h"
+#include "../systems/sRenderText.h"
 #include "reader.h"
+#include "assets.h"
 
 
 tkRenderer& tkRenderer::Get()
@@ -67,17 +73,18 @@ void tkRenderer::Init(tkWindow& window)
     {
       for (u32 j = 0; j < 1000000; j+=4)
       {
-        vertices[i].push_back(Vertex{v2(-0.5f, -0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
-        vertices[i].push_back(Vertex{v2(0.5f, -0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
-        vertices[i].push_back(Vertex{v2(0.5f, 0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
-        vertices[i].push_back(Vertex{v2(-0.5f, 0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
-
-        indices[i].push_back(j);
-        indices[i].push_back(j + 1);
-        indices[i].push_back(j + 2);
-        indices[i].push_back(j + 3);
-        indices[i].push_back(j);
-        indices[i].push_back(0xFFFF);
+        const u32 base = static_cast<u32>(mLineVertices.size());
+        mLineVertices.push_back(Vertex{v2(-0.5f, -0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
+        mLineVertices.push_back(Vertex{v2(0.5f, -0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
+        mLineVertices.push_back(Vertex{v2(0.5f, 0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
+        mLineVertices.push_back(Vertex{v2(-0.5f, 0.5f) * (f32)i / 1000.f, v3(1.0f, 1.0f, 1.0f)});
+
+        mLineIndices.push_back(base);
+        mLineIndices.push_back(base + 1);
+        mLineIndices.push_back(base + 2);
+        mLineIndices.push_back(base + 3);
+        mLineIndices.push_back(base);
+        mLineIndices.push_back(kGeometryRestartIndex);
       }
     }
 
@@ -92,19 +99,70 @@ void tkRenderer::InitGraphics()
 {
     SetupSwapChain();
     SetupLineVertexBuffer();
-    SetupLineIndexBuffer();
-    SetupMVPUniformsBuffer();
-    SetupLineBindGroup();
+    SetupLineGeometry();
+    mBindGroupCache.Setup(wDevice);
+    mSamplerCache.Setup(wDevice);
+    mUniformPool.Setup(wDevice, mBindGroupCache);
+    SetupLineBindGroupLayout();
     SetupDepthStencil();
     SetupSampler();
+    mMipGenerator.Setup(wDevice, tkReader::MapTextFile("shaders/mipmap.wgsl").GetText());
 
 //    SetupLineUniformBuffer();
 
     SetupPipelines();
+    mLights.Setup(wDevice, LoadShader("shaders/lightCluster.wgsl"));
+    mImageLighting.Setup(wDevice, LoadShader("shaders/ibl.wgsl"));
+    mGlyphCache.Setup(wDevice);
 
-    tsRender2d* rw2d = new tsRender2d();
-    rw2d->SetupBuffers();
-    RegisterRenderSystem(rw2d);
+    tsRenderMesh* renderMesh = new tsRenderMesh();
+    renderMesh->SetupPipelines();
+    RegisterRenderSystem(renderMesh);
+
+    mPhysics2dGpu = new tsPhysics2dGpu();
+    mPhysics2dGpu->SetupPipelines();
+    RegisterRenderSystem(mPhysics2dGpu);
+
+    mRender2d = new tsRender2d();
+    mRender2d->SetupPipelines();
+    RegisterRenderSystem(mRender2d);
+
+    tsRenderSprite* renderSprite = new tsRenderSprite();
+    renderSprite->SetupPipelines();
+    RegisterRenderSystem(renderSprite);
+
+    mParticles = new tsRenderParticles();
+    mParticles->SetupPipelines();
+    RegisterRenderSystem(mParticles);
+
+    tsRenderText* renderText = new tsRenderText();
+    renderText->SetupPipelines();
+    RegisterRenderSystem(renderText);
+}
+
+bool tkRenderer::LoadEnvironment(const tkString& path)
+{
+    return mImageLighting.LoadEnvironment(wDevice, path);
+}
+
+bool tkRenderer::LoadFont(const tkString& path)
+{
+    return mGlyphCache.LoadFont(path);
+}
+
+void tkRenderer::DrawPolyline(std::span<const v2> points, const tkLineStyle& style, bool closed)
+{
+    mRender2d->DrawPolyline(points, style, closed);
+}
+
+void tkRenderer::SetParticleSorting(bool sorted)
+{
+    mParticles->SetSorted(sorted);
+}
+
+void tkRenderer::SetGpuPhysics2dSettings(const tkGpuPhysics2dSettings& settings)
+{
+    mPhysics2dGpu->SetSettings(settings);
 }
 
 void tkRenderer::SetupSwapChain()
@@ -128,8 +186,9 @@ void tkRenderer::SetupDepthStencil()
             .stencilWriteMask = 0,
         };
 
+        // Sampled by the Hi-Z build in tsRenderMesh.
         wgpu::TextureDescriptor depthTextureDescriptor{
-                .usage = wgpu::TextureUsage::RenderAttachment,
+                .usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::TextureBinding,
                 .dimension = wgpu::TextureDimension::e2D,
                 .size = {kWindowWidth, kWindowHeight, 1},
                 .format = wgpu::TextureFormat::Depth16Unorm,
@@ -153,9 +212,17 @@ void tkRenderer::SetupDepthStencil()
         wDepthTextureView = wDepthTexture.CreateView(&depthTextureViewDescriptor);
 }
 
-void tkRenderer::LoadTextures(const tkString& name)
+tkHandle<tkTextureAsset> tkRenderer::LoadTexture(const tkString& path)
 {
+    if (auto it = mTextures.find(path); it != mTextures.end())
+    {
+        return it->second;
+    }
 
+    tkHandle<tkTextureAsset> handle = tkAssetManager::Get().Textures.Acquire(path);
+    mTextures.emplace(path, handle);
+    mTextureStreamer.Track(handle, path);
+    return handle;
 }
 
 void tkRenderer::SetupSampler()
@@ -168,12 +235,12 @@ void tkRenderer::SetupSampler()
         .minFilter = wgpu::FilterMode::Linear,
         .mipmapFilter = wgpu::MipmapFilterMode::Linear,
         .lodMinClamp = 0.0f,
-        .lodMaxClamp = 1.0f,
+        .lodMaxClamp = 32.0f,
         .compare = wgpu::CompareFunction::Undefined,
         .maxAnisotropy = 1,
     };
 
-    wSampler = wDevice.CreateSampler(&samplerDescriptor);
+    wSampler = mSamplerCache.Get(samplerDescriptor);
 }
 
 void tkRenderer::SetupPipelines()
@@ -182,17 +249,27 @@ void tkRenderer::SetupPipelines()
     SetupLinePipeline();
 }
 
-void tkRenderer::SetupLinePipeline()
+wgpu::ShaderModule tkRenderer::LoadShader(const tkString& path)
 {
-    wgpu::ShaderModuleWGSLDescriptor wgslDesc{};
-    wgslDesc.code = tkReader::ReadTextFile("shaders/mesh.wgsl");
+    tkAssetPool<tkShaderAsset>& shaders = tkAssetManager::Get().Shaders;
+    auto it = mShaders.find(path);
+    if (it == mShaders.end())
+    {
+        it = mShaders.emplace(path, shaders.Acquire(path, eAssetLoad::Blocking)).first;
+    }
 
-    wgpu::ShaderModuleDescriptor shaderModuleDesc{
-        .nextInChain = &wgslDesc
-    };
+    tkShaderAsset* shader = shaders.Get(it->second);
+    if (!shader)
+    {
+        tkLogError("Failed to load shader %s", path.c_str());
+        return {};
+    }
+    return shader->Module;
+}
 
-    shaderModuleDesc.label = "Line";
-    wgpu::ShaderModule shaderModule = wDevice.CreateShaderModule(&shaderModuleDesc);
+void tkRenderer::SetupLinePipeline()
+{
+    wgpu::ShaderModule shaderModule = LoadShader("shaders/mesh.wgsl");
 
     wgpu::ColorTargetState colorTargetState{
         .format = wgpu::TextureFormat::BGRA8Unorm
@@ -206,7 +283,8 @@ void tkRenderer::SetupLinePipeline()
     wgpu::PrimitiveState primitiveState;
     primitiveState.topology = wgpu::PrimitiveTopology::LineStrip;
     primitiveState.cullMode = wgpu::CullMode::None;
-    primitiveState.stripIndexFormat = wgpu::IndexFormat::Uint16;
+    // Must match the restart value of the uploaded indices.
+    primitiveState.stripIndexFormat = mLineGeometry.GetFormat();
 
     wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
         .bindGroupLayoutCount = 1,
@@ -297,17 +375,6 @@ void tkRenderer::SetupLineVertexBuffer()
     wVertexBufferLayouts[0].arrayStride = sizeof(Vertex);
     wVertexBufferLayouts[0].attributes = wVertexAttributes.data();
     wVertexBufferLayouts[0].stepMode = wgpu::VertexStepMode::Vertex;
-
-    wgpu::BufferDescriptor bufferDesc;
-    bufferDesc.label = "Line Vertex Buffer";
-    bufferDesc.size = vertices.size() * sizeof(Vertex);
-    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
-    bufferDesc.mappedAtCreation = false;
-    mLineVertexBuffer = wDevice.CreateBuffer(&bufferDesc);
-    for (u32 i = 0; i < 4; i++)
-    {
-        wDevice.GetQueue().WriteBuffer(mLineVertexBuffer, i * bufferDesc.size, vertices.data(), bufferDesc.size);
-    }
 }
 
 void tkRenderer::AddRect(tcRect& rect, v2& pos)
@@ -347,12 +414,6 @@ void tkRenderer::Render()
         .colorAttachments = &attachment,
         .depthStencilAttachment = &depthStencilAttachment};
 
-    wgpu::CommandEncoder encoder = wDevice.CreateCommandEncoder();
-    wgpu::RenderPassEncoder pass = encoder.BeginRenderPass(&renderpassDesc);
-
-    pass.SetPipeline(wLinePipeline);
-    pass.SetBindGroup(0, wLineBindGroup);
-
   static auto startTime = std::chrono::high_resolution_clock::now();
 
   auto currentTime = std::chrono::high_resolution_clock::now();
@@ -363,17 +424,41 @@ void tkRenderer::Render()
     mMvpUniforms.View = glm::lookAt(v3(2.f, 2.f, 200.f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 0.f, 1.f));
     mMvpUniforms.Projection = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 100000.f);
 
-    wDevice.GetQueue().WriteBuffer(wMVPUniformsBuffer, 0, &mMvpUniforms, sizeof(MVPUniforms));
-//    wDevice.GetQueue().WriteBuffer(mLineVertexBuffer, 0, vertices.data(), vertices.size() * sizeof(Vertex));
+    mBindGroupCache.BeginFrame();
+    mTextureViewCache.BeginFrame();
+    mUniformPool.BeginFrame();
+    wgpu::CommandEncoder encoder = wDevice.CreateCommandEncoder();
+
+    // Depth is cleared up front so PreRender passes (e.g. the mesh depth prepass) can
+    // write into it before the main pass loads it.
+    wgpu::RenderPassDescriptor depthClearDesc{.depthStencilAttachment = &depthStencilAttachment};
+    encoder.BeginRenderPass(&depthClearDesc).End();
+    depthStencilAttachment.depthLoadOp = wgpu::LoadOp::Load;
+
+    mTextureStreamer.Update();
+    mTransforms2d.Sync(wDevice);
+    mLights.Update(wDevice, encoder, mMvpUniforms.View, mMvpUniforms.Projection);
+
+    for(tkRenderSystem* sys : mRenderSystems)
+    {
+        sys->PreRender(wDevice, encoder);
+    }
 
-    pass.SetVertexBuffer(0, mLineVertexBuffer, 0);
-    pass.SetBindGroup(0, wLineBindGroup);
-    pass.SetIndexBuffer(mLineIndexBuffer, wgpu::IndexFormat::Uint16, 0, indices.size() * sizeof(u16));
-    pass.DrawIndexed(indices.size(), 1, 0, 0, 0);
+    wgpu::RenderPassEncoder pass = encoder.BeginRenderPass(&renderpassDesc);
+
+    const tkUniformSlice mvp = mUniformPool.Push(mMvpUniforms);
+    pass.SetPipeline(wLinePipeline);
+    pass.SetBindGroup(0, mUniformPool.GetBindGroup(mvp, wLineBindGroupLayout, sizeof(MVPUniforms)), 1, &mvp.Offset);
+
+    mLineGeometry.Draw(pass);
+
+    IterateRenderSystems(pass);
 
     pass.End();
     wgpu::CommandBuffer commands = encoder.Finish();
-    wDevice.GetQueue().Submit(1, &commands);
+    wgpu::Queue queue = wDevice.GetQueue();
+    mUniformPool.Flush(queue);
+    queue.Submit(1, &commands);
 
     wSwapChain.Present();
     wInstance.ProcessEvents();
@@ -397,23 +482,22 @@ wgpu::Device &tkRenderer::GetDevice()
   return Get().wDevice;
 }
 
-void tkRenderer::SetupLineIndexBuffer()
+void tkRenderer::SetupLineGeometry()
 {
-    wgpu::BufferDescriptor bufferDesc;
-    bufferDesc.label = "Line Index Buffer";
-    bufferDesc.size = indices.size() * sizeof(u16);
-    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
-    bufferDesc.mappedAtCreation = false;
-    mLineIndexBuffer = wDevice.CreateBuffer(&bufferDesc);
-    wDevice.GetQueue().WriteBuffer(mLineIndexBuffer, 0, indices.data(), bufferDesc.size);
+    // Four million vertices, so this picks 32-bit indices and draws in one call.
+    const std::span<const u8> vertexBytes(reinterpret_cast<const u8*>(mLineVertices.data()), mLineVertices.size() * sizeof(Vertex));
+    mLineGeometry.Upload(wDevice, "Line Geometry", vertexBytes, sizeof(Vertex), mLineIndices, wgpu::PrimitiveTopology::LineStrip);
+
+    mLineVertices = {};
+    mLineIndices = {};
 }
 
-void tkRenderer::SetupLineBindGroup()
+void tkRenderer::SetupLineBindGroupLayout()
 {
     wgpu::BindGroupLayoutEntry bindGroupLayoutEntry{
         .binding = 0,
         .visibility = wgpu::ShaderStage::Vertex,
-        .buffer = {.type = wgpu::BufferBindingType::Uniform, .hasDynamicOffset = false, .minBindingSize = sizeof(MVPUniforms)}
+        .buffer = {.type = wgpu::BufferBindingType::Uniform, .hasDynamicOffset = true, .minBindingSize = sizeof(MVPUniforms)}
     };
 
     wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{
@@ -421,30 +505,5 @@ void tkRenderer::SetupLineBindGroup()
         .entries = &bindGroupLayoutEntry
     };
 
-    wLineBindGroupLayout = wDevice.CreateBindGroupLayout(&bindGroupLayoutDesc);
-
-    wgpu::BindGroupEntry bindGroupEntry{
-        .binding = 0,
-        .buffer = wMVPUniformsBuffer,
-        .offset = 0,
-        .size = sizeof(MVPUniforms),
-    };
-
-    wgpu::BindGroupDescriptor bindGroupDesc{
-        .layout = wLineBindGroupLayout,
-        .entryCount = 1,
-        .entries = &bindGroupEntry
-    };
-
-    wLineBindGroup = wDevice.CreateBindGroup(&bindGroupDesc);
-}
-
-void tkRenderer::SetupMVPUniformsBuffer()
-{
-    wgpu::BufferDescriptor bufferDesc;
-    bufferDesc.label = "MVP Uniforms Buffer";
-    bufferDesc.size = sizeof(MVPUniforms);
-    bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
-    bufferDesc.mappedAtCreation = false;
-    wMVPUniformsBuffer = wDevice.CreateBuffer(&bufferDesc);
+    wLineBindGroupLayout = mBindGroupCache.GetLayout(bindGroupLayoutDesc);
 }
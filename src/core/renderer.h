@@ -3,6 +3,21 @@
 
 #include "def.h"
 #include "system.h"
+#include "assets.h"
+#include "lighting.h"
+#include "ibl.h"
+#include "mipmap.h"
+#include "objectCache.h"
+#include "atlas.h"
+#include "bindGroupCache.h"
+#include "font.h"
+#include "geometry.h"
+#include "gpuMirror.h"
+#include "textureStreamer.h"
+#include "uniformPool.h"
+#include "../components/transform2d.h"
+#include <span>
+#include <unordered_map>
 #include <webgpu/webgpu_cpp.h>
 #include <webgpu/webgpu_glfw.h>
 
@@ -43,17 +58,72 @@ class tkRenderer
 
   MVPUniforms mMvpUniforms;
 
-  wgpu::Buffer mLineVertexBuffer;
-  wgpu::Buffer mLineIndexBuffer;
+  // Filled in Init and released once uploaded to mLineGeometry.
+  tkDArray<Vertex> mLineVertices;
+  tkDArray<u32> mLineIndices;
+  tkIndexedGeometry mLineGeometry;
 
+  // MVPUniforms come from mUniformPool, selected with a dynamic offset.
   wgpu::BindGroupLayout wLineBindGroupLayout;
-  wgpu::BindGroup wLineBindGroup;
-  wgpu::Buffer wMVPUniformsBuffer;
+
+  tkLightClusters mLights;
+  tkImageBasedLighting mImageLighting;
+  tkTextureStreamer mTextureStreamer;
+  tkMipGenerator mMipGenerator;
+  tkSpriteAtlas mSpriteAtlas;
+  tkGlyphCache mGlyphCache;
+  tkBindGroupCache mBindGroupCache;
+  tkSamplerCache mSamplerCache;
+  tkTextureViewCache mTextureViewCache;
+  tkUniformPool mUniformPool;
+  // Synced once a frame before PreRender, for systems that index transforms on the GPU.
+  tkGpuMirror<tcTransform2d> mTransforms2d{"Transforms 2D"};
 
   tkDArray<tkRenderSystem*> mRenderSystems;
+  class tsRender2d* mRender2d = nullptr;
+  class tsRenderParticles* mParticles = nullptr;
+  class tsPhysics2dGpu* mPhysics2dGpu = nullptr;
+
+  std::unordered_map<tkString, tkHandle<tkShaderAsset>> mShaders;
+  std::unordered_map<tkString, tkHandle<tkTextureAsset>> mTextures;
 public:
   static tkRenderer& Get();
   static wgpu::Device& GetDevice();
+
+  // Equirectangular HDR used for ambient diffuse and specular lighting.
+  bool LoadEnvironment(const tkString& path);
+  // TrueType font used by all tcText.
+  bool LoadFont(const tkString& path);
+  // Texture from the asset pool whose finer mips are streamed by the texture streamer.
+  // Report its on-screen size with GetTextureStreamer().RequestMip wherever it is drawn.
+  tkHandle<tkTextureAsset> LoadTexture(const tkString& path);
+
+  tkTextureStreamer& GetTextureStreamer() { return mTextureStreamer; }
+  const tkMipGenerator& GetMipGenerator() const { return mMipGenerator; }
+  tkSpriteAtlas& GetSpriteAtlas() { return mSpriteAtlas; }
+  // Per-object constants for the current frame, see tkUniformPool.
+  tkUniformPool& GetUniformPool() { return mUniformPool; }
+  tkBindGroupCache& GetBindGroupCache() { return mBindGroupCache; }
+  // Shared handles for equal descriptors, prefer these over creating samplers and views.
+  wgpu::Sampler GetSampler(const wgpu::SamplerDescriptor& desc) { return mSamplerCache.Get(desc); }
+  wgpu::TextureView GetTextureView(const wgpu::Texture& texture, const wgpu::TextureViewDescriptor& desc = {}) { return mTextureViewCache.Get(texture, desc); }
+  // Scene depth test without writes, so blended draws are hidden by the scene but never
+  // hide what is drawn after them.
+  // World space eye position of the current view.
+  v3 GetViewPosition() const { return v3(glm::inverse(mMvpUniforms.View)[3]); }
+  wgpu::DepthStencilState GetBlendedDepthState() const
+  {
+    wgpu::DepthStencilState depthStencilState = wDepthStencilState;
+    depthStencilState.depthWriteEnabled = false;
+    return depthStencilState;
+  }
+
+  // Thick anti-aliased line, drawn for the current frame only.
+  void DrawPolyline(std::span<const v2> points, const struct tkLineStyle& style, bool closed = false);
+  // Sort particles back to front before drawing, off by default.
+  void SetParticleSorting(bool sorted);
+  // Gravity and restitution for tcGpuBody2d bodies.
+  void SetGpuPhysics2dSettings(const struct tkGpuPhysics2dSettings& settings);
   
 private:
   tkRenderer();
@@ -61,7 +131,12 @@ private:
 
   friend class tkEngine;
   friend class tkRenderSystem;
+  friend class tsPhysics2dGpu;
   friend class tsRender2d;
+  friend class tsRenderMesh;
+  friend class tsRenderParticles;
+  friend class tsRenderSprite;
+  friend class tsRenderText;
 
 private:
   void Init(class tkWindow& window);
@@ -76,14 +151,13 @@ private:
 
   void SetupDepthStencil();
 
-  void LoadTextures(const tkString& name);
+  wgpu::ShaderModule LoadShader(const tkString& path);
   void SetupSampler();
 
   void SetupLineVertexBuffer();
-  void SetupLineIndexBuffer();
+  void SetupLineGeometry();
 
-  void SetupMVPUniformsBuffer();
-  void SetupLineBindGroup();
+  void SetupLineBindGroupLayout();
 
 //  void SetupLineUniformBuffer();
   void SetupLinePipeline();
@@ -18,6 +18,12 @@ protected:
   template <typename C>
   static void AddComponent(const entt::entity& entity, C& Component) { tkRegistry::Get().emplace<C>(entity, Component); }
 
+  template <typename...C>
+  static tkDArray<entt::entity> CreateEntities(u32 count, const C&... components) { return tkRegistry::CreateEntities<C...>(count, components...); }
+
+  template <typename C>
+  static void AddComponents(const tkDArray<entt::entity>& entities, const tkDArray<C>& components) { tkRegistry::AddComponents<C>(entities, components); }
+
   virtual void Init() {};
 
   template <typename...C>
@@ -35,6 +41,8 @@ class tkRenderSystem : public tkSystem
 {
 protected:
   friend class tkRenderer;
+  // Records work that must run before the main render pass, e.g. compute culling.
+  virtual void PreRender(wgpu::Device&, wgpu::CommandEncoder&) {}
   virtual void Render(wgpu::Device&, wgpu::RenderPassEncoder&) = 0;
 };
 
@@ -0,0 +1,322 @@
+#include "texture.h"
+#include "renderer.h"
+#include "reader.h"
+#include "pack.h"
+#include "logger.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static u32 GetMipSize(u32 size, u32 mip)
+{
+  return std::max(size >> mip, 1u);
+}
+
+bool tkTextureImporter::Import(std::span<const u8> data, const tkString& path, tkTextureData& texture)
+{
+  i32 width = 0;
+  i32 height = 0;
+  i32 channels = 0;
+  stbi_uc* pixels = stbi_load_from_memory(data.data(), static_cast<i32>(data.size()), &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels)
+  {
+    tkLogWarning("TextureImporter: Failed to decode %s", path.c_str());
+    return false;
+  }
+
+  texture.Width = static_cast<u32>(width);
+  texture.Height = static_cast<u32>(height);
+  texture.Pixels.assign(pixels, pixels + GetMipBytes(texture.Width, texture.Height, 0));
+  stbi_image_free(pixels);
+  return true;
+}
+
+tkString tkTextureImporter::GetCachePath(const tkString& path)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(tkPack::HashPath(path)));
+  return tkString("cache/") + name + ".tktex";
+}
+
+bool tkTextureImporter::ReadCacheHeader(const tkString& path, tkTextureCacheHeader& header)
+{
+  std::ifstream file(tkReader::ResolvePath(GetCachePath(path)), std::ios::in | std::ios::binary);
+  if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+  {
+    return false;
+  }
+
+  u64 size;
+  i64 time;
+  tkReader::GetFileStamp(path, size, time);
+  return header.Magic == kTextureCacheMagic && header.Version == kTextureCacheVersion &&
+         header.SourceSize == size && header.SourceTime == time;
+}
+
+void tkTextureImporter::WriteCache(const tkString& path, const tkTextureAsset& asset)
+{
+  tkTextureCacheHeader header{
+    .Magic = kTextureCacheMagic,
+    .Version = kTextureCacheVersion,
+    .Width = asset.Width,
+    .Height = asset.Height,
+    .MipCount = asset.MipCount,
+    .TailMip = GetTailMip(asset.Width, asset.Height),
+  };
+  tkReader::GetFileStamp(path, header.SourceSize, header.SourceTime);
+
+  // Smallest mip first, matching the file.
+  tkDArray<tkTextureRegion> regions;
+  for (u32 mip = asset.MipCount; mip-- > 0;)
+  {
+    regions.push_back({asset.Texture, mip, GetMipSize(asset.Width, mip), GetMipSize(asset.Height, mip), 1});
+  }
+
+  wgpu::Device& device = tkRenderer::GetDevice();
+  wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+  WriteRegions(device, encoder, tkReader::ResolvePath(GetCachePath(path)),
+               std::span(reinterpret_cast<const u8*>(&header), sizeof(header)), std::move(regions), kTextureTexelBytes, "Texture Readback");
+}
+
+void tkTextureImporter::WriteRegions(wgpu::Device& device, wgpu::CommandEncoder& encoder, const std::string& cachePath,
+                                     std::span<const u8> header, tkDArray<tkTextureRegion> regions, u32 texelBytes, const char* label)
+{
+  struct tkReadback
+  {
+    wgpu::Buffer Buffer;
+    tkDArray<tkTextureRegion> Regions;
+    tkDArray<u8> Header;
+    std::string CachePath;
+    u32 TexelBytes;
+  };
+
+  tkReadback* readback = new tkReadback{
+    .Regions = std::move(regions),
+    .Header = tkDArray<u8>(header.begin(), header.end()),
+    .CachePath = cachePath,
+    .TexelBytes = texelBytes,
+  };
+
+  // Buffer copies need 256 byte rows, the padding is stripped again when writing the file.
+  auto paddedRowBytes = [texelBytes](u32 width) { return (width * texelBytes + 255) & ~255u; };
+  u64 size = 0;
+  for (const tkTextureRegion& region : readback->Regions)
+  {
+    size += static_cast<u64>(paddedRowBytes(region.Width)) * region.Height * region.Layers;
+  }
+
+  wgpu::BufferDescriptor bufferDesc{
+    .label = label,
+    .usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst,
+    .size = size,
+  };
+  readback->Buffer = device.CreateBuffer(&bufferDesc);
+
+  u64 offset = 0;
+  for (const tkTextureRegion& region : readback->Regions)
+  {
+    wgpu::ImageCopyTexture source{.texture = region.Texture, .mipLevel = region.Mip};
+    wgpu::ImageCopyBuffer destination{
+      .layout = {.offset = offset, .bytesPerRow = paddedRowBytes(region.Width), .rowsPerImage = region.Height},
+      .buffer = readback->Buffer,
+    };
+    wgpu::Extent3D extent{region.Width, region.Height, region.Layers};
+    encoder.CopyTextureToBuffer(&source, &destination, &extent);
+    offset += static_cast<u64>(destination.layout.bytesPerRow) * region.Height * region.Layers;
+  }
+  wgpu::CommandBuffer commands = encoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+
+  readback->Buffer.MapAsync(wgpu::MapMode::Read, 0, size, [](WGPUBufferMapAsyncStatus status, void* userdata) {
+    tkReadback* readback = static_cast<tkReadback*>(userdata);
+    if (status != WGPUBufferMapAsyncStatus_Success)
+    {
+      tkLogWarning("TextureImporter: Readback for %s failed", readback->CachePath.c_str());
+      delete readback;
+      return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(readback->CachePath).parent_path(), error);
+    std::ofstream file(readback->CachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      tkLogWarning("TextureImporter: Failed to write cache %s", readback->CachePath.c_str());
+    }
+    else
+    {
+      const u8* data = static_cast<const u8*>(readback->Buffer.GetConstMappedRange());
+      file.write(reinterpret_cast<const char*>(readback->Header.data()), readback->Header.size());
+      for (const tkTextureRegion& region : readback->Regions)
+      {
+        const u32 rowBytes = region.Width * readback->TexelBytes;
+        const u32 paddedBytes = (rowBytes + 255) & ~255u;
+        for (u32 row = 0; row < region.Height * region.Layers; row++)
+        {
+          file.write(reinterpret_cast<const char*>(data), rowBytes);
+          data += paddedBytes;
+        }
+      }
+    }
+    readback->Buffer.Unmap();
+    delete readback;
+  }, readback);
+}
+
+u32 tkTextureImporter::GetMipCount(u32 width, u32 height)
+{
+  return std::bit_width(std::max(width, height));
+}
+
+u32 tkTextureImporter::GetTailMip(u32 width, u32 height)
+{
+  u32 mip = 0;
+  while (std::max(GetMipSize(width, mip), GetMipSize(height, mip)) > kTextureTailSize)
+  {
+    mip++;
+  }
+  return mip;
+}
+
+u64 tkTextureImporter::GetMipBytes(u32 width, u32 height, u32 mip)
+{
+  return static_cast<u64>(GetMipSize(width, mip)) * GetMipSize(height, mip) * kTextureTexelBytes;
+}
+
+u64 tkTextureImporter::GetMipOffset(u32 width, u32 height, u32 mipCount, u32 mip)
+{
+  return GetResidentBytes(width, height, mipCount, mip) - GetMipBytes(width, height, mip);
+}
+
+u64 tkTextureImporter::GetResidentBytes(u32 width, u32 height, u32 mipCount, u32 mip)
+{
+  u64 bytes = 0;
+  for (u32 m = mip; m < mipCount; m++)
+  {
+    bytes += GetMipBytes(width, height, m);
+  }
+  return bytes;
+}
+
+void tkTextureImporter::Create(tkTextureAsset& asset, const tkTextureData& texture, const tkString& label)
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+  const u32 mipCount = GetMipCount(texture.Width, texture.Height);
+  wgpu::TextureDescriptor textureDesc{
+    .label = label.c_str(),
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::StorageBinding |
+             wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::CopySrc,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {texture.Width, texture.Height, 1},
+    .format = wgpu::TextureFormat::RGBA8Unorm,
+    .mipLevelCount = mipCount,
+    .sampleCount = 1,
+  };
+  asset.Texture = device.CreateTexture(&textureDesc);
+  asset.View = asset.Texture.CreateView();
+  asset.Width = texture.Width;
+  asset.Height = texture.Height;
+  asset.MipCount = mipCount;
+  asset.TailMip = 0;
+  asset.ResidentMip = 0;
+  asset.Revision++;
+
+  wgpu::ImageCopyTexture destination{.texture = asset.Texture};
+  wgpu::TextureDataLayout layout{
+    .bytesPerRow = texture.Width * kTextureTexelBytes,
+    .rowsPerImage = texture.Height,
+  };
+  device.GetQueue().WriteTexture(&destination, texture.Pixels.data(), texture.Pixels.size(), &layout, &textureDesc.size);
+
+  wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+  tkRenderer::Get().GetMipGenerator().Generate(device, encoder, asset.Texture);
+  wgpu::CommandBuffer commands = encoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+}
+
+void tkTextureImporter::Upload(tkTextureAsset& asset, u32 width, u32 height, u32 mipCount, u32 tailMip, u32 firstMip,
+                               std::span<const u8> body, const tkString& label)
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+  wgpu::TextureDescriptor textureDesc{
+    .label = label.c_str(),
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::CopySrc,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {GetMipSize(width, firstMip), GetMipSize(height, firstMip), 1},
+    .format = wgpu::TextureFormat::RGBA8Unorm,
+    .mipLevelCount = mipCount - firstMip,
+    .sampleCount = 1,
+  };
+  asset.Texture = device.CreateTexture(&textureDesc);
+  asset.View = asset.Texture.CreateView();
+  asset.Width = width;
+  asset.Height = height;
+  asset.MipCount = mipCount;
+  asset.TailMip = tailMip;
+  asset.ResidentMip = firstMip;
+  asset.Revision++;
+
+  wgpu::Queue queue = device.GetQueue();
+  for (u32 mip = firstMip; mip < mipCount; mip++)
+  {
+    wgpu::ImageCopyTexture destination{.texture = asset.Texture, .mipLevel = mip - firstMip};
+    wgpu::TextureDataLayout layout{
+      .offset = GetMipOffset(width, height, mipCount, mip),
+      .bytesPerRow = GetMipSize(width, mip) * kTextureTexelBytes,
+      .rowsPerImage = GetMipSize(height, mip),
+    };
+    wgpu::Extent3D size{GetMipSize(width, mip), GetMipSize(height, mip), 1};
+    queue.WriteTexture(&destination, body.data(), body.size(), &layout, &size);
+  }
+}
+
+void tkTextureImporter::SetResidentMip(tkTextureAsset& asset, u32 mip, std::span<const u8> pixels)
+{
+  if (mip == asset.ResidentMip || mip >= asset.MipCount)
+  {
+    return;
+  }
+
+  wgpu::Device& device = tkRenderer::GetDevice();
+  wgpu::TextureDescriptor textureDesc{
+    .label = "Streamed Texture",
+    .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst | wgpu::TextureUsage::CopySrc,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {GetMipSize(asset.Width, mip), GetMipSize(asset.Height, mip), 1},
+    .format = wgpu::TextureFormat::RGBA8Unorm,
+    .mipLevelCount = asset.MipCount - mip,
+    .sampleCount = 1,
+  };
+  wgpu::Texture texture = device.CreateTexture(&textureDesc);
+
+  // The shared mips move on the GPU, nothing is read back.
+  wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+  for (u32 m = std::max(mip, asset.ResidentMip); m < asset.MipCount; m++)
+  {
+    wgpu::ImageCopyTexture source{.texture = asset.Texture, .mipLevel = m - asset.ResidentMip};
+    wgpu::ImageCopyTexture destination{.texture = texture, .mipLevel = m - mip};
+    wgpu::Extent3D size{GetMipSize(asset.Width, m), GetMipSize(asset.Height, m), 1};
+    encoder.CopyTextureToTexture(&source, &destination, &size);
+  }
+  wgpu::CommandBuffer commands = encoder.Finish();
+  device.GetQueue().Submit(1, &commands);
+
+  if (!pixels.empty())
+  {
+    wgpu::ImageCopyTexture destination{.texture = texture};
+    wgpu::TextureDataLayout layout{
+      .bytesPerRow = GetMipSize(asset.Width, mip) * kTextureTexelBytes,
+      .rowsPerImage = GetMipSize(asset.Height, mip),
+    };
+    device.GetQueue().WriteTexture(&destination, pixels.data(), pixels.size(), &layout, &textureDesc.size);
+  }
+
+  asset.Texture.Destroy();
+  asset.Texture = texture;
+  asset.View = texture.CreateView();
+  asset.ResidentMip = mip;
+  asset.Revision++;
+}
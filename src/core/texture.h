@@ -0,0 +1,94 @@
+#ifndef TK_TEXTURE_H
+#define TK_TEXTURE_H
+
+#include "def.h"
+#include <span>
+#include <webgpu/webgpu_cpp.h>
+
+// Mips at or below this size load with the asset, finer ones are streamed.
+const u32 kTextureTailSize = 64;
+const u32 kTextureTexelBytes = 4;
+
+// Texture holds the full-chain mips ResidentMip..MipCount-1, so its own mip 0 is
+// ResidentMip. Revision changes whenever Texture is reallocated; bind groups built
+// from View must be recreated then.
+struct tkTextureAsset
+{
+  wgpu::Texture Texture;
+  wgpu::TextureView View;
+  u32 Width = 0;
+  u32 Height = 0;
+  u32 MipCount = 1;
+  u32 TailMip = 0;
+  u32 ResidentMip = 0;
+  u32 Revision = 0;
+};
+
+// Decoded RGBA8 mip 0.
+struct tkTextureData
+{
+  u32 Width = 0;
+  u32 Height = 0;
+  tkDArray<u8> Pixels;
+};
+
+const u32 kTextureCacheMagic = 0x58544B54; // "TKTX"
+const u32 kTextureCacheVersion = 1;
+
+// Followed by the RGBA8 mip chain, smallest mip first, so any resident set of mips
+// is a single range at the start of the body.
+struct tkTextureCacheHeader
+{
+  u32 Magic;
+  u32 Version;
+  u64 SourceSize;
+  i64 SourceTime;
+  u32 Width;
+  u32 Height;
+  u32 MipCount;
+  u32 TailMip;
+};
+
+// One texture subresource read back into a cache file, regions are written in order.
+struct tkTextureRegion
+{
+  wgpu::Texture Texture;
+  u32 Mip;
+  u32 Width;
+  u32 Height;
+  u32 Layers;
+};
+
+class tkTextureImporter
+{
+public:
+  static bool Import(std::span<const u8> data, const tkString& path, tkTextureData& texture);
+
+  static tkString GetCachePath(const tkString& path);
+  // Reads the cache header, false if there is no cache or the source changed since.
+  static bool ReadCacheHeader(const tkString& path, tkTextureCacheHeader& header);
+  // Reads the asset's mips back from the GPU and writes them once the copy completes.
+  static void WriteCache(const tkString& path, const tkTextureAsset& asset);
+  // Copies the regions into a readback buffer, submits encoder and writes header plus
+  // the tightly packed rows to cachePath once the copy completes.
+  static void WriteRegions(wgpu::Device& device, wgpu::CommandEncoder& encoder, const std::string& cachePath,
+                           std::span<const u8> header, tkDArray<tkTextureRegion> regions, u32 texelBytes, const char* label);
+
+  static u32 GetMipCount(u32 width, u32 height);
+  static u32 GetTailMip(u32 width, u32 height);
+  static u64 GetMipBytes(u32 width, u32 height, u32 mip);
+  // Offset of a mip in the body, and the bytes of it plus every coarser mip.
+  static u64 GetMipOffset(u32 width, u32 height, u32 mipCount, u32 mip);
+  static u64 GetResidentBytes(u32 width, u32 height, u32 mipCount, u32 mip);
+
+  // Creates the full chain from mip 0, mips 1.. are generated on the GPU.
+  static void Create(tkTextureAsset& asset, const tkTextureData& texture, const tkString& label);
+  // Creates the texture with mips firstMip.. taken from a body prefix.
+  static void Upload(tkTextureAsset& asset, u32 width, u32 height, u32 mipCount, u32 tailMip, u32 firstMip,
+                     std::span<const u8> body, const tkString& label);
+  // Reallocates the texture to start at mip, keeping the mips both versions share.
+  // Streaming in one finer mip passes its pixels.
+  static void SetResidentMip(tkTextureAsset& asset, u32 mip, std::span<const u8> pixels = {});
+};
+
+#endif//TK_TEXTURE_H
@@ -0,0 +1,184 @@
+#include "textureStreamer.h"
+#include <algorithm>
+#include <cmath>
+
+void tkTextureStreamer::Track(tkHandle<tkTextureAsset> handle, const tkString& path)
+{
+  if (!Find(handle))
+  {
+    mTextures.push_back({.Handle = handle, .Path = path});
+  }
+}
+
+void tkTextureStreamer::RequestMip(tkHandle<tkTextureAsset> handle, f32 pixelSize)
+{
+  tkStreamedTexture* texture = Find(handle);
+  tkTextureAsset* asset = tkAssetManager::Get().Textures.Peek(handle);
+  if (!texture || !asset)
+  {
+    return;
+  }
+
+  u32 mip = asset->TailMip;
+  if (pixelSize > 0.f)
+  {
+    const f32 texels = static_cast<f32>(std::max(asset->Width, asset->Height));
+    mip = static_cast<u32>(std::clamp(std::floor(std::log2(texels / pixelSize)), 0.f, static_cast<f32>(asset->TailMip)));
+  }
+
+  // Several draws can use one texture in a frame, the largest footprint wins.
+  if (texture->RequestedFrame == mFrame && texture->RequestedMip < mip)
+  {
+    return;
+  }
+  texture->RequestedMip = mip;
+  texture->RequestedFrame = mFrame;
+}
+
+void tkTextureStreamer::Update()
+{
+  tkAssetPool<tkTextureAsset>& pool = tkAssetManager::Get().Textures;
+
+  // Freed or failed in the pool.
+  std::erase_if(mTextures, [&pool](const tkStreamedTexture& texture) {
+    if (pool.GetState(texture.Handle) != eAssetState::Failed)
+    {
+      return false;
+    }
+    texture.Request.Cancel();
+    return true;
+  });
+
+  tkDArray<tkStreamedTexture*> streamIn;
+  tkDArray<tkStreamedTexture*> evictable;
+  u32 inFlight = 0;
+  mStreamedBytes = 0;
+  for (tkStreamedTexture& texture : mTextures)
+  {
+    const tkTextureAsset* asset = pool.Peek(texture.Handle);
+    if (!asset)
+    {
+      continue;
+    }
+
+    mStreamedBytes += tkTextureImporter::GetResidentBytes(asset->Width, asset->Height, asset->MipCount, asset->ResidentMip) -
+                      tkTextureImporter::GetResidentBytes(asset->Width, asset->Height, asset->MipCount, asset->TailMip);
+    if (texture.Request.IsValid() && !texture.Request.IsDone())
+    {
+      inFlight++;
+      continue;
+    }
+    if (asset->ResidentMip > GetTargetMip(texture, *asset))
+    {
+      streamIn.push_back(&texture);
+    }
+    if (asset->ResidentMip < asset->TailMip)
+    {
+      evictable.push_back(&texture);
+    }
+  }
+
+  // Largest shortfall first.
+  std::sort(streamIn.begin(), streamIn.end(), [this, &pool](const tkStreamedTexture* a, const tkStreamedTexture* b) {
+    const tkTextureAsset* assetA = pool.Peek(a->Handle);
+    const tkTextureAsset* assetB = pool.Peek(b->Handle);
+    return assetA->ResidentMip - GetTargetMip(*a, *assetA) > assetB->ResidentMip - GetTargetMip(*b, *assetB);
+  });
+
+  u64 demand = 0;
+  for (u32 i = 0; i < streamIn.size() && inFlight + i < kMaxTextureStreamRequests; i++)
+  {
+    const tkTextureAsset* asset = pool.Peek(streamIn[i]->Handle);
+    demand += tkTextureImporter::GetMipBytes(asset->Width, asset->Height, asset->ResidentMip - 1);
+  }
+
+  // Mips nobody asked for go first, and only when the space is wanted. Mips still in
+  // use are dropped least recently requested first, only to get back under the budget.
+  u64 total = pool.GetResidentBytes() + mStreamedBytes;
+  if (total + demand > mBudget)
+  {
+    std::sort(evictable.begin(), evictable.end(), [](const tkStreamedTexture* a, const tkStreamedTexture* b) {
+      return a->RequestedFrame < b->RequestedFrame;
+    });
+    for (bool bNeeded : {false, true})
+    {
+      for (tkStreamedTexture* texture : evictable)
+      {
+        tkTextureAsset* asset = pool.Peek(texture->Handle);
+        const u32 target = bNeeded ? asset->TailMip : GetTargetMip(*texture, *asset);
+        const u64 limit = bNeeded ? mBudget : mBudget - std::min(demand, mBudget);
+        u32 mip = asset->ResidentMip;
+        while (mip < target && total > limit)
+        {
+          total -= tkTextureImporter::GetMipBytes(asset->Width, asset->Height, mip);
+          mStreamedBytes -= tkTextureImporter::GetMipBytes(asset->Width, asset->Height, mip);
+          mip++;
+        }
+        tkTextureImporter::SetResidentMip(*asset, mip);
+      }
+    }
+  }
+
+  for (tkStreamedTexture* texture : streamIn)
+  {
+    if (inFlight >= kMaxTextureStreamRequests)
+    {
+      break;
+    }
+    const tkTextureAsset* asset = pool.Peek(texture->Handle);
+    if (asset->ResidentMip <= GetTargetMip(*texture, *asset))
+    {
+      continue;
+    }
+    const u64 bytes = tkTextureImporter::GetMipBytes(asset->Width, asset->Height, asset->ResidentMip - 1);
+    if (total + bytes > mBudget)
+    {
+      continue;
+    }
+    Stream(*texture, *asset);
+    total += bytes;
+    inFlight++;
+  }
+
+  mFrame++;
+}
+
+tkTextureStreamer::tkStreamedTexture* tkTextureStreamer::Find(tkHandle<tkTextureAsset> handle)
+{
+  auto it = std::find_if(mTextures.begin(), mTextures.end(), [handle](const tkStreamedTexture& texture) {
+    return texture.Handle == handle;
+  });
+  return it != mTextures.end() ? &*it : nullptr;
+}
+
+u32 tkTextureStreamer::GetTargetMip(const tkStreamedTexture& texture, const tkTextureAsset& asset) const
+{
+  if (texture.RequestedFrame == 0)
+  {
+    return 0;
+  }
+  if (mFrame - texture.RequestedFrame > kTextureRequestRetainFrames)
+  {
+    return asset.TailMip;
+  }
+  return std::min(texture.RequestedMip, asset.TailMip);
+}
+
+void tkTextureStreamer::Stream(tkStreamedTexture& texture, const tkTextureAsset& asset)
+{
+  const u32 mip = asset.ResidentMip - 1;
+  const u64 offset = sizeof(tkTextureCacheHeader) + tkTextureImporter::GetMipOffset(asset.Width, asset.Height, asset.MipCount, mip);
+  const u64 size = tkTextureImporter::GetMipBytes(asset.Width, asset.Height, mip);
+  const tkHandle<tkTextureAsset> handle = texture.Handle;
+
+  auto callback = [handle, mip, size](const tkIOHandle& request) {
+    // The texture may have been evicted, reloaded or trimmed while the read was in flight.
+    tkTextureAsset* asset = tkAssetManager::Get().Textures.Peek(handle);
+    if (!asset || asset->ResidentMip != mip + 1 || request.GetStatus() != eIOStatus::Completed || request.GetData().size() != size)
+    {
+      return;
+    }
+    tkTextureImporter::SetResidentMip(*asset, mip, request.GetData());
+  };
+  texture.Request = tkIOService::Get().Read(tkTextureImporter::GetCachePath(texture.Path), eIOPriority::Low, callback, offset, size);
+}
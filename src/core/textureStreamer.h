@@ -0,0 +1,53 @@
+#ifndef TK_TEXTURE_STREAMER_H
+#define TK_TEXTURE_STREAMER_H
+
+#include "def.h"
+#include "assets.h"
+#include "io.h"
+
+const u64 kDefaultTextureBudget = 256ull * 1024 * 1024;
+const u32 kMaxTextureStreamRequests = 4;
+// Textures not requested for this many frames fall back to their mip tail. Textures
+// that were never requested stream in full, since nothing says how small they appear.
+const u64 kTextureRequestRetainFrames = 60;
+
+// Streams texture mips finer than the tail from the import cache for textures loaded
+// with tkRenderer::LoadTexture. Draws that know how large a texture appears on screen
+// report it with RequestMip; Update reads the next finer mip of the textures furthest
+// from what they need on the I/O thread, and drops streamed mips once texture memory
+// goes over the budget.
+class tkTextureStreamer
+{
+  struct tkStreamedTexture
+  {
+    tkHandle<tkTextureAsset> Handle;
+    tkString Path;
+    u32 RequestedMip = 0;
+    u64 RequestedFrame = 0;
+    tkIOHandle Request;
+  };
+
+  tkDArray<tkStreamedTexture> mTextures;
+  u64 mBudget = kDefaultTextureBudget;
+  u64 mStreamedBytes = 0;
+  // Starts at 1 so a zero RequestedFrame means never requested.
+  u64 mFrame = 1;
+
+public:
+  void Track(tkHandle<tkTextureAsset> handle, const tkString& path);
+  // pixelSize is the on-screen extent, in pixels, the texture's larger axis is mapped across.
+  void RequestMip(tkHandle<tkTextureAsset> handle, f32 pixelSize);
+
+  // Covers the pool's resident tails plus everything streamed on top of them.
+  void SetBudget(u64 bytes) { mBudget = bytes; }
+  [[nodiscard]] u64 GetStreamedBytes() const { return mStreamedBytes; }
+
+  void Update();
+
+private:
+  [[nodiscard]] tkStreamedTexture* Find(tkHandle<tkTextureAsset> handle);
+  [[nodiscard]] u32 GetTargetMip(const tkStreamedTexture& texture, const tkTextureAsset& asset) const;
+  void Stream(tkStreamedTexture& texture, const tkTextureAsset& asset);
+};
+
+#endif//TK_TEXTURE_STREAMER_H
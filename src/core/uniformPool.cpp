@@ -0,0 +1,77 @@
+#include "uniformPool.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+
+void tkUniformPool::Setup(wgpu::Device& device, tkBindGroupCache& bindGroupCache)
+{
+  mDevice = device;
+  mBindGroupCache = &bindGroupCache;
+  mBlocks.clear();
+  mBlock = 0;
+}
+
+void tkUniformPool::BeginFrame()
+{
+  for (tkBlock& block : mBlocks)
+  {
+    block.Data.clear();
+  }
+  mBlock = 0;
+}
+
+tkUniformSlice tkUniformPool::Push(const void* data, u32 size)
+{
+  if (size > kUniformBlockSize)
+  {
+    tkLogError("UniformPool: %u bytes do not fit in a block", size);
+    return {};
+  }
+
+  const u32 alignedSize = (size + kUniformAlignment - 1) & ~(kUniformAlignment - 1);
+  if (mBlock < mBlocks.size() && mBlocks[mBlock].Data.size() + size > kUniformBlockSize)
+  {
+    mBlock++;
+  }
+  if (mBlock == mBlocks.size())
+  {
+    wgpu::BufferDescriptor desc{
+      .label = "Uniform Pool",
+      .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+      .size = kUniformBlockSize,
+    };
+    tkBlock& block = mBlocks.emplace_back();
+    block.Buffer = mDevice.CreateBuffer(&desc);
+    block.Data.reserve(kUniformBlockSize);
+  }
+
+  tkBlock& block = mBlocks[mBlock];
+  const tkUniformSlice slice{mBlock, static_cast<u32>(block.Data.size())};
+  block.Data.resize(block.Data.size() + alignedSize);
+  memcpy(block.Data.data() + slice.Offset, data, size);
+  return slice;
+}
+
+void tkUniformPool::Flush(wgpu::Queue& queue)
+{
+  for (tkBlock& block : mBlocks)
+  {
+    if (!block.Data.empty())
+    {
+      // Never more than the block, the last push is only padded up to its end.
+      queue.WriteBuffer(block.Buffer, 0, block.Data.data(), std::min<u64>(block.Data.size(), kUniformBlockSize));
+    }
+  }
+}
+
+wgpu::BindGroup tkUniformPool::GetBindGroup(u32 block, const wgpu::BindGroupLayout& layout, u32 bindingSize)
+{
+  const wgpu::BindGroupEntry binding{.binding = 0, .buffer = mBlocks[block].Buffer, .size = bindingSize};
+  wgpu::BindGroupDescriptor desc{
+    .label = "Uniform Pool",
+    .layout = layout,
+    .entryCount = 1,
+    .entries = &binding,
+  };
+  return mBindGroupCache->GetBindGroup(desc);
+}
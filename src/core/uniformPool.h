@@ -0,0 +1,59 @@
+#ifndef TK_UNIFORM_POOL_H
+#define TK_UNIFORM_POOL_H
+
+#include "def.h"
+#include "bindGroupCache.h"
+#include <webgpu/webgpu_cpp.h>
+
+// Dynamic offsets must be multiples of minUniformBufferOffsetAlignment and
+// minStorageBufferOffsetAlignment, 256 is the largest value either may take.
+const u32 kUniformAlignment = 256;
+const u32 kUniformBlockSize = 1 << 20;
+
+// Where a pushed constant block landed, valid for the frame it was pushed in.
+struct tkUniformSlice
+{
+  u32 Block = 0;
+  u32 Offset = 0;
+};
+
+// Per-frame sub-allocator for per-object constants. Pushes are staged on the CPU into
+// 1MB blocks and uploaded with one write per block before the frame is submitted.
+// Draws then share one bind group per block and select their constants with a
+// dynamic offset, instead of needing a buffer and bind group each.
+//
+// Layouts used with GetBindGroup need a single buffer at binding 0 with
+// hasDynamicOffset set, either uniform or storage.
+class tkUniformPool
+{
+  struct tkBlock
+  {
+    wgpu::Buffer Buffer;
+    tkDArray<u8> Data;
+  };
+
+  wgpu::Device mDevice;
+  tkBindGroupCache* mBindGroupCache = nullptr;
+  tkDArray<tkBlock> mBlocks;
+  u32 mBlock = 0;
+
+public:
+  void Setup(wgpu::Device& device, tkBindGroupCache& bindGroupCache);
+
+  // Drops the previous frame's pushes, the blocks are kept.
+  void BeginFrame();
+  tkUniformSlice Push(const void* data, u32 size);
+  template <typename T>
+  tkUniformSlice Push(const T& value) { return Push(&value, sizeof(T)); }
+  // Writes this frame's pushes, must happen before the frame is submitted.
+  void Flush(wgpu::Queue& queue);
+
+  // bindingSize is how much each draw sees from its offset, usually sizeof the struct.
+  wgpu::BindGroup GetBindGroup(u32 block, const wgpu::BindGroupLayout& layout, u32 bindingSize);
+  wgpu::BindGroup GetBindGroup(const tkUniformSlice& slice, const wgpu::BindGroupLayout& layout, u32 bindingSize)
+  {
+    return GetBindGroup(slice.Block, layout, bindingSize);
+  }
+};
+
+#endif//TK_UNIFORM_POOL_H
@@ -1,24 +1,33 @@
 #include "scene.h"
+#include "../core/reader.h"
 #include "../core/registry.h"
+#include "../core/renderer.h"
 #include "../components/transform2d.h"
 #include "../components/shape2d.h"
 #include "../components/physics2d.h"
+#include "sceneFile.h"
 
 void tkScene::BeginPlay()
 {
-  entt::registry& registry = tkRegistry::Get();
-  for (i32 i = 0; i < 100; i++)
+  const u32 count = 100;
+
+  tcTransform2d transform;
+  transform.Position = v2(0.f);
+  tcRect rect;
+  rect.Dimensions = v2(.1f, .1f);
+  tkDArray<entt::entity> entities = Spawn(count, transform, rect);
+
+  tkDArray<tcPhysics2d> physics(count);
+  for (tcPhysics2d& p : physics)
+  {
+    p.Velocity = v2((2.f * ((f32)rand() / (f32)RAND_MAX) - 1.0f) / 100.f, (2.f * ((f32)rand() / (f32)RAND_MAX) - 1.0f) / 100.f);
+  }
+  tkRegistry::AddComponents(entities, physics);
+
+  const tkWorldPartitionSettings streaming;
+  if (tkReader::Exists(streaming.Directory))
   {
-    entt::entity entity = registry.create();
-    tcTransform2d transform;
-    transform.Position = v2(0.f);
-    registry.emplace<tcTransform2d>(entity, transform);
-    tcRect rect;
-    rect.Dimensions = v2(.1f, .1f);
-    registry.emplace<tcRect>(entity, rect);
-    tcPhysics2d physics;
-    physics.Velocity = v2((2.f * ((f32)rand() / (f32)RAND_MAX) - 1.0f) / 100.f, (2.f * ((f32)rand() / (f32)RAND_MAX) - 1.0f) / 100.f);
-    registry.emplace<tcPhysics2d>(entity, physics);
+    EnableStreaming(streaming);
   }
 //  entt::entity entity = registry.create();
 //  tcTransform2d transform;
@@ -35,6 +44,33 @@ void tkScene::BeginPlay()
 //  registry.emplace<tcRect>(entity, rect);
 }
 
+void tkScene::Update()
+{
+  if (Partition)
+  {
+    const v3 eye = tkRenderer::Get().GetViewPosition();
+    Partition->Update(bFollowCamera ? v2(eye.x, eye.y) : StreamingFocus);
+  }
+}
+
 void tkScene::CleanUpScene()
 {
+  Partition.reset();
+  tkRegistry::Get().destroy(Entities.begin(), Entities.end());
+  Entities.clear();
+}
+
+bool tkScene::Load(const tkString& path)
+{
+  return tkSceneFile::Load(path, Entities);
+}
+
+bool tkScene::Save(const tkString& path) const
+{
+  return tkSceneFile::Save(path, Entities);
+}
+
+void tkScene::EnableStreaming(const tkWorldPartitionSettings& settings)
+{
+  Partition = std::make_unique<tkWorldPartition>(settings);
 }
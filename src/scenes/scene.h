@@ -1,12 +1,42 @@
 #ifndef TK_SCENE_H
 #define TK_SCENE_H
 
+#include "../core/registry.h"
+#include "worldPartition.h"
+#include <memory>
+
 class tkScene
 {
+  tkDArray<entt::entity> Entities;
+  std::unique_ptr<tkWorldPartition> Partition;
+  v2 StreamingFocus = v2(0.f);
+  bool bFollowCamera = true;
+
   void CleanUpScene();
   void BeginPlay();
+  void Update();
+
+  template <typename...C>
+  tkDArray<entt::entity> Spawn(u32 count, const C&... components)
+  {
+    tkDArray<entt::entity> entities = tkRegistry::CreateEntities<C...>(count, components...);
+    Entities.insert(Entities.end(), entities.begin(), entities.end());
+    return entities;
+  }
 
   friend class tkEngine;
+
+public:
+  bool Load(const tkString& path);
+  bool Save(const tkString& path) const;
+
+  // Streams cells around the camera until SetStreamingFocus pins the focus elsewhere.
+  void EnableStreaming(const tkWorldPartitionSettings& settings);
+  void SetStreamingFocus(const v2& focus)
+  {
+    StreamingFocus = focus;
+    bFollowCamera = false;
+  }
 };
 
 #endif //TK_SCENE_H
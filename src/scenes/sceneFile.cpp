@@ -0,0 +1,332 @@
+#include "sceneFile.h"
+#include "../core/reader.h"
+#include "../core/logger.h"
+#include "../core/mappedFile.h"
+#include "../components/transform2d.h"
+#include "../components/shape2d.h"
+#include "../components/physics2d.h"
+#include <algorithm>
+#include <fstream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Chunk ids are tuple indices, only ever append to this list.
+using tkSceneComponents = std::tuple<tcTransform2d, tcRect, tcPhysics2d>;
+
+template <typename Fn, size_t... I>
+static void ForEachSceneComponent(Fn&& fn, std::index_sequence<I...>)
+{
+  (fn(std::type_identity<std::tuple_element_t<I, tkSceneComponents>>{}, static_cast<u32>(I)), ...);
+}
+
+template <typename Fn>
+static void ForEachSceneComponent(Fn&& fn)
+{
+  ForEachSceneComponent(std::forward<Fn>(fn), std::make_index_sequence<std::tuple_size_v<tkSceneComponents>>{});
+}
+
+static u64 AlignOffset(u64 offset)
+{
+  return (offset + kSceneFileAlignment - 1) & ~static_cast<u64>(kSceneFileAlignment - 1);
+}
+
+static void WritePadded(std::ofstream& file, const void* data, u64 size, u64& offset)
+{
+  static const char zeros[kSceneFileAlignment] = {};
+  u64 aligned = AlignOffset(offset);
+  file.write(zeros, static_cast<std::streamsize>(aligned - offset));
+  file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+  offset = aligned + size;
+}
+
+bool tkSceneFile::Save(const tkString& path, const tkDArray<entt::entity>& entities)
+{
+  entt::registry& registry = tkRegistry::Get();
+
+  struct ChunkData
+  {
+    tkDArray<u32> Indices;
+    tkDArray<u8> Data;
+  };
+
+  tkDArray<tkSceneChunkHeader> chunks;
+  tkDArray<ChunkData> chunkData;
+
+  ForEachSceneComponent([&]<typename C>(std::type_identity<C>, u32 id)
+  {
+    static_assert(std::is_trivially_copyable_v<C>, "Scene components must be trivially copyable");
+
+    ChunkData data;
+    for (u32 i = 0; i < entities.size(); i++)
+    {
+      if (const C* component = registry.try_get<C>(entities[i]))
+      {
+        data.Indices.push_back(i);
+        const u8* bytes = reinterpret_cast<const u8*>(component);
+        data.Data.insert(data.Data.end(), bytes, bytes + sizeof(C));
+      }
+    }
+
+    if (data.Indices.empty())
+    {
+      return;
+    }
+    if (data.Indices.size() == entities.size())
+    {
+      data.Indices.clear();
+    }
+
+    chunks.push_back(tkSceneChunkHeader{
+      .Id = id,
+      .Stride = sizeof(C),
+      .Count = static_cast<u32>(data.Data.size() / sizeof(C)),
+    });
+    chunkData.push_back(std::move(data));
+  });
+
+  u64 offset = sizeof(tkSceneFileHeader) + chunks.size() * sizeof(tkSceneChunkHeader);
+  for (u32 i = 0; i < chunks.size(); i++)
+  {
+    if (!chunkData[i].Indices.empty())
+    {
+      chunks[i].IndexOffset = AlignOffset(offset);
+      offset = chunks[i].IndexOffset + chunkData[i].Indices.size() * sizeof(u32);
+    }
+    chunks[i].DataOffset = AlignOffset(offset);
+    offset = chunks[i].DataOffset + chunkData[i].Data.size();
+  }
+
+  std::ofstream file(tkReader::ResolvePath(path), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    tkLogWarning("SceneFile::Save: Failed to open file %s", path.c_str());
+    return false;
+  }
+
+  tkSceneFileHeader header{
+    .Magic = kSceneFileMagic,
+    .Version = kSceneFileVersion,
+    .EntityCount = static_cast<u32>(entities.size()),
+    .ChunkCount = static_cast<u32>(chunks.size()),
+  };
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(chunks.data()), static_cast<std::streamsize>(chunks.size() * sizeof(tkSceneChunkHeader)));
+
+  offset = sizeof(tkSceneFileHeader) + chunks.size() * sizeof(tkSceneChunkHeader);
+  for (const ChunkData& data : chunkData)
+  {
+    if (!data.Indices.empty())
+    {
+      WritePadded(file, data.Indices.data(), data.Indices.size() * sizeof(u32), offset);
+    }
+    WritePadded(file, data.Data.data(), data.Data.size(), offset);
+  }
+
+  return file.good();
+}
+
+bool tkSceneFile::Load(const tkString& path, tkDArray<entt::entity>& entities)
+{
+  tkSceneData data;
+  if (!data.Open(path))
+  {
+    return false;
+  }
+  data.Instantiate(entities, 0, data.GetEntityCount());
+  return true;
+}
+
+bool tkSceneData::Open(const tkString& path)
+{
+  Close();
+  mFile = tkReader::MapBinaryFile(path);
+  if (!mFile.IsValid())
+  {
+    return false;
+  }
+
+  const u8* base = mFile.GetBytes().data();
+  const u64 size = mFile.GetSize();
+  if (size < sizeof(tkSceneFileHeader))
+  {
+    tkLogWarning("SceneData::Open: %s is too small", path.c_str());
+    Close();
+    return false;
+  }
+
+  const tkSceneFileHeader* header = reinterpret_cast<const tkSceneFileHeader*>(base);
+  if (header->Magic != kSceneFileMagic || header->Version != kSceneFileVersion)
+  {
+    tkLogWarning("SceneData::Open: %s is not a version %u scene file", path.c_str(), kSceneFileVersion);
+    Close();
+    return false;
+  }
+  if (sizeof(tkSceneFileHeader) + static_cast<u64>(header->ChunkCount) * sizeof(tkSceneChunkHeader) > size)
+  {
+    tkLogWarning("SceneData::Open: %s has a truncated chunk table", path.c_str());
+    Close();
+    return false;
+  }
+
+  const tkSceneChunkHeader* chunks = reinterpret_cast<const tkSceneChunkHeader*>(base + sizeof(tkSceneFileHeader));
+  for (u32 i = 0; i < header->ChunkCount; i++)
+  {
+    const tkSceneChunkHeader& chunk = chunks[i];
+    // Offsets come straight from the file, so compare against the space left after them
+    // rather than adding to them, which a crafted offset could wrap around.
+    const u64 indexBytes = static_cast<u64>(chunk.IndexOffset ? chunk.Count : 0) * sizeof(u32);
+    const u64 dataBytes = static_cast<u64>(chunk.Count) * chunk.Stride;
+    bool valid = chunk.IndexOffset <= size && indexBytes <= size - chunk.IndexOffset &&
+                 chunk.DataOffset <= size && dataBytes <= size - chunk.DataOffset && chunk.Count <= header->EntityCount &&
+                 (chunk.IndexOffset != 0 || chunk.Count == header->EntityCount);
+
+    const u32* indices = reinterpret_cast<const u32*>(base + chunk.IndexOffset);
+    for (u32 j = 0; valid && chunk.IndexOffset != 0 && j < chunk.Count; j++)
+    {
+      valid = indices[j] < header->EntityCount && (j == 0 || indices[j] > indices[j - 1]);
+    }
+
+    if (!valid)
+    {
+      tkLogWarning("SceneData::Open: %s has a corrupt chunk %u", path.c_str(), i);
+      Close();
+      return false;
+    }
+
+    bool known = false;
+    bool strideValid = true;
+    ForEachSceneComponent([&]<typename C>(std::type_identity<C>, u32 id)
+    {
+      if (chunk.Id == id)
+      {
+        known = true;
+        strideValid = chunk.Stride == sizeof(C);
+        if (!strideValid)
+        {
+          tkLogWarning("SceneData::Open: %s chunk %u has stride %u, expected %u", path.c_str(), id, chunk.Stride, static_cast<u32>(sizeof(C)));
+        }
+      }
+    });
+    // A known component with the wrong layout means the file is corrupt or was written
+    // by a build with different component structs, either way none of it can be trusted.
+    if (!strideValid)
+    {
+      Close();
+      return false;
+    }
+    if (!known)
+    {
+      tkLogWarning("SceneData::Open: %s has unknown chunk id %u", path.c_str(), chunk.Id);
+    }
+  }
+
+  mHeader = header;
+  mChunks = chunks;
+  return true;
+}
+
+void tkSceneData::Close()
+{
+  mFile = {};
+  mHeader = nullptr;
+  mChunks = nullptr;
+}
+
+void tkSceneData::Prefetch() const
+{
+  if (!mHeader)
+  {
+    return;
+  }
+
+  const u8* fileData = mFile.GetBytes().data();
+  const u64 pageSize = tkMappedFile::GetPageSize();
+  u8 sum = 0;
+  auto touch = [&](u64 offset, u64 size)
+  {
+    for (u64 at = offset; at < offset + size; at += pageSize)
+    {
+      sum += fileData[at];
+    }
+    if (size > 0)
+    {
+      sum += fileData[offset + size - 1];
+    }
+  };
+
+  for (u32 i = 0; i < mHeader->ChunkCount; i++)
+  {
+    const tkSceneChunkHeader& chunk = mChunks[i];
+    if (chunk.IndexOffset != 0)
+    {
+      touch(chunk.IndexOffset, static_cast<u64>(chunk.Count) * sizeof(u32));
+    }
+    touch(chunk.DataOffset, static_cast<u64>(chunk.Count) * chunk.Stride);
+  }
+
+  // Keeps the reads from being optimised away.
+  volatile u8 sink = sum;
+  (void)sink;
+}
+
+u32 tkSceneData::GetEntityCount() const
+{
+  return mHeader ? mHeader->EntityCount : 0;
+}
+
+u32 tkSceneData::Instantiate(tkDArray<entt::entity>& entities, u32 first, u32 count) const
+{
+  if (first >= GetEntityCount())
+  {
+    return 0;
+  }
+  count = std::min(count, GetEntityCount() - first);
+
+  entt::registry& registry = tkRegistry::Get();
+  const size_t base = entities.size();
+  entities.resize(base + count);
+  auto rangeBegin = entities.begin() + static_cast<std::ptrdiff_t>(base);
+  registry.storage<entt::entity>().reserve(registry.storage<entt::entity>().size() + count);
+  registry.create(rangeBegin, entities.end());
+
+  const u8* fileData = mFile.GetBytes().data();
+  tkDArray<entt::entity> subset;
+  for (u32 i = 0; i < mHeader->ChunkCount; i++)
+  {
+    const tkSceneChunkHeader& chunk = mChunks[i];
+    ForEachSceneComponent([&]<typename C>(std::type_identity<C>, u32 id)
+    {
+      if (chunk.Id != id || chunk.Stride != sizeof(C))
+      {
+        return;
+      }
+
+      const C* data = reinterpret_cast<const C*>(fileData + chunk.DataOffset);
+      if (chunk.IndexOffset == 0)
+      {
+        registry.storage<C>().reserve(registry.storage<C>().size() + count);
+        registry.insert<C>(rangeBegin, entities.end(), data + first);
+        return;
+      }
+
+      const u32* indices = reinterpret_cast<const u32*>(fileData + chunk.IndexOffset);
+      const u32* lo = std::lower_bound(indices, indices + chunk.Count, first);
+      const u32* hi = std::lower_bound(lo, indices + chunk.Count, first + count);
+      if (lo == hi)
+      {
+        return;
+      }
+
+      subset.resize(static_cast<size_t>(hi - lo));
+      for (size_t j = 0; j < subset.size(); j++)
+      {
+        subset[j] = rangeBegin[lo[j] - first];
+      }
+      registry.storage<C>().reserve(registry.storage<C>().size() + subset.size());
+      registry.insert<C>(subset.begin(), subset.end(), data + (lo - indices));
+    });
+  }
+
+  return count;
+}
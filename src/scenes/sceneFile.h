@@ -0,0 +1,58 @@
+#ifndef TK_SCENE_FILE_H
+#define TK_SCENE_FILE_H
+
+#include "../core/def.h"
+#include "../core/registry.h"
+#include "../core/reader.h"
+
+const u32 kSceneFileMagic = 0x43534B54; // "TKSC"
+const u32 kSceneFileVersion = 1;
+const u32 kSceneFileAlignment = 64;
+
+struct tkSceneFileHeader
+{
+  u32 Magic;
+  u32 Version;
+  u32 EntityCount;
+  u32 ChunkCount;
+};
+
+// One chunk per component type. Data is the packed component array, exactly as it
+// sits in the EnTT pool. Indices map each element to its entity; a dense chunk
+// (Count == EntityCount) has no index array.
+struct tkSceneChunkHeader
+{
+  u32 Id;
+  u32 Stride;
+  u32 Count;
+  u32 Padding;
+  u64 IndexOffset;
+  u64 DataOffset;
+};
+
+// A validated, memory-mapped scene file that can be instantiated in slices.
+class tkSceneData
+{
+  tkFileView mFile;
+  const tkSceneFileHeader* mHeader = nullptr;
+  const tkSceneChunkHeader* mChunks = nullptr;
+
+public:
+  bool Open(const tkString& path);
+  void Close();
+
+  // Faults in every page the chunks occupy, so a loader thread can pay for the
+  // disk reads instead of whoever calls Instantiate.
+  void Prefetch() const;
+  [[nodiscard]] u32 GetEntityCount() const;
+  u32 Instantiate(tkDArray<entt::entity>& entities, u32 first, u32 count) const;
+};
+
+class tkSceneFile
+{
+public:
+  static bool Save(const tkString& path, const tkDArray<entt::entity>& entities);
+  static bool Load(const tkString& path, tkDArray<entt::entity>& entities);
+};
+
+#endif //TK_SCENE_FILE_H
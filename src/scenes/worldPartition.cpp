@@ -0,0 +1,262 @@
+#include "worldPartition.h"
+#include "../core/reader.h"
+#include <algorithm>
+#include <cmath>
+
+tkWorldPartition::tkWorldPartition(const tkWorldPartitionSettings& settings) :
+  mSettings(settings)
+{
+  mSettings.UnloadRadius = std::max(mSettings.UnloadRadius, mSettings.LoadRadius);
+#if !defined(__EMSCRIPTEN__)
+  mLoader = std::thread(&tkWorldPartition::LoaderMain, this);
+#endif
+}
+
+tkWorldPartition::~tkWorldPartition()
+{
+  {
+    std::lock_guard lock(mMutex);
+    bStop = true;
+    mRequests.clear();
+  }
+  mCondition.notify_all();
+  if (mLoader.joinable())
+  {
+    mLoader.join();
+  }
+
+  entt::registry& registry = tkRegistry::Get();
+  for (auto& [key, cell] : mCells)
+  {
+    registry.destroy(cell.Entities.begin(), cell.Entities.end());
+  }
+}
+
+u64 tkWorldPartition::MakeKey(i32 x, i32 y)
+{
+  return (static_cast<u64>(static_cast<u32>(x)) << 32) | static_cast<u32>(y);
+}
+
+tkString tkWorldPartition::GetCellPath(i32 x, i32 y) const
+{
+  return mSettings.Directory + "/cell_" + std::to_string(x) + "_" + std::to_string(y) + ".tks";
+}
+
+f32 tkWorldPartition::GetCellDistance(const tkWorldCell& cell, const v2& focus) const
+{
+  const v2 min = v2(static_cast<f32>(cell.X), static_cast<f32>(cell.Y)) * mSettings.CellSize;
+  const v2 max = min + v2(mSettings.CellSize);
+  const v2 closest = glm::clamp(focus, min, max);
+  return glm::length(focus - closest);
+}
+
+u32 tkWorldPartition::GetLoadedCellCount() const
+{
+  return static_cast<u32>(std::count_if(mCells.begin(), mCells.end(), [](const auto& entry) {
+    return entry.second.State == eCellState::Loaded;
+  }));
+}
+
+void tkWorldPartition::Update(const v2& focus)
+{
+  RequestCells(focus);
+
+#if defined(__EMSCRIPTEN__)
+  if (!mRequests.empty())
+  {
+    tkCellRequest request = std::move(mRequests.front());
+    mRequests.pop_front();
+    mResults.push_back({request.Key, LoadCell(request.Path)});
+  }
+#endif
+
+  CollectResults();
+  Integrate(focus);
+}
+
+void tkWorldPartition::RequestCells(const v2& focus)
+{
+  const i32 minX = static_cast<i32>(std::floor((focus.x - mSettings.LoadRadius) / mSettings.CellSize));
+  const i32 maxX = static_cast<i32>(std::floor((focus.x + mSettings.LoadRadius) / mSettings.CellSize));
+  const i32 minY = static_cast<i32>(std::floor((focus.y - mSettings.LoadRadius) / mSettings.CellSize));
+  const i32 maxY = static_cast<i32>(std::floor((focus.y + mSettings.LoadRadius) / mSettings.CellSize));
+
+  tkDArray<std::pair<f32, u64>> wanted;
+  for (i32 y = minY; y <= maxY; y++)
+  {
+    for (i32 x = minX; x <= maxX; x++)
+    {
+      tkWorldCell cell{.X = x, .Y = y};
+      const f32 distance = GetCellDistance(cell, focus);
+      const u64 key = MakeKey(x, y);
+      if (distance > mSettings.LoadRadius)
+      {
+        continue;
+      }
+
+      // Cells still unloading are re-requested once they are gone.
+      if (mCells.emplace(key, std::move(cell)).second)
+      {
+        wanted.emplace_back(distance, key);
+      }
+    }
+  }
+
+  std::vector<u64> cancelled;
+  for (auto& [key, cell] : mCells)
+  {
+    if (GetCellDistance(cell, focus) <= mSettings.UnloadRadius)
+    {
+      continue;
+    }
+    if (cell.State == eCellState::Queued)
+    {
+      cancelled.push_back(key);
+    }
+    else
+    {
+      cell.State = eCellState::Unloading;
+    }
+  }
+
+  std::sort(wanted.begin(), wanted.end());
+  {
+    std::lock_guard lock(mMutex);
+    for (u64 key : cancelled)
+    {
+      std::erase_if(mRequests, [key](const tkCellRequest& request) { return request.Key == key; });
+    }
+    for (const auto& [distance, key] : wanted)
+    {
+      const tkWorldCell& cell = mCells[key];
+      mRequests.push_back({key, GetCellPath(cell.X, cell.Y)});
+    }
+  }
+  if (!wanted.empty())
+  {
+    mCondition.notify_one();
+  }
+
+  // A cancelled cell may already be on the loader thread, its result is dropped in CollectResults.
+  for (u64 key : cancelled)
+  {
+    mCells.erase(key);
+  }
+}
+
+void tkWorldPartition::CollectResults()
+{
+  std::deque<tkCellResult> results;
+  {
+    std::lock_guard lock(mMutex);
+    results.swap(mResults);
+  }
+
+  for (tkCellResult& result : results)
+  {
+    auto it = mCells.find(result.Key);
+    if (it == mCells.end() || it->second.State != eCellState::Queued)
+    {
+      continue;
+    }
+
+    tkWorldCell& cell = it->second;
+    cell.Data = std::move(result.Data);
+    cell.State = cell.Data ? eCellState::Integrating : eCellState::Loaded;
+    if (cell.Data)
+    {
+      cell.Entities.reserve(cell.Data->GetEntityCount());
+    }
+  }
+}
+
+void tkWorldPartition::Integrate(const v2& focus)
+{
+  tkDArray<std::pair<f32, tkWorldCell*>> pending;
+  for (auto& [key, cell] : mCells)
+  {
+    if (cell.State == eCellState::Integrating || cell.State == eCellState::Unloading)
+    {
+      pending.emplace_back(GetCellDistance(cell, focus), &cell);
+    }
+  }
+  std::sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  entt::registry& registry = tkRegistry::Get();
+  u32 budget = mSettings.EntityBudget;
+  tkDArray<u64> unloaded;
+  for (auto& [distance, cell] : pending)
+  {
+    if (budget == 0)
+    {
+      break;
+    }
+
+    if (cell->State == eCellState::Unloading)
+    {
+      const u32 count = std::min<u32>(budget, static_cast<u32>(cell->Entities.size()));
+      auto first = cell->Entities.end() - count;
+      registry.destroy(first, cell->Entities.end());
+      cell->Entities.erase(first, cell->Entities.end());
+      budget -= count;
+      if (cell->Entities.empty())
+      {
+        unloaded.push_back(MakeKey(cell->X, cell->Y));
+      }
+      continue;
+    }
+
+    const u32 count = cell->Data->Instantiate(cell->Entities, cell->Integrated, budget);
+    cell->Integrated += count;
+    budget -= count;
+    if (cell->Integrated >= cell->Data->GetEntityCount())
+    {
+      cell->Data.reset();
+      cell->State = eCellState::Loaded;
+    }
+  }
+
+  for (u64 key : unloaded)
+  {
+    mCells.erase(key);
+  }
+}
+
+std::unique_ptr<tkSceneData> tkWorldPartition::LoadCell(const tkString& path)
+{
+  if (!tkReader::Exists(path))
+  {
+    return nullptr;
+  }
+
+  auto data = std::make_unique<tkSceneData>();
+  if (!data->Open(path))
+  {
+    return nullptr;
+  }
+  data->Prefetch();
+  return data;
+}
+
+void tkWorldPartition::LoaderMain()
+{
+  while (true)
+  {
+    tkCellRequest request;
+    {
+      std::unique_lock lock(mMutex);
+      mCondition.wait(lock, [this] { return bStop || !mRequests.empty(); });
+      if (bStop)
+      {
+        return;
+      }
+      request = std::move(mRequests.front());
+      mRequests.pop_front();
+    }
+
+    std::unique_ptr<tkSceneData> data = LoadCell(request.Path);
+
+    std::lock_guard lock(mMutex);
+    mResults.push_back({request.Key, std::move(data)});
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef TK_WORLD_PARTITION_H
+#define TK_WORLD_PARTITION_H
+
+#include "../core/def.h"
+#include "../core/registry.h"
+#include "sceneFile.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+struct tkWorldPartitionSettings
+{
+  tkString Directory = "world";
+  f32 CellSize = 16.f;
+  f32 LoadRadius = 48.f;
+  f32 UnloadRadius = 64.f;
+  u32 EntityBudget = 16384;
+};
+
+// Splits the world into square cells stored as scene files named
+// "<Directory>/cell_<x>_<y>.tks". Cells are mapped on a background thread and
+// merged into the registry at most EntityBudget entities per frame.
+class tkWorldPartition
+{
+  enum class eCellState : u8
+  {
+    Queued,
+    Integrating,
+    Loaded,
+    Unloading,
+  };
+
+  struct tkWorldCell
+  {
+    i32 X = 0;
+    i32 Y = 0;
+    eCellState State = eCellState::Queued;
+    std::unique_ptr<tkSceneData> Data;
+    u32 Integrated = 0;
+    tkDArray<entt::entity> Entities;
+  };
+
+  struct tkCellRequest
+  {
+    u64 Key;
+    tkString Path;
+  };
+
+  struct tkCellResult
+  {
+    u64 Key;
+    std::unique_ptr<tkSceneData> Data;
+  };
+
+  tkWorldPartitionSettings mSettings;
+  std::unordered_map<u64, tkWorldCell> mCells;
+
+  std::thread mLoader;
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  std::deque<tkCellRequest> mRequests;
+  std::deque<tkCellResult> mResults;
+  bool bStop = false;
+
+public:
+  explicit tkWorldPartition(const tkWorldPartitionSettings& settings);
+  ~tkWorldPartition();
+
+  tkWorldPartition(const tkWorldPartition&) = delete;
+  tkWorldPartition& operator=(const tkWorldPartition&) = delete;
+
+  void Update(const v2& focus);
+
+  [[nodiscard]] u32 GetLoadedCellCount() const;
+
+private:
+  static u64 MakeKey(i32 x, i32 y);
+  [[nodiscard]] tkString GetCellPath(i32 x, i32 y) const;
+  [[nodiscard]] f32 GetCellDistance(const tkWorldCell& cell, const v2& focus) const;
+
+  void RequestCells(const v2& focus);
+  void CollectResults();
+  void Integrate(const v2& focus);
+  void LoaderMain();
+  static std::unique_ptr<tkSceneData> LoadCell(const tkString& path);
+};
+
+#endif //TK_WORLD_PARTITION_H
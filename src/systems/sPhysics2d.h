@@ -11,7 +11,8 @@ public:
     inline void Update() override
     {
         entt::registry& registry = tkRegistry::Get();
-        auto view = registry.view<tcPhysics2d, tcTransform2d>();
+        // tcGpuBody2d bodies are integrated by tsPhysics2dGpu instead.
+        auto view = registry.view<tcPhysics2d, tcTransform2d>(entt::exclude<tcGpuBody2d>);
 
         for (auto entity : view)
         {
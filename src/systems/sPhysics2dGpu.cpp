@@ -0,0 +1,453 @@
+#include "sPhysics2dGpu.h"
+#include "../components/physics2d.h"
+#include "../components/transform2d.h"
+#include "../core/logger.h"
+#include "../core/gpuUtil.h"
+#include "../core/renderer.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <bit>
+
+const u32 kGpuPhysicsWorkgroupSize = 256;
+const u64 kMinGpuBodyCapacity = 4096;
+// Keeps the body buffer under the default 128MB storage binding limit.
+const u64 kMaxGpuBodies = 1 << 21;
+const u64 kMinGpuReadbackCapacity = 256;
+
+static u32 GetGroupCount(u64 count)
+{
+  return static_cast<u32>((count + kGpuPhysicsWorkgroupSize - 1) / kGpuPhysicsWorkgroupSize);
+}
+
+void tsPhysics2dGpu::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+
+  entt::registry& registry = GetRegistry();
+  registry.on_construct<tcGpuBody2d>().connect<&tsPhysics2dGpu::OnConstruct>(*this);
+  registry.on_destroy<tcGpuBody2d>().connect<&tsPhysics2dGpu::OnDestroy>(*this);
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 8> simulateEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(3, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(4, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(5, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(6, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(7, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+  };
+  wgpu::BindGroupLayoutDescriptor simulateLayoutDesc{
+    .label = "GPU Physics Simulate",
+    .entryCount = simulateEntries.size(),
+    .entries = simulateEntries.data(),
+  };
+  mSimulateLayout = device.CreateBindGroupLayout(&simulateLayoutDesc);
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 2> readbackEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+  };
+  wgpu::BindGroupLayoutDescriptor readbackLayoutDesc{
+    .label = "GPU Physics Readback",
+    .entryCount = readbackEntries.size(),
+    .entries = readbackEntries.data(),
+  };
+  mReadbackLayout = device.CreateBindGroupLayout(&readbackLayoutDesc);
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 2> drawEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+  };
+  wgpu::BindGroupLayoutDescriptor drawLayoutDesc{
+    .label = "GPU Physics Draw",
+    .entryCount = drawEntries.size(),
+    .entries = drawEntries.data(),
+  };
+  mDrawLayout = device.CreateBindGroupLayout(&drawLayoutDesc);
+
+  const tkArray<wgpu::BindGroupLayout, 1> simulateLayouts = {mSimulateLayout};
+  const tkArray<wgpu::BindGroupLayout, 2> gatherLayouts = {mSimulateLayout, mReadbackLayout};
+
+  wgpu::ShaderModule module = tkRenderer::Get().LoadShader("shaders/physics2d.wgsl");
+  mClearPipeline = tkCreateComputePipeline(device, "GPU Physics Clear", simulateLayouts, module, "cs_clear");
+  mCountPipeline = tkCreateComputePipeline(device, "GPU Physics Count", simulateLayouts, module, "cs_count");
+  mScanLocalPipeline = tkCreateComputePipeline(device, "GPU Physics Scan Local", simulateLayouts, module, "cs_scan_local");
+  mScanBlocksPipeline = tkCreateComputePipeline(device, "GPU Physics Scan Blocks", simulateLayouts, module, "cs_scan_blocks");
+  mScanAddPipeline = tkCreateComputePipeline(device, "GPU Physics Scan Add", simulateLayouts, module, "cs_scan_add");
+  mScatterPipeline = tkCreateComputePipeline(device, "GPU Physics Scatter", simulateLayouts, module, "cs_scatter");
+  mCollidePipeline = tkCreateComputePipeline(device, "GPU Physics Collide", simulateLayouts, module, "cs_collide");
+  mGatherPipeline = tkCreateComputePipeline(device, "GPU Physics Gather", gatherLayouts, module, "cs_gather");
+
+  wgpu::ShaderModule drawModule = tkRenderer::Get().LoadShader("shaders/physics2dDraw.wgsl");
+  const wgpu::ColorTargetState colorTargetState = tkAlphaBlendTarget();
+  wgpu::FragmentState fragmentState{
+    .module = drawModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+  const wgpu::DepthStencilState depthStencilState = tkRenderer::Get().GetBlendedDepthState();
+  wgpu::PipelineLayoutDescriptor drawPipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mDrawLayout,
+  };
+  wgpu::RenderPipelineDescriptor drawDesc{
+    .label = "GPU Physics Draw",
+    .layout = device.CreatePipelineLayout(&drawPipelineLayoutDesc),
+    .vertex = {.module = drawModule, .entryPoint = "vs_main"},
+    .primitive = {.topology = wgpu::PrimitiveTopology::TriangleStrip, .cullMode = wgpu::CullMode::None},
+    .depthStencil = &depthStencilState,
+    .fragment = &fragmentState,
+  };
+  mDrawPipeline = device.CreateRenderPipeline(&drawDesc);
+
+  mParamsBuffer = tkCreateBuffer(device, "GPU Physics Params", wgpu::BufferUsage::Uniform, sizeof(tkGpuPhysicsParams));
+  Reserve(device, kMinGpuBodyCapacity);
+}
+
+void tsPhysics2dGpu::Reserve(wgpu::Device& device, u64 bodyCount)
+{
+  if (bodyCount <= mCapacity)
+  {
+    return;
+  }
+
+  const u64 capacity = std::max(kMinGpuBodyCapacity, std::bit_ceil(bodyCount));
+  const tkArray<wgpu::Buffer, 2> oldBodies = mBodyBuffers;
+  mBodyBuffers[0] = tkCreateBuffer(device, "GPU Bodies", wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc, capacity * sizeof(tkGpuBody));
+  mBodyBuffers[1] = tkCreateBuffer(device, "GPU Bodies", wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc, capacity * sizeof(tkGpuBody));
+
+  // Submitted on its own so the copy lands before any body writes queued this frame.
+  if (mBodyCount > 0)
+  {
+    wgpu::CommandEncoder encoder = device.CreateCommandEncoder();
+    encoder.CopyBufferToBuffer(oldBodies[mCurrent], 0, mBodyBuffers[mCurrent], 0, u64(mBodyCount) * sizeof(tkGpuBody));
+    wgpu::CommandBuffer commands = encoder.Finish();
+    device.GetQueue().Submit(1, &commands);
+  }
+
+  // About one hashed cell per body keeps the buckets short.
+  mCapacity = capacity;
+  mCellCount = static_cast<u32>(capacity);
+  mBodyCellBuffer = tkCreateBuffer(device, "GPU Body Cells", wgpu::BufferUsage::Storage, capacity * sizeof(u32) * 2);
+  mSortedBuffer = tkCreateBuffer(device, "GPU Bodies Sorted", wgpu::BufferUsage::Storage, capacity * sizeof(u32));
+  mCellCountBuffer = tkCreateBuffer(device, "GPU Cell Counts", wgpu::BufferUsage::Storage, u64(mCellCount) * sizeof(u32));
+  mCellStartBuffer = tkCreateBuffer(device, "GPU Cell Starts", wgpu::BufferUsage::Storage, u64(mCellCount) * sizeof(u32));
+  mBlockSumBuffer = tkCreateBuffer(device, "GPU Cell Block Sums", wgpu::BufferUsage::Storage, u64(mCellCount / kGpuPhysicsWorkgroupSize) * sizeof(u32));
+
+  const u64 bodyBytes = capacity * sizeof(tkGpuBody);
+  for (u32 i = 0; i < 2; i++)
+  {
+    const tkArray<wgpu::BindGroupEntry, 8> simulateEntries = {{
+      {.binding = 0, .buffer = mParamsBuffer, .size = sizeof(tkGpuPhysicsParams)},
+      {.binding = 1, .buffer = mBodyBuffers[i], .size = bodyBytes},
+      {.binding = 2, .buffer = mBodyBuffers[1 - i], .size = bodyBytes},
+      {.binding = 3, .buffer = mBodyCellBuffer, .size = mBodyCellBuffer.GetSize()},
+      {.binding = 4, .buffer = mCellCountBuffer, .size = mCellCountBuffer.GetSize()},
+      {.binding = 5, .buffer = mCellStartBuffer, .size = mCellStartBuffer.GetSize()},
+      {.binding = 6, .buffer = mBlockSumBuffer, .size = mBlockSumBuffer.GetSize()},
+      {.binding = 7, .buffer = mSortedBuffer, .size = mSortedBuffer.GetSize()},
+    }};
+    wgpu::BindGroupDescriptor simulateDesc{
+      .layout = mSimulateLayout,
+      .entryCount = simulateEntries.size(),
+      .entries = simulateEntries.data(),
+    };
+    mSimulateBindGroups[i] = device.CreateBindGroup(&simulateDesc);
+
+    const tkArray<wgpu::BindGroupEntry, 2> drawEntries = {{
+      {.binding = 0, .buffer = mParamsBuffer, .size = sizeof(tkGpuPhysicsParams)},
+      {.binding = 1, .buffer = mBodyBuffers[i], .size = bodyBytes},
+    }};
+    wgpu::BindGroupDescriptor drawDesc{
+      .layout = mDrawLayout,
+      .entryCount = drawEntries.size(),
+      .entries = drawEntries.data(),
+    };
+    mDrawBindGroups[i] = device.CreateBindGroup(&drawDesc);
+  }
+}
+
+void tsPhysics2dGpu::ReserveReadback(wgpu::Device& device, u64 count)
+{
+  if (count <= mReadbackCapacity)
+  {
+    return;
+  }
+
+  mReadbackCapacity = std::max(kMinGpuReadbackCapacity, std::bit_ceil(count));
+  mReadbackSlotBuffer = tkCreateBuffer(device, "GPU Physics Readback Slots", wgpu::BufferUsage::Storage, mReadbackCapacity * sizeof(u32));
+  mReadbackBuffer = tkCreateBuffer(device, "GPU Physics Readback", wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopySrc,
+                                        mReadbackCapacity * sizeof(tkGpuBody));
+
+  const tkArray<wgpu::BindGroupEntry, 2> entries = {{
+    {.binding = 0, .buffer = mReadbackSlotBuffer, .size = mReadbackSlotBuffer.GetSize()},
+    {.binding = 1, .buffer = mReadbackBuffer, .size = mReadbackBuffer.GetSize()},
+  }};
+  wgpu::BindGroupDescriptor desc{
+    .layout = mReadbackLayout,
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  mReadbackBindGroup = device.CreateBindGroup(&desc);
+}
+
+void tsPhysics2dGpu::OnConstruct(entt::registry& registry, entt::entity entity)
+{
+  mPending.push_back(entity);
+}
+
+void tsPhysics2dGpu::OnDestroy(entt::registry& registry, entt::entity entity)
+{
+  const u32 slot = registry.get<tcGpuBody2d>(entity).Body;
+  if (slot != kInvalidGpuBody)
+  {
+    mRemoved.push_back(slot);
+  }
+}
+
+void tsPhysics2dGpu::UploadBodies(wgpu::Device& device)
+{
+  wgpu::Queue queue = device.GetQueue();
+
+  // Zero radius marks a free slot for the simulation and the draw.
+  const tkGpuBody freeBody{};
+  for (u32 slot : mRemoved)
+  {
+    queue.WriteBuffer(mBodyBuffers[mCurrent], u64(slot) * sizeof(tkGpuBody), &freeBody, sizeof(freeBody));
+    mFreeSlots.push_back(slot);
+  }
+  mRemoved.clear();
+
+  if (mPending.empty())
+  {
+    return;
+  }
+
+  entt::registry& registry = GetRegistry();
+  tkDArray<std::pair<u32, tkGpuBody>> reused;
+  tkDArray<tkGpuBody> appended;
+  const u32 firstAppended = mBodyCount;
+  for (entt::entity entity : mPending)
+  {
+    tcGpuBody2d* body = registry.valid(entity) ? registry.try_get<tcGpuBody2d>(entity) : nullptr;
+    const tcTransform2d* transform = registry.valid(entity) ? registry.try_get<tcTransform2d>(entity) : nullptr;
+    if (!body || body->Body != kInvalidGpuBody)
+    {
+      continue;
+    }
+    if (!transform)
+    {
+      tkLogWarning("GpuPhysics2d: Body without a tcTransform2d was skipped");
+      continue;
+    }
+    if (mFreeSlots.empty() && mBodyCount >= kMaxGpuBodies)
+    {
+      tkLogWarning("GpuPhysics2d: Body limit of %llu reached", static_cast<unsigned long long>(kMaxGpuBodies));
+      break;
+    }
+
+    const tcPhysics2d* physics = registry.try_get<tcPhysics2d>(entity);
+    const tkGpuBody gpuBody{
+      .Position = transform->Position,
+      .Velocity = physics ? physics->Velocity : v2(0.f),
+      .Radius = body->Radius,
+      .InvMass = body->Mass > 0.f ? 1.f / body->Mass : 0.f,
+      .Angle = transform->Angle,
+      .AngularVelocity = physics ? physics->AngularVelocity : 0.f,
+      .Color = glm::packUnorm4x8(body->Color),
+    };
+    mMaxRadius = std::max(mMaxRadius, body->Radius);
+
+    if (!mFreeSlots.empty())
+    {
+      body->Body = mFreeSlots.back();
+      mFreeSlots.pop_back();
+      reused.push_back({body->Body, gpuBody});
+    }
+    else
+    {
+      body->Body = mBodyCount++;
+      appended.push_back(gpuBody);
+    }
+  }
+  mPending.clear();
+
+  Reserve(device, mBodyCount);
+  for (const auto& [slot, gpuBody] : reused)
+  {
+    queue.WriteBuffer(mBodyBuffers[mCurrent], u64(slot) * sizeof(tkGpuBody), &gpuBody, sizeof(gpuBody));
+  }
+  if (!appended.empty())
+  {
+    queue.WriteBuffer(mBodyBuffers[mCurrent], u64(firstAppended) * sizeof(tkGpuBody), appended.data(), appended.size() * sizeof(tkGpuBody));
+  }
+}
+
+void tsPhysics2dGpu::ApplyReadbacks()
+{
+  entt::registry& registry = GetRegistry();
+  for (tkReadback& readback : mReadbacks)
+  {
+    if (readback.State == eReadbackState::Mapped)
+    {
+      const tkGpuBody* bodies = static_cast<const tkGpuBody*>(readback.Buffer.GetConstMappedRange(0, readback.Slots.size() * sizeof(tkGpuBody)));
+      for (size_t i = 0; i < readback.Slots.size(); i++)
+      {
+        // The entity may have been destroyed, or its slot reused, since the copy.
+        const entt::entity entity = readback.Entities[i];
+        const tcGpuBody2d* body = registry.valid(entity) ? registry.try_get<tcGpuBody2d>(entity) : nullptr;
+        if (!body || body->Body != readback.Slots[i])
+        {
+          continue;
+        }
+        if (tcTransform2d* transform = registry.try_get<tcTransform2d>(entity))
+        {
+          transform->Position = bodies[i].Position;
+          transform->Angle = bodies[i].Angle;
+        }
+        if (tcPhysics2d* physics = registry.try_get<tcPhysics2d>(entity))
+        {
+          physics->Velocity = bodies[i].Velocity;
+          physics->AngularVelocity = bodies[i].AngularVelocity;
+        }
+      }
+      readback.Buffer.Unmap();
+      readback.State = eReadbackState::Free;
+    }
+
+    // Mapping has to wait until the frame that recorded the copy was submitted.
+    if (readback.State == eReadbackState::Copied)
+    {
+      readback.State = eReadbackState::Mapping;
+      readback.Buffer.MapAsync(wgpu::MapMode::Read, 0, readback.Slots.size() * sizeof(tkGpuBody), [](WGPUBufferMapAsyncStatus status, void* userdata) {
+        tkReadback* readback = static_cast<tkReadback*>(userdata);
+        if (status != WGPUBufferMapAsyncStatus_Success)
+        {
+          tkLogWarning("GpuPhysics2d: Readback failed");
+          readback->State = eReadbackState::Free;
+          return;
+        }
+        readback->State = eReadbackState::Mapped;
+      }, &readback);
+    }
+  }
+}
+
+u32 tsPhysics2dGpu::GatherReadback(wgpu::Device& device, tkReadback*& readback)
+{
+  auto view = GetView<tcGpuBody2d, tcGpuBodyReadback>();
+  if (view.size_hint() == 0)
+  {
+    return 0;
+  }
+
+  // Every buffer still in flight means this frame's state is skipped.
+  auto free = std::find_if(mReadbacks.begin(), mReadbacks.end(), [](const tkReadback& r) { return r.State == eReadbackState::Free; });
+  if (free == mReadbacks.end())
+  {
+    return 0;
+  }
+
+  readback = &*free;
+  readback->Entities.clear();
+  readback->Slots.clear();
+  for (auto entity : view)
+  {
+    const u32 slot = view.get<tcGpuBody2d>(entity).Body;
+    if (slot != kInvalidGpuBody)
+    {
+      readback->Entities.push_back(entity);
+      readback->Slots.push_back(slot);
+    }
+  }
+  if (readback->Slots.empty())
+  {
+    return 0;
+  }
+
+  const u64 count = readback->Slots.size();
+  ReserveReadback(device, count);
+  if (count > readback->Capacity)
+  {
+    readback->Capacity = mReadbackCapacity;
+    wgpu::BufferDescriptor desc{
+      .label = "GPU Physics Readback Staging",
+      .usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst,
+      .size = readback->Capacity * sizeof(tkGpuBody),
+    };
+    readback->Buffer = device.CreateBuffer(&desc);
+  }
+  device.GetQueue().WriteBuffer(mReadbackSlotBuffer, 0, readback->Slots.data(), count * sizeof(u32));
+  return static_cast<u32>(count);
+}
+
+void tsPhysics2dGpu::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
+{
+  ApplyReadbacks();
+  UploadBodies(device);
+  if (mBodyCount == 0)
+  {
+    return;
+  }
+
+  tkReadback* readback = nullptr;
+  const u32 readbackCount = GatherReadback(device, readback);
+
+  const MVPUniforms& camera = tkRenderer::Get().mMvpUniforms;
+  const tkGpuPhysicsParams params{
+    .ViewProjection = camera.Projection * camera.View,
+    .Gravity = mSettings.Gravity,
+    .CellSize = std::max(mMaxRadius * 2.f, 1e-3f),
+    .Restitution = mSettings.Restitution,
+    .BodyCount = mBodyCount,
+    .CellCount = mCellCount,
+    .ReadbackCount = readbackCount,
+  };
+  device.GetQueue().WriteBuffer(mParamsBuffer, 0, &params, sizeof(params));
+
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+  pass.SetBindGroup(0, mSimulateBindGroups[mCurrent]);
+  pass.SetPipeline(mClearPipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mCellCount));
+  pass.SetPipeline(mCountPipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mBodyCount));
+  pass.SetPipeline(mScanLocalPipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mCellCount));
+  pass.SetPipeline(mScanBlocksPipeline);
+  pass.DispatchWorkgroups(1);
+  pass.SetPipeline(mScanAddPipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mCellCount));
+  pass.SetPipeline(mScatterPipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mBodyCount));
+  pass.SetPipeline(mCollidePipeline);
+  pass.DispatchWorkgroups(GetGroupCount(mBodyCount));
+  if (readbackCount > 0)
+  {
+    pass.SetBindGroup(1, mReadbackBindGroup);
+    pass.SetPipeline(mGatherPipeline);
+    pass.DispatchWorkgroups(GetGroupCount(readbackCount));
+  }
+  pass.End();
+
+  if (readbackCount > 0)
+  {
+    encoder.CopyBufferToBuffer(mReadbackBuffer, 0, readback->Buffer, 0, u64(readbackCount) * sizeof(tkGpuBody));
+    readback->State = eReadbackState::Copied;
+  }
+
+  mCurrent = 1 - mCurrent;
+}
+
+void tsPhysics2dGpu::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+{
+  if (mBodyCount == 0)
+  {
+    return;
+  }
+
+  pass.SetPipeline(mDrawPipeline);
+  pass.SetBindGroup(0, mDrawBindGroups[mCurrent]);
+  pass.Draw(4, mBodyCount);
+}
@@ -0,0 +1,127 @@
+#ifndef TS_PHYSICS2D_GPU_H
+#define TS_PHYSICS2D_GPU_H
+
+#include "../core/system.h"
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kGpuPhysicsReadbackFrames = 3;
+
+struct tkGpuPhysics2dSettings
+{
+  // Per step, like tcPhysics2d::Velocity.
+  v2 Gravity = v2(0.f);
+  f32 Restitution = 0.2f;
+};
+
+// Matches Params in physics2d.wgsl and physics2dDraw.wgsl.
+struct tkGpuPhysicsParams
+{
+  m4 ViewProjection;
+  v2 Gravity;
+  f32 CellSize;
+  f32 Restitution;
+  u32 BodyCount;
+  u32 CellCount;
+  u32 ReadbackCount;
+  u32 Padding;
+};
+
+// Matches Body in physics2d.wgsl.
+struct tkGpuBody
+{
+  v2 Position;
+  v2 Velocity;
+  f32 Radius;
+  f32 InvMass;
+  f32 Angle;
+  f32 AngularVelocity;
+  u32 Color;
+  u32 Padding;
+};
+
+// Integrates and collides tcGpuBody2d circles in compute, for body counts the CPU
+// tsPhysics2d cannot keep up with. State is double buffered on the GPU and drawn
+// straight from there; the CPU only uploads bodies as they are added or removed.
+//
+// Broadphase is a counting sort into a hashed uniform grid: count bodies per cell,
+// prefix sum the counts, scatter body indices, then test the 3x3 neighbourhood.
+class tsPhysics2dGpu : public tkRenderSystem
+{
+  enum class eReadbackState : u8
+  {
+    Free,
+    Copied,
+    Mapping,
+    Mapped,
+  };
+
+  struct tkReadback
+  {
+    wgpu::Buffer Buffer;
+    u64 Capacity = 0;
+    tkDArray<entt::entity> Entities;
+    tkDArray<u32> Slots;
+    eReadbackState State = eReadbackState::Free;
+  };
+
+  wgpu::ComputePipeline mClearPipeline;
+  wgpu::ComputePipeline mCountPipeline;
+  wgpu::ComputePipeline mScanLocalPipeline;
+  wgpu::ComputePipeline mScanBlocksPipeline;
+  wgpu::ComputePipeline mScanAddPipeline;
+  wgpu::ComputePipeline mScatterPipeline;
+  wgpu::ComputePipeline mCollidePipeline;
+  wgpu::ComputePipeline mGatherPipeline;
+  wgpu::RenderPipeline mDrawPipeline;
+
+  wgpu::BindGroupLayout mSimulateLayout;
+  wgpu::BindGroupLayout mReadbackLayout;
+  wgpu::BindGroupLayout mDrawLayout;
+  // Indexed by the buffer holding the latest state.
+  tkArray<wgpu::BindGroup, 2> mSimulateBindGroups;
+  tkArray<wgpu::BindGroup, 2> mDrawBindGroups;
+  wgpu::BindGroup mReadbackBindGroup;
+
+  wgpu::Buffer mParamsBuffer;
+  tkArray<wgpu::Buffer, 2> mBodyBuffers;
+  wgpu::Buffer mBodyCellBuffer;
+  wgpu::Buffer mCellCountBuffer;
+  wgpu::Buffer mCellStartBuffer;
+  wgpu::Buffer mBlockSumBuffer;
+  wgpu::Buffer mSortedBuffer;
+  wgpu::Buffer mReadbackSlotBuffer;
+  wgpu::Buffer mReadbackBuffer;
+  u64 mCapacity = 0;
+  u32 mCellCount = 0;
+  u64 mReadbackCapacity = 0;
+
+  // Bodies added since the last frame, uploaded once their components are all in place.
+  tkDArray<entt::entity> mPending;
+  // Slots of removed bodies, cleared on the GPU before they join mFreeSlots.
+  tkDArray<u32> mRemoved;
+  tkDArray<u32> mFreeSlots;
+  tkArray<tkReadback, kGpuPhysicsReadbackFrames> mReadbacks;
+  tkGpuPhysics2dSettings mSettings;
+  // Slots in use are all below this.
+  u32 mBodyCount = 0;
+  u32 mCurrent = 0;
+  f32 mMaxRadius = 0.f;
+
+public:
+  void SetupPipelines();
+  void SetSettings(const tkGpuPhysics2dSettings& settings) { mSettings = settings; }
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
+  void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+
+private:
+  void OnConstruct(entt::registry& registry, entt::entity entity);
+  void OnDestroy(entt::registry& registry, entt::entity entity);
+
+  void UploadBodies(wgpu::Device& device);
+  void Reserve(wgpu::Device& device, u64 bodyCount);
+  void ReserveReadback(wgpu::Device& device, u64 count);
+  void ApplyReadbacks();
+  u32 GatherReadback(wgpu::Device& device, tkReadback*& readback);
+};
+
+#endif //TS_PHYSICS2D_GPU_H
@@ -1,35 +1,214 @@
 #include "sRender2d.h"
 #include "../components/transform2d.h"
+#include "../core/gpuUtil.h"
 #include "../core/renderer.h"
 #include "../components/shape2d.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
 
-void tsRender2d::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+const u64 kMinLineCapacity = 1024;
+
+// Matches Camera in line.wgsl.
+struct tkLineCamera
+{
+  m4 ViewProjection;
+  f32 PixelScale;
+  f32 Padding[3];
+};
+
+void tsRender2d::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 3> entries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+  };
+  wgpu::BindGroupLayoutDescriptor layoutDesc{
+    .label = "Line",
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  mLayout = device.CreateBindGroupLayout(&layoutDesc);
+  mCameraBuffer = tkCreateBuffer(device, "Line Camera", wgpu::BufferUsage::Uniform, sizeof(tkLineCamera));
+
+  const wgpu::VertexAttribute segmentAttribute{.format = wgpu::VertexFormat::Uint32x2, .offset = 0, .shaderLocation = 0};
+  wgpu::VertexBufferLayout segmentLayout{
+    .arrayStride = sizeof(tkLineSegment),
+    .stepMode = wgpu::VertexStepMode::Instance,
+    .attributeCount = 1,
+    .attributes = &segmentAttribute,
+  };
+
+  wgpu::ShaderModule shaderModule = tkRenderer::Get().LoadShader("shaders/line.wgsl");
+  const wgpu::ColorTargetState colorTargetState = tkAlphaBlendTarget();
+  wgpu::FragmentState fragmentState{
+    .module = shaderModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+
+  // The anti-aliased fringe is blended, so lines must not hide what is drawn after them.
+  const wgpu::DepthStencilState depthStencilState = tkRenderer::Get().GetBlendedDepthState();
+
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mLayout,
+  };
+  wgpu::RenderPipelineDescriptor pipelineDesc{
+    .label = "Line",
+    .layout = device.CreatePipelineLayout(&pipelineLayoutDesc),
+    .vertex = {.module = shaderModule, .entryPoint = "vs_main", .bufferCount = 1, .buffers = &segmentLayout},
+    .primitive = {.topology = wgpu::PrimitiveTopology::TriangleStrip, .cullMode = wgpu::CullMode::None},
+    .depthStencil = &depthStencilState,
+    .fragment = &fragmentState,
+  };
+  mPipeline = device.CreateRenderPipeline(&pipelineDesc);
+
+  Reserve(device);
+}
+
+void tsRender2d::Reserve(wgpu::Device& device)
+{
+  auto grow = [](u64 size, u64& capacity) {
+    if (size <= capacity)
+    {
+      return false;
+    }
+    capacity = std::max<u64>(kMinLineCapacity, std::bit_ceil(size));
+    return true;
+  };
+
+  bool rebind = false;
+  if (grow(mPoints.size(), mPointCapacity))
+  {
+    mPointBuffer = tkCreateBuffer(device, "Line Points", wgpu::BufferUsage::Storage, mPointCapacity * sizeof(v2));
+    rebind = true;
+  }
+  if (grow(mStyles.size(), mStyleCapacity))
+  {
+    mStyleBuffer = tkCreateBuffer(device, "Line Styles", wgpu::BufferUsage::Storage, mStyleCapacity * sizeof(tkLineStyle));
+    rebind = true;
+  }
+  if (grow(mSegments.size(), mSegmentCapacity))
+  {
+    mSegmentBuffer = tkCreateBuffer(device, "Line Segments", wgpu::BufferUsage::Vertex, mSegmentCapacity * sizeof(tkLineSegment));
+  }
+  if (!rebind)
+  {
+    return;
+  }
+
+  const tkArray<wgpu::BindGroupEntry, 3> entries = {{
+    {.binding = 0, .buffer = mCameraBuffer, .size = sizeof(tkLineCamera)},
+    {.binding = 1, .buffer = mPointBuffer, .size = mPointCapacity * sizeof(v2)},
+    {.binding = 2, .buffer = mStyleBuffer, .size = mStyleCapacity * sizeof(tkLineStyle)},
+  }};
+  wgpu::BindGroupDescriptor bindGroupDesc{
+    .layout = mLayout,
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  mBindGroup = device.CreateBindGroup(&bindGroupDesc);
+}
+
+void tsRender2d::DrawPolyline(std::span<const v2> points, const tkLineStyle& style, bool closed)
+{
+  const u32 count = static_cast<u32>(points.size());
+  if (count < 2)
+  {
+    return;
+  }
+
+  const u32 styleIndex = static_cast<u32>(mStyles.size());
+  mStyles.push_back(style);
+
+  // Closed loops repeat the last point before and the first two after, so every
+  // segment can see both neighbours.
+  u32 first = static_cast<u32>(mPoints.size());
+  if (closed)
+  {
+    mPoints.push_back(points[count - 1]);
+    first++;
+  }
+  mPoints.insert(mPoints.end(), points.begin(), points.end());
+  if (closed)
+  {
+    mPoints.push_back(points[0]);
+    mPoints.push_back(points[1]);
+  }
+
+  const u32 segmentCount = closed ? count : count - 1;
+  for (u32 i = 0; i < segmentCount; i++)
+  {
+    u32 start = first + i;
+    if (closed || i > 0)
+    {
+      start |= kLineHasPrevious;
+    }
+    if (closed || i + 1 < segmentCount)
+    {
+      start |= kLineHasNext;
+    }
+    mSegments.push_back({start, styleIndex});
+  }
+}
+
+void tsRender2d::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
 {
-  const u32 restartIndex = 0xFFFFFFFF;
-  mPointData.clear();
-  mPointData.reserve(100000 * 6);
-  for(auto entity : GetView<tcTransform2d, tcRect>())
+  const tkLineStyle rectStyle{};
+  for (auto entity : GetView<tcTransform2d, tcRect>())
   {
-    tcTransform2d& t = GetComponent<tcTransform2d>(entity);
-    tcRect& r = GetComponent<tcRect>(entity);
+    const tcTransform2d& t = GetComponent<tcTransform2d>(entity);
+    const tcRect& r = GetComponent<tcRect>(entity);
+
+    const f32 c = std::cos(t.Angle) * t.Scale;
+    const f32 s = std::sin(t.Angle) * t.Scale;
+    const v2 x = v2(c, s) * r.Dimensions.x;
+    const v2 y = v2(-s, c) * r.Dimensions.y;
+    const tkArray<v2, 4> corners = {
+      t.Position - x - y,
+      t.Position + x - y,
+      t.Position + x + y,
+      t.Position - x + y,
+    };
+    DrawPolyline(corners, rectStyle, true);
+  }
 
-    mPointData.push_back(v2(-r.Dimensions.x, -r.Dimensions.y) + t.Position);
-    mPointData.push_back(v2( r.Dimensions.x, -r.Dimensions.y) + t.Position);
-    mPointData.push_back(v2( r.Dimensions.x,  r.Dimensions.y) + t.Position);
-    mPointData.push_back(v2(-r.Dimensions.x,  r.Dimensions.y) + t.Position);
-    mPointData.push_back(v2(-r.Dimensions.x, -r.Dimensions.y) + t.Position);
+  mDrawCount = static_cast<u32>(mSegments.size());
+  if (mDrawCount > 0)
+  {
+    Reserve(device);
 
-    mPointData.push_back((v2&)restartIndex);
+    const MVPUniforms& mvp = tkRenderer::Get().mMvpUniforms;
+    const tkLineCamera camera{
+      .ViewProjection = mvp.Projection * mvp.View,
+      .PixelScale = 2.f / (static_cast<f32>(kWindowHeight) * mvp.Projection[1][1]),
+    };
+    wgpu::Queue queue = device.GetQueue();
+    queue.WriteBuffer(mCameraBuffer, 0, &camera, sizeof(camera));
+    queue.WriteBuffer(mPointBuffer, 0, mPoints.data(), mPoints.size() * sizeof(v2));
+    queue.WriteBuffer(mStyleBuffer, 0, mStyles.data(), mStyles.size() * sizeof(tkLineStyle));
+    queue.WriteBuffer(mSegmentBuffer, 0, mSegments.data(), mSegments.size() * sizeof(tkLineSegment));
   }
-  device.GetQueue().WriteBuffer(mPointBuffer, 0, mPointData.data(), mPointData.size() * sizeof(v2));
-  pass.SetVertexBuffer(0, mPointBuffer, 0, mPointData.size() * sizeof(v2));
-  pass.Draw(mPointData.size());
+
+  mPoints.clear();
+  mStyles.clear();
+  mSegments.clear();
 }
 
-void tsRender2d::SetupBuffers()
+void tsRender2d::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
 {
-  wgpu::BufferDescriptor desc;
-  desc.size = sizeof(v2) * 5 * 100000;
-  desc.usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::CopyDst;
-  mPointBuffer = tkRenderer::GetDevice().CreateBuffer(&desc);
+  if (mDrawCount == 0)
+  {
+    return;
+  }
+
+  pass.SetPipeline(mPipeline);
+  pass.SetBindGroup(0, mBindGroup);
+  pass.SetVertexBuffer(0, mSegmentBuffer);
+  pass.Draw(4, mDrawCount);
 }
@@ -2,16 +2,67 @@
 #define TS_RENDER_WORLD2D_H
 
 #include "../core/system.h"
+#include <span>
 #include <webgpu/webgpu_cpp.h>
 
+enum class eLineJoin : u32
+{
+  Miter = 0,
+  Round,
+};
+
+// Matches LineStyle in line.wgsl. A width of 0 draws a one pixel hairline.
+struct tkLineStyle
+{
+  f32 Width = 0.f;
+  // RGBA8 unorm.
+  u32 Color = 0xFFFFFFFF;
+  eLineJoin Join = eLineJoin::Miter;
+  u32 Padding = 0;
+};
+
+// One instance per segment, from point Start to Start + 1. The top bits of Start say
+// whether the points before and after exist, so joins can be built from them.
+struct tkLineSegment
+{
+  u32 Start;
+  u32 Style;
+};
+
+const u32 kLineHasPrevious = 1u << 31;
+const u32 kLineHasNext = 1u << 30;
+const u32 kLinePointMask = kLineHasNext - 1;
+
+// Thick anti-aliased polylines. Points, styles and segments are packed into compact
+// buffers each frame and every segment is expanded to a quad in the vertex shader,
+// so all lines cost a single instanced draw. tcRect outlines are drawn this way, and
+// DrawPolyline adds immediate mode lines for the current frame.
 class tsRender2d : public tkRenderSystem
-{ 
-  wgpu::Buffer mPointBuffer{};
-  tkDArray<v2> mPointData{};
-  
+{
+  wgpu::RenderPipeline mPipeline;
+  wgpu::BindGroupLayout mLayout;
+  wgpu::BindGroup mBindGroup;
+  wgpu::Buffer mCameraBuffer;
+  wgpu::Buffer mPointBuffer;
+  wgpu::Buffer mStyleBuffer;
+  wgpu::Buffer mSegmentBuffer;
+  u64 mPointCapacity = 0;
+  u64 mStyleCapacity = 0;
+  u64 mSegmentCapacity = 0;
+
+  tkDArray<v2> mPoints;
+  tkDArray<tkLineStyle> mStyles;
+  tkDArray<tkLineSegment> mSegments;
+  u32 mDrawCount = 0;
+
 public:
-  void SetupBuffers();
+  void SetupPipelines();
+  void DrawPolyline(std::span<const v2> points, const tkLineStyle& style, bool closed = false);
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
   void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+
+private:
+  void Reserve(wgpu::Device& device);
 };
 
 #endif //TS_RENDER_WORLD2D_H
@@ -0,0 +1,428 @@
+#include "sRenderMesh.h"
+#include "../components/mesh.h"
+#include "../components/transform3d.h"
+#include "../core/gpuUtil.h"
+#include "../core/renderer.h"
+#include "../core/logger.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <bit>
+
+const u32 kMeshCullWorkgroupSize = 64;
+const u32 kHiZWorkgroupSize = 8;
+const u32 kMaxWorkgroupsPerDimension = 65535;
+
+enum eMeshPhase : u32
+{
+  Early = 0,
+  Late,
+};
+
+void tsRenderMesh::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+  wgpu::SupportedLimits limits{};
+  device.GetLimits(&limits);
+  mMaxStorageBinding = limits.limits.maxStorageBufferBindingSize;
+
+  tkArray<wgpu::BindGroupLayoutEntry, 9> cullEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(3, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(4, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(5, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(6, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(7, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    {.binding = 8, .visibility = wgpu::ShaderStage::Compute, .texture = {.sampleType = wgpu::TextureSampleType::UnfilterableFloat}},
+  };
+  wgpu::BindGroupLayoutDescriptor cullLayoutDesc{
+    .label = "Meshlet Cull",
+    .entryCount = cullEntries.size(),
+    .entries = cullEntries.data(),
+  };
+  mCullLayout = device.CreateBindGroupLayout(&cullLayoutDesc);
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 6> drawEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(3, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(4, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(5, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+  };
+  wgpu::BindGroupLayoutDescriptor drawLayoutDesc{
+    .label = "Meshlet Draw",
+    .entryCount = drawEntries.size(),
+    .entries = drawEntries.data(),
+  };
+  mDrawLayout = device.CreateBindGroupLayout(&drawLayoutDesc);
+
+  wgpu::ShaderModule cullModule = tkRenderer::Get().LoadShader("shaders/meshletCull.wgsl");
+  mEarlyCullPipeline = tkCreateComputePipeline(device, "Meshlet Cull Early", {&mCullLayout, 1}, cullModule, "cs_early");
+  mLateCullPipeline = tkCreateComputePipeline(device, "Meshlet Cull Late", {&mCullLayout, 1}, cullModule, "cs_late");
+
+  wgpu::ShaderModule shaderModule = tkRenderer::Get().LoadShader("shaders/meshlet.wgsl");
+  wgpu::ColorTargetState colorTargetState{
+    .format = wgpu::TextureFormat::BGRA8Unorm
+  };
+  wgpu::FragmentState fragmentState{
+    .module = shaderModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+
+  wgpu::PrimitiveState primitiveState;
+  primitiveState.topology = wgpu::PrimitiveTopology::TriangleList;
+  primitiveState.cullMode = wgpu::CullMode::Back;
+
+  // Group 1 holds the clustered light lists from tkLightClusters, group 2 the IBL textures.
+  const tkArray<wgpu::BindGroupLayout, 3> drawGroupLayouts = {
+    mDrawLayout,
+    tkRenderer::Get().mLights.GetBindGroupLayout(),
+    tkRenderer::Get().mImageLighting.GetBindGroupLayout(),
+  };
+  wgpu::PipelineLayoutDescriptor drawPipelineLayoutDesc{
+    .bindGroupLayoutCount = drawGroupLayouts.size(),
+    .bindGroupLayouts = drawGroupLayouts.data(),
+  };
+  wgpu::RenderPipelineDescriptor drawDesc{
+    .label = "Meshlet Draw",
+    .layout = device.CreatePipelineLayout(&drawPipelineLayoutDesc),
+    .vertex = {.module = shaderModule, .entryPoint = "vs_main"},
+    .primitive = primitiveState,
+    .depthStencil = &tkRenderer::Get().wDepthStencilState,
+    .fragment = &fragmentState,
+  };
+  mDrawPipeline = device.CreateRenderPipeline(&drawDesc);
+
+  wgpu::PipelineLayoutDescriptor depthPipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mDrawLayout,
+  };
+  drawDesc.label = "Meshlet Depth";
+  drawDesc.layout = device.CreatePipelineLayout(&depthPipelineLayoutDesc);
+  drawDesc.fragment = nullptr;
+  mDepthPipeline = device.CreateRenderPipeline(&drawDesc);
+
+  SetupHiZ(device);
+}
+
+void tsRenderMesh::SetupHiZ(wgpu::Device& device)
+{
+  const tkArray<wgpu::BindGroupLayoutEntry, 2> copyEntries = {{
+    {.binding = 0, .visibility = wgpu::ShaderStage::Compute, .texture = {.sampleType = wgpu::TextureSampleType::Depth}},
+    {.binding = 1, .visibility = wgpu::ShaderStage::Compute,
+     .storageTexture = {.access = wgpu::StorageTextureAccess::WriteOnly, .format = wgpu::TextureFormat::R32Float}},
+  }};
+  const tkArray<wgpu::BindGroupLayoutEntry, 2> downsampleEntries = {{
+    {.binding = 1, .visibility = wgpu::ShaderStage::Compute,
+     .storageTexture = {.access = wgpu::StorageTextureAccess::WriteOnly, .format = wgpu::TextureFormat::R32Float}},
+    {.binding = 2, .visibility = wgpu::ShaderStage::Compute, .texture = {.sampleType = wgpu::TextureSampleType::UnfilterableFloat}},
+  }};
+  wgpu::BindGroupLayoutDescriptor copyLayoutDesc{.label = "HiZ Copy", .entryCount = copyEntries.size(), .entries = copyEntries.data()};
+  wgpu::BindGroupLayoutDescriptor downsampleLayoutDesc{.label = "HiZ Downsample", .entryCount = downsampleEntries.size(), .entries = downsampleEntries.data()};
+  wgpu::BindGroupLayout copyLayout = device.CreateBindGroupLayout(&copyLayoutDesc);
+  wgpu::BindGroupLayout downsampleLayout = device.CreateBindGroupLayout(&downsampleLayoutDesc);
+
+  wgpu::ShaderModule module = tkRenderer::Get().LoadShader("shaders/hiz.wgsl");
+  mHiZCopyPipeline = tkCreateComputePipeline(device, "HiZ Copy", {&copyLayout, 1}, module, "cs_copy_depth");
+  mHiZDownsamplePipeline = tkCreateComputePipeline(device, "HiZ Downsample", {&downsampleLayout, 1}, module, "cs_downsample");
+
+  // Same size as the depth buffer from tkRenderer::SetupDepthStencil.
+  const u32 mipCount = std::bit_width(static_cast<u32>(std::max(kWindowWidth, kWindowHeight)));
+  wgpu::TextureDescriptor textureDesc{
+    .label = "HiZ",
+    .usage = wgpu::TextureUsage::StorageBinding | wgpu::TextureUsage::TextureBinding,
+    .dimension = wgpu::TextureDimension::e2D,
+    .size = {kWindowWidth, kWindowHeight, 1},
+    .format = wgpu::TextureFormat::R32Float,
+    .mipLevelCount = mipCount,
+    .sampleCount = 1,
+  };
+  mHiZTexture = device.CreateTexture(&textureDesc);
+  mHiZView = tkRenderer::Get().GetTextureView(mHiZTexture);
+
+  mHiZBindGroups.clear();
+  mHiZSizes.clear();
+  wgpu::TextureView previous;
+  for (u32 mip = 0; mip < mipCount; mip++)
+  {
+    wgpu::TextureViewDescriptor viewDesc{
+      .format = wgpu::TextureFormat::R32Float,
+      .dimension = wgpu::TextureViewDimension::e2D,
+      .baseMipLevel = mip,
+      .mipLevelCount = 1,
+      .baseArrayLayer = 0,
+      .arrayLayerCount = 1,
+    };
+    wgpu::TextureView view = tkRenderer::Get().GetTextureView(mHiZTexture, viewDesc);
+
+    const tkArray<wgpu::BindGroupEntry, 2> entries = {{
+      {.binding = mip == 0 ? 0u : 2u, .textureView = mip == 0 ? tkRenderer::Get().wDepthTextureView : previous},
+      {.binding = 1, .textureView = view},
+    }};
+    wgpu::BindGroupDescriptor bindGroupDesc{
+      .layout = mip == 0 ? copyLayout : downsampleLayout,
+      .entryCount = entries.size(),
+      .entries = entries.data(),
+    };
+    mHiZBindGroups.push_back(device.CreateBindGroup(&bindGroupDesc));
+    mHiZSizes.push_back({std::max(static_cast<u32>(kWindowWidth) >> mip, 1u), std::max(static_cast<u32>(kWindowHeight) >> mip, 1u), 1});
+    previous = view;
+  }
+}
+
+void tsRenderMesh::GatherInstances()
+{
+  mFrame++;
+  for (auto& [key, batch] : mBatches)
+  {
+    batch.Instances.clear();
+  }
+
+  tkAssetPool<tkMeshAsset>& meshes = tkAssetManager::Get().Meshes;
+  for (auto entity : GetView<tcTransform3d, tcMesh>())
+  {
+    const tcMesh& mesh = GetComponent<tcMesh>(entity);
+    const tkMeshAsset* asset = meshes.Get(mesh.Mesh);
+    if (!asset || asset->MeshletCount == 0)
+    {
+      continue;
+    }
+
+    const tcTransform3d& transform = GetComponent<tcTransform3d>(entity);
+    m4 model = glm::translate(m4(1.f), transform.Position) * glm::mat4_cast(transform.Rotation);
+    model = glm::scale(model, transform.Scale);
+    const f32 maxScale = std::max({std::abs(transform.Scale.x), std::abs(transform.Scale.y), std::abs(transform.Scale.z)});
+
+    const u64 key = (static_cast<u64>(mesh.Mesh.Index) << 32) | mesh.Mesh.Generation;
+    tkMeshBatch& batch = mBatches[key];
+    batch.Mesh = mesh.Mesh;
+    batch.LastFrame = mFrame;
+    batch.Instances.push_back({model, v4(asset->BoundsMin, maxScale), v4(asset->BoundsExtent, 0.f)});
+  }
+
+  std::erase_if(mBatches, [this](const auto& entry) { return entry.second.LastFrame != mFrame; });
+}
+
+void tsRenderMesh::PrepareBatch(wgpu::Device& device, tkMeshBatch& batch, const tkMeshAsset& mesh)
+{
+  // Every (instance, meshlet) pair may survive, so the visible lists are sized for all of them.
+  const u64 maxInstances = mMaxStorageBinding / (static_cast<u64>(mesh.MeshletCount) * sizeof(u32) * 2);
+  if (batch.Instances.size() > maxInstances)
+  {
+    tkLogWarning("RenderMesh: %zu instances exceed the visible cluster buffer, drawing %llu",
+                 batch.Instances.size(), static_cast<unsigned long long>(maxInstances));
+    batch.Instances.resize(maxInstances);
+  }
+
+  const u32 count = static_cast<u32>(batch.Instances.size());
+  if (count <= batch.InstanceCapacity && batch.BoundMeshlets == mesh.MeshletBuffer.Get())
+  {
+    return;
+  }
+
+  if (!batch.ParamsBuffer)
+  {
+    wgpu::BufferDescriptor paramsDesc{
+      .label = "Meshlet Cull Params",
+      .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+      .size = sizeof(tkMeshletCullParams),
+    };
+    batch.ParamsBuffer = device.CreateBuffer(&paramsDesc);
+
+    wgpu::BufferDescriptor drawDesc{
+      .label = "Meshlet Draw Args",
+      .usage = wgpu::BufferUsage::Indirect | wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+      .size = sizeof(u32) * 4,
+    };
+    batch.DrawBuffers = {device.CreateBuffer(&drawDesc), device.CreateBuffer(&drawDesc)};
+  }
+
+  batch.InstanceCapacity = static_cast<u32>(std::min<u64>(std::bit_ceil(std::max(count, batch.InstanceCapacity)), maxInstances));
+  batch.BoundMeshlets = mesh.MeshletBuffer.Get();
+  batch.MeshletCount = mesh.MeshletCount;
+
+  wgpu::BufferDescriptor instanceDesc{
+    .label = "Mesh Instances",
+    .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+    .size = batch.InstanceCapacity * sizeof(tkMeshInstance),
+  };
+  batch.InstanceBuffer = device.CreateBuffer(&instanceDesc);
+
+  // A fresh history is all zero, so the first frame after a resize relies on phase two only.
+  const u64 clusterCount = static_cast<u64>(batch.InstanceCapacity) * mesh.MeshletCount;
+  wgpu::BufferDescriptor historyDesc{
+    .label = "Meshlet Visibility History",
+    .usage = wgpu::BufferUsage::Storage,
+    .size = clusterCount * sizeof(u32),
+  };
+  batch.HistoryBuffer = device.CreateBuffer(&historyDesc);
+
+  wgpu::BufferDescriptor visibleDesc{
+    .label = "Visible Meshlets",
+    .usage = wgpu::BufferUsage::Storage,
+    .size = clusterCount * sizeof(u32) * 2,
+  };
+  batch.VisibleBuffers = {device.CreateBuffer(&visibleDesc), device.CreateBuffer(&visibleDesc)};
+
+  const tkArray<wgpu::BindGroupEntry, 9> cullEntries = {{
+    {.binding = 0, .buffer = batch.ParamsBuffer, .size = sizeof(tkMeshletCullParams)},
+    {.binding = 1, .buffer = batch.InstanceBuffer, .size = instanceDesc.size},
+    {.binding = 2, .buffer = mesh.MeshletBuffer, .size = mesh.MeshletCount * sizeof(tkMeshlet)},
+    {.binding = 3, .buffer = batch.VisibleBuffers[Early], .size = visibleDesc.size},
+    {.binding = 4, .buffer = batch.DrawBuffers[Early], .size = sizeof(u32) * 4},
+    {.binding = 5, .buffer = batch.VisibleBuffers[Late], .size = visibleDesc.size},
+    {.binding = 6, .buffer = batch.DrawBuffers[Late], .size = sizeof(u32) * 4},
+    {.binding = 7, .buffer = batch.HistoryBuffer, .size = historyDesc.size},
+    {.binding = 8, .textureView = mHiZView},
+  }};
+  wgpu::BindGroupDescriptor cullDesc{
+    .layout = mCullLayout,
+    .entryCount = cullEntries.size(),
+    .entries = cullEntries.data(),
+  };
+  batch.CullBindGroup = device.CreateBindGroup(&cullDesc);
+
+  for (u32 phase : {Early, Late})
+  {
+    const tkArray<wgpu::BindGroupEntry, 6> drawEntries = {{
+      {.binding = 0, .buffer = batch.ParamsBuffer, .size = sizeof(tkMeshletCullParams)},
+      {.binding = 1, .buffer = batch.InstanceBuffer, .size = instanceDesc.size},
+      {.binding = 2, .buffer = mesh.MeshletBuffer, .size = mesh.MeshletCount * sizeof(tkMeshlet)},
+      {.binding = 3, .buffer = batch.VisibleBuffers[phase], .size = visibleDesc.size},
+      {.binding = 4, .buffer = mesh.VertexBuffer, .size = mesh.VertexCount * sizeof(tkPackedMeshVertex)},
+      {.binding = 5, .buffer = mesh.IndexBuffer, .size = mesh.IndexCount * sizeof(u32)},
+    }};
+    wgpu::BindGroupDescriptor drawDesc{
+      .layout = mDrawLayout,
+      .entryCount = drawEntries.size(),
+      .entries = drawEntries.data(),
+    };
+    batch.DrawBindGroups[phase] = device.CreateBindGroup(&drawDesc);
+  }
+}
+
+void tsRenderMesh::DispatchCull(wgpu::ComputePassEncoder& pass, const tkMeshBatch& batch)
+{
+  const u64 threads = static_cast<u64>(batch.Instances.size()) * batch.MeshletCount;
+  const u32 groups = static_cast<u32>((threads + kMeshCullWorkgroupSize - 1) / kMeshCullWorkgroupSize);
+  const u32 groupsX = std::min(groups, kMaxWorkgroupsPerDimension);
+  pass.SetBindGroup(0, batch.CullBindGroup);
+  pass.DispatchWorkgroups(groupsX, (groups + groupsX - 1) / groupsX);
+}
+
+void tsRenderMesh::BuildHiZ(wgpu::ComputePassEncoder& pass)
+{
+  for (u32 mip = 0; mip < mHiZBindGroups.size(); mip++)
+  {
+    pass.SetPipeline(mip == 0 ? mHiZCopyPipeline : mHiZDownsamplePipeline);
+    pass.SetBindGroup(0, mHiZBindGroups[mip]);
+    pass.DispatchWorkgroups((mHiZSizes[mip].width + kHiZWorkgroupSize - 1) / kHiZWorkgroupSize,
+                            (mHiZSizes[mip].height + kHiZWorkgroupSize - 1) / kHiZWorkgroupSize);
+  }
+}
+
+void tsRenderMesh::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
+{
+  GatherInstances();
+  if (mBatches.empty())
+  {
+    return;
+  }
+
+  const MVPUniforms& camera = tkRenderer::Get().mMvpUniforms;
+  tkMeshletCullParams params{
+    .View = camera.View,
+    .Projection = camera.Projection,
+    .ViewPosition = v4(v3(glm::inverse(camera.View)[3]), 1.f),
+  };
+
+  // Gribb-Hartmann planes with the -w..w depth range, which is conservative for 0..w.
+  const m4 viewProjection = camera.Projection * camera.View;
+  for (u32 i = 0; i < 6; i++)
+  {
+    v4 plane;
+    for (u32 column = 0; column < 4; column++)
+    {
+      const v4& c = viewProjection[column];
+      plane[column] = c[3] + (i % 2 == 0 ? c[i / 2] : -c[i / 2]);
+    }
+    params.Planes[i] = plane / glm::length(v3(plane));
+  }
+
+  tkAssetPool<tkMeshAsset>& meshes = tkAssetManager::Get().Meshes;
+  wgpu::Queue queue = device.GetQueue();
+  const tkArray<u32, 4> drawArgs = {kMeshletMaxTriangles * 3, 0, 0, 0};
+  for (auto& [key, batch] : mBatches)
+  {
+    PrepareBatch(device, batch, *meshes.Get(batch.Mesh));
+    params.InstanceCount = static_cast<u32>(batch.Instances.size());
+    params.MeshletCount = batch.MeshletCount;
+
+    queue.WriteBuffer(batch.ParamsBuffer, 0, &params, sizeof(params));
+    queue.WriteBuffer(batch.InstanceBuffer, 0, batch.Instances.data(), batch.Instances.size() * sizeof(tkMeshInstance));
+    queue.WriteBuffer(batch.DrawBuffers[Early], 0, drawArgs.data(), sizeof(drawArgs));
+    queue.WriteBuffer(batch.DrawBuffers[Late], 0, drawArgs.data(), sizeof(drawArgs));
+  }
+
+  wgpu::ComputePassEncoder earlyCull = encoder.BeginComputePass();
+  earlyCull.SetPipeline(mEarlyCullPipeline);
+  for (auto& [key, batch] : mBatches)
+  {
+    DispatchCull(earlyCull, batch);
+  }
+  earlyCull.End();
+
+  // Depth only; the renderer has already cleared the depth buffer this frame.
+  wgpu::RenderPassDepthStencilAttachment depthAttachment{
+    .view = tkRenderer::Get().wDepthTextureView,
+    .depthLoadOp = wgpu::LoadOp::Load,
+    .depthStoreOp = wgpu::StoreOp::Store,
+    .stencilReadOnly = true,
+  };
+  wgpu::RenderPassDescriptor depthPassDesc{
+    .label = "Meshlet Depth Prepass",
+    .depthStencilAttachment = &depthAttachment,
+  };
+  wgpu::RenderPassEncoder depthPass = encoder.BeginRenderPass(&depthPassDesc);
+  depthPass.SetPipeline(mDepthPipeline);
+  for (auto& [key, batch] : mBatches)
+  {
+    depthPass.SetBindGroup(0, batch.DrawBindGroups[Early]);
+    depthPass.DrawIndirect(batch.DrawBuffers[Early], 0);
+  }
+  depthPass.End();
+
+  wgpu::ComputePassEncoder lateCull = encoder.BeginComputePass();
+  BuildHiZ(lateCull);
+  lateCull.SetPipeline(mLateCullPipeline);
+  for (auto& [key, batch] : mBatches)
+  {
+    DispatchCull(lateCull, batch);
+  }
+  lateCull.End();
+}
+
+void tsRenderMesh::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+{
+  if (mBatches.empty())
+  {
+    return;
+  }
+
+  pass.SetPipeline(mDrawPipeline);
+  pass.SetBindGroup(1, tkRenderer::Get().mLights.GetBindGroup());
+  pass.SetBindGroup(2, tkRenderer::Get().mImageLighting.GetBindGroup());
+  for (auto& [key, batch] : mBatches)
+  {
+    for (u32 phase : {Early, Late})
+    {
+      pass.SetBindGroup(0, batch.DrawBindGroups[phase]);
+      pass.DrawIndirect(batch.DrawBuffers[phase], 0);
+    }
+  }
+}
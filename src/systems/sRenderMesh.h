@@ -0,0 +1,85 @@
+#ifndef TS_RENDER_MESH_H
+#define TS_RENDER_MESH_H
+
+#include "../core/system.h"
+#include "../core/assets.h"
+#include <unordered_map>
+#include <webgpu/webgpu_cpp.h>
+
+// Matches CullParams in meshletCull.wgsl and meshlet.wgsl.
+struct tkMeshletCullParams
+{
+  m4 View;
+  m4 Projection;
+  v4 ViewPosition;
+  v4 Planes[6];
+  u32 InstanceCount;
+  u32 MeshletCount;
+  u32 Padding[2];
+};
+
+// Matches Instance in meshletCull.wgsl and meshlet.wgsl.
+struct tkMeshInstance
+{
+  m4 Model;
+  v4 QuantOffset;
+  v4 QuantScale;
+};
+
+// GPU-driven mesh path. Every (instance, meshlet) pair is frustum and cone culled in
+// a compute pass, the survivors are drawn with one indirect draw per mesh asset.
+//
+// Occlusion culling runs in two phases. Clusters visible last frame are drawn into
+// the depth buffer first, a Hi-Z pyramid is built from it, and all clusters are tested
+// against that pyramid. The main pass then shades both lists.
+class tsRenderMesh : public tkRenderSystem
+{
+  struct tkMeshBatch
+  {
+    tkHandle<tkMeshAsset> Mesh;
+    tkDArray<tkMeshInstance> Instances;
+    wgpu::Buffer ParamsBuffer;
+    wgpu::Buffer InstanceBuffer;
+    wgpu::Buffer HistoryBuffer;
+    tkArray<wgpu::Buffer, 2> VisibleBuffers;
+    tkArray<wgpu::Buffer, 2> DrawBuffers;
+    wgpu::BindGroup CullBindGroup;
+    tkArray<wgpu::BindGroup, 2> DrawBindGroups;
+    WGPUBuffer BoundMeshlets = nullptr;
+    u32 MeshletCount = 0;
+    u32 InstanceCapacity = 0;
+    u64 LastFrame = 0;
+  };
+
+  wgpu::ComputePipeline mEarlyCullPipeline;
+  wgpu::ComputePipeline mLateCullPipeline;
+  wgpu::RenderPipeline mDepthPipeline;
+  wgpu::RenderPipeline mDrawPipeline;
+  wgpu::BindGroupLayout mCullLayout;
+  wgpu::BindGroupLayout mDrawLayout;
+
+  wgpu::ComputePipeline mHiZCopyPipeline;
+  wgpu::ComputePipeline mHiZDownsamplePipeline;
+  wgpu::Texture mHiZTexture;
+  wgpu::TextureView mHiZView;
+  tkDArray<wgpu::BindGroup> mHiZBindGroups;
+  tkDArray<wgpu::Extent3D> mHiZSizes;
+
+  std::unordered_map<u64, tkMeshBatch> mBatches;
+  u64 mMaxStorageBinding = 0;
+  u64 mFrame = 0;
+
+public:
+  void SetupPipelines();
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
+  void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+
+private:
+  void SetupHiZ(wgpu::Device& device);
+  void GatherInstances();
+  void DispatchCull(wgpu::ComputePassEncoder& pass, const tkMeshBatch& batch);
+  void BuildHiZ(wgpu::ComputePassEncoder& pass);
+  void PrepareBatch(wgpu::Device& device, tkMeshBatch& batch, const tkMeshAsset& mesh);
+};
+
+#endif //TS_RENDER_MESH_H
@@ -0,0 +1,377 @@
+#include "sRenderParticles.h"
+#include "../components/particles.h"
+#include "../components/transform2d.h"
+#include "../core/gpuUtil.h"
+#include "../core/renderer.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+const u32 kParticleWorkgroupSize = 64;
+const u32 kParticleSortWorkgroupSize = 256;
+const u32 kParticleSortBlockSize = 512;
+const u32 kParticleSortStepStride = 256;
+const u32 kMinEmitterCapacity = 64;
+// Frame times are clamped to this so a hitch does not teleport particles.
+const f32 kMaxParticleDeltaTime = 0.1f;
+// Kept past a lifetime before the CPU assumes the GPU has retired those particles.
+const f32 kParticleExpiryMargin = 0.25f;
+
+// Matches SortStep in particles.wgsl. Merge steps leave J at 0.
+struct tkParticleSortStep
+{
+  u32 K;
+  u32 J;
+};
+
+static tkDArray<tkParticleSortStep> GetSortSteps(u32 size)
+{
+  tkDArray<tkParticleSortStep> steps;
+  for (u32 k = kParticleSortBlockSize * 2; k <= size; k *= 2)
+  {
+    for (u32 j = k / 2; j >= kParticleSortBlockSize; j /= 2)
+    {
+      steps.push_back({k, j});
+    }
+    steps.push_back({k, 0});
+  }
+  return steps;
+}
+
+void tsRenderParticles::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 7> simulateEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(3, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(4, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+    tkBufferLayoutEntry(5, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(6, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage),
+  };
+  wgpu::BindGroupLayoutDescriptor simulateLayoutDesc{
+    .label = "Particle Simulate",
+    .entryCount = simulateEntries.size(),
+    .entries = simulateEntries.data(),
+  };
+  mSimulateLayout = device.CreateBindGroupLayout(&simulateLayoutDesc);
+
+  const wgpu::BindGroupLayoutEntry indirectEntry = tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Storage);
+  wgpu::BindGroupLayoutDescriptor indirectLayoutDesc{
+    .label = "Particle Indirect",
+    .entryCount = 1,
+    .entries = &indirectEntry,
+  };
+  wgpu::BindGroupLayout indirectLayout = device.CreateBindGroupLayout(&indirectLayoutDesc);
+
+  const wgpu::BindGroupLayoutEntry sortStepEntry = tkBufferLayoutEntry(0, wgpu::ShaderStage::Compute, wgpu::BufferBindingType::Uniform, true);
+  wgpu::BindGroupLayoutDescriptor sortStepLayoutDesc{
+    .label = "Particle Sort Step",
+    .entryCount = 1,
+    .entries = &sortStepEntry,
+  };
+  wgpu::BindGroupLayout sortStepLayout = device.CreateBindGroupLayout(&sortStepLayoutDesc);
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 4> drawEntries = {
+    tkBufferLayoutEntry(0, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::Uniform),
+    tkBufferLayoutEntry(1, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(2, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+    tkBufferLayoutEntry(3, wgpu::ShaderStage::Vertex, wgpu::BufferBindingType::ReadOnlyStorage),
+  };
+  wgpu::BindGroupLayoutDescriptor drawLayoutDesc{
+    .label = "Particle Draw",
+    .entryCount = drawEntries.size(),
+    .entries = drawEntries.data(),
+  };
+  mDrawLayout = device.CreateBindGroupLayout(&drawLayoutDesc);
+
+  wgpu::ShaderModule module = tkRenderer::Get().LoadShader("shaders/particles.wgsl");
+  const tkArray<wgpu::BindGroupLayout, 1> simulateLayouts = {mSimulateLayout};
+  const tkArray<wgpu::BindGroupLayout, 2> indirectLayouts = {mSimulateLayout, indirectLayout};
+  const tkArray<wgpu::BindGroupLayout, 2> sortLayouts = {mSimulateLayout, sortStepLayout};
+  mBeginPipeline = tkCreateComputePipeline(device, "Particle Begin", simulateLayouts, module, "cs_begin");
+  mEmitPipeline = tkCreateComputePipeline(device, "Particle Emit", simulateLayouts, module, "cs_emit");
+  mPreparePipeline = tkCreateComputePipeline(device, "Particle Prepare", indirectLayouts, module, "cs_prepare");
+  mSimulatePipeline = tkCreateComputePipeline(device, "Particle Simulate", simulateLayouts, module, "cs_simulate");
+  mFinalizePipeline = tkCreateComputePipeline(device, "Particle Finalize", indirectLayouts, module, "cs_finalize");
+  mSortKeysPipeline = tkCreateComputePipeline(device, "Particle Sort Keys", simulateLayouts, module, "cs_sort_keys");
+  mSortLocalPipeline = tkCreateComputePipeline(device, "Particle Sort Local", simulateLayouts, module, "cs_sort_local");
+  mSortGlobalPipeline = tkCreateComputePipeline(device, "Particle Sort Global", sortLayouts, module, "cs_sort_global");
+  mSortMergePipeline = tkCreateComputePipeline(device, "Particle Sort Merge", sortLayouts, module, "cs_sort_merge");
+
+  wgpu::ShaderModule drawModule = tkRenderer::Get().LoadShader("shaders/particleDraw.wgsl");
+  const wgpu::ColorTargetState colorTargetState = tkAlphaBlendTarget();
+  wgpu::FragmentState fragmentState{
+    .module = drawModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+  const wgpu::DepthStencilState depthStencilState = tkRenderer::Get().GetBlendedDepthState();
+  wgpu::PipelineLayoutDescriptor drawPipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mDrawLayout,
+  };
+  wgpu::RenderPipelineDescriptor drawDesc{
+    .label = "Particle Draw",
+    .layout = device.CreatePipelineLayout(&drawPipelineLayoutDesc),
+    .vertex = {.module = drawModule, .entryPoint = "vs_main"},
+    .primitive = {.topology = wgpu::PrimitiveTopology::TriangleStrip, .cullMode = wgpu::CullMode::None},
+    .depthStencil = &depthStencilState,
+    .fragment = &fragmentState,
+  };
+  mDrawPipeline = device.CreateRenderPipeline(&drawDesc);
+
+  mParamsBuffer = tkCreateBuffer(device, "Particle Params", wgpu::BufferUsage::Uniform, sizeof(tkParticleParams));
+  mParticleBuffer = tkCreateBuffer(device, "Particles", wgpu::BufferUsage::Storage, u64(kMaxParticles) * 48);
+  mDeadBuffer = tkCreateBuffer(device, "Particle Dead List", wgpu::BufferUsage::Storage, u64(kMaxParticles) * sizeof(u32));
+  mAliveBuffer = tkCreateBuffer(device, "Particle Alive Lists", wgpu::BufferUsage::Storage, u64(kMaxParticles) * sizeof(u32) * 2);
+  mCounterBuffer = tkCreateBuffer(device, "Particle Counters", wgpu::BufferUsage::Storage, sizeof(u32) * 4);
+  mIndirectBuffer = tkCreateBuffer(device, "Particle Indirect", wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect, sizeof(u32) * 8);
+
+  // Every slot starts out dead.
+  tkDArray<u32> deadList(kMaxParticles);
+  std::iota(deadList.begin(), deadList.end(), 0u);
+  const tkArray<u32, 4> counters = {kMaxParticles, 0, 0, 0};
+  const tkArray<u32, 8> indirect = {0, 1, 1, 0, 4, 0, 0, 0};
+  wgpu::Queue queue = device.GetQueue();
+  queue.WriteBuffer(mDeadBuffer, 0, deadList.data(), deadList.size() * sizeof(u32));
+  queue.WriteBuffer(mCounterBuffer, 0, counters.data(), sizeof(counters));
+  queue.WriteBuffer(mIndirectBuffer, 0, indirect.data(), sizeof(indirect));
+
+  // Steps for any sort size are a prefix of the steps for the largest one.
+  const tkDArray<tkParticleSortStep> steps = GetSortSteps(kMaxParticles);
+  tkDArray<u8> stepData(std::max<size_t>(steps.size(), 1) * kParticleSortStepStride);
+  for (size_t i = 0; i < steps.size(); i++)
+  {
+    memcpy(&stepData[i * kParticleSortStepStride], &steps[i], sizeof(tkParticleSortStep));
+  }
+  mSortStepBuffer = tkCreateBuffer(device, "Particle Sort Steps", wgpu::BufferUsage::Uniform, stepData.size());
+  queue.WriteBuffer(mSortStepBuffer, 0, stepData.data(), stepData.size());
+
+  const wgpu::BindGroupEntry indirectBinding{.binding = 0, .buffer = mIndirectBuffer, .size = sizeof(u32) * 8};
+  wgpu::BindGroupDescriptor indirectBindGroupDesc{
+    .layout = indirectLayout,
+    .entryCount = 1,
+    .entries = &indirectBinding,
+  };
+  mIndirectBindGroup = device.CreateBindGroup(&indirectBindGroupDesc);
+
+  const wgpu::BindGroupEntry sortStepBinding{.binding = 0, .buffer = mSortStepBuffer, .size = sizeof(tkParticleSortStep)};
+  wgpu::BindGroupDescriptor sortStepBindGroupDesc{
+    .layout = sortStepLayout,
+    .entryCount = 1,
+    .entries = &sortStepBinding,
+  };
+  mSortStepBindGroup = device.CreateBindGroup(&sortStepBindGroupDesc);
+
+  Reserve(device, kParticleSortBlockSize);
+}
+
+void tsRenderParticles::Reserve(wgpu::Device& device, u32 sortSize)
+{
+  bool rebind = false;
+  if (mEmitters.size() > mEmitterCapacity || mEmitterCapacity == 0)
+  {
+    mEmitterCapacity = std::max<u64>(kMinEmitterCapacity, std::bit_ceil(mEmitters.size()));
+    mEmitterBuffer = tkCreateBuffer(device, "Particle Emitters", wgpu::BufferUsage::Storage, mEmitterCapacity * sizeof(tkGpuEmitter));
+    rebind = true;
+  }
+  if (sortSize > mSortCapacity)
+  {
+    mSortCapacity = sortSize;
+    mSortBuffer = tkCreateBuffer(device, "Particle Sort", wgpu::BufferUsage::Storage, mSortCapacity * sizeof(u32) * 2);
+    rebind = true;
+  }
+  if (!rebind)
+  {
+    return;
+  }
+
+  const tkArray<wgpu::BindGroupEntry, 7> simulateEntries = {{
+    {.binding = 0, .buffer = mParamsBuffer, .size = sizeof(tkParticleParams)},
+    {.binding = 1, .buffer = mParticleBuffer, .size = mParticleBuffer.GetSize()},
+    {.binding = 2, .buffer = mDeadBuffer, .size = mDeadBuffer.GetSize()},
+    {.binding = 3, .buffer = mAliveBuffer, .size = mAliveBuffer.GetSize()},
+    {.binding = 4, .buffer = mCounterBuffer, .size = mCounterBuffer.GetSize()},
+    {.binding = 5, .buffer = mEmitterBuffer, .size = mEmitterBuffer.GetSize()},
+    {.binding = 6, .buffer = mSortBuffer, .size = mSortBuffer.GetSize()},
+  }};
+  wgpu::BindGroupDescriptor simulateDesc{
+    .layout = mSimulateLayout,
+    .entryCount = simulateEntries.size(),
+    .entries = simulateEntries.data(),
+  };
+  mSimulateBindGroup = device.CreateBindGroup(&simulateDesc);
+
+  const tkArray<wgpu::BindGroupEntry, 4> drawEntries = {{
+    {.binding = 0, .buffer = mParamsBuffer, .size = sizeof(tkParticleParams)},
+    {.binding = 1, .buffer = mParticleBuffer, .size = mParticleBuffer.GetSize()},
+    {.binding = 2, .buffer = mAliveBuffer, .size = mAliveBuffer.GetSize()},
+    {.binding = 3, .buffer = mSortBuffer, .size = mSortBuffer.GetSize()},
+  }};
+  wgpu::BindGroupDescriptor drawDesc{
+    .layout = mDrawLayout,
+    .entryCount = drawEntries.size(),
+    .entries = drawEntries.data(),
+  };
+  mDrawBindGroup = device.CreateBindGroup(&drawDesc);
+}
+
+u32 tsRenderParticles::GatherEmitters(f32 deltaTime)
+{
+  mEmitters.clear();
+  u32 total = 0;
+  f32 maxLifetime = 0.f;
+  for (auto entity : GetView<tcTransform2d, tcParticleEmitter>())
+  {
+    tcParticleEmitter& emitter = GetComponent<tcParticleEmitter>(entity);
+    emitter.Accumulator += emitter.Rate * deltaTime;
+    const f32 whole = std::floor(emitter.Accumulator);
+    emitter.Accumulator -= whole;
+    const u32 count = std::min(static_cast<u32>(whole) + emitter.Burst, kMaxParticles - total);
+    emitter.Burst = 0;
+    if (count == 0)
+    {
+      continue;
+    }
+
+    mEmitters.push_back({
+      .Position = GetComponent<tcTransform2d>(entity).Position,
+      .Velocity = emitter.Velocity,
+      .Gravity = emitter.Gravity,
+      .Spread = emitter.Spread,
+      .SpeedJitter = emitter.SpeedJitter,
+      .Lifetime = emitter.Lifetime,
+      .StartSize = emitter.StartSize,
+      .EndSize = emitter.EndSize,
+      .First = total,
+      .StartColor = glm::packUnorm4x8(emitter.StartColor),
+      .EndColor = glm::packUnorm4x8(emitter.EndColor),
+    });
+    total += count;
+    maxLifetime = std::max(maxLifetime, emitter.Lifetime);
+  }
+
+  if (total > 0)
+  {
+    mEmissions.push_back({mTime + maxLifetime + kParticleExpiryMargin, total});
+  }
+  return total;
+}
+
+void tsRenderParticles::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
+{
+  const auto now = std::chrono::steady_clock::now();
+  const f32 deltaTime = mFrame == 0 ? 0.f : std::min(std::chrono::duration<f32>(now - mLastTime).count(), kMaxParticleDeltaTime);
+  mLastTime = now;
+  mTime += deltaTime;
+  mFrame++;
+
+  const u32 emitTotal = GatherEmitters(deltaTime);
+
+  // Upper bound on live particles, from what was emitted within its lifetime. Once it
+  // reaches zero every particle has been retired and no GPU work is needed.
+  std::erase_if(mEmissions, [this](const tkEmission& emission) { return emission.Expiry < mTime; });
+  u64 liveBound = 0;
+  for (const tkEmission& emission : mEmissions)
+  {
+    liveBound += emission.Count;
+  }
+  mActive = liveBound > 0;
+  if (!mActive)
+  {
+    return;
+  }
+
+  const u32 sortSize = std::bit_ceil(std::clamp<u32>(static_cast<u32>(std::min<u64>(liveBound, kMaxParticles)), kParticleSortBlockSize, kMaxParticles));
+  Reserve(device, mSorted ? sortSize : kParticleSortBlockSize);
+
+  const MVPUniforms& camera = tkRenderer::Get().mMvpUniforms;
+  const tkParticleParams params{
+    .ViewProjection = camera.Projection * camera.View,
+    .DeltaTime = deltaTime,
+    .Seed = mFrame * 0x9E3779B9u,
+    .EmitTotal = emitTotal,
+    .EmitterCount = static_cast<u32>(mEmitters.size()),
+    .Current = mCurrent,
+    .SortSize = sortSize,
+    .MaxParticles = kMaxParticles,
+    .Sorted = mSorted ? 1u : 0u,
+  };
+  wgpu::Queue queue = device.GetQueue();
+  queue.WriteBuffer(mParamsBuffer, 0, &params, sizeof(params));
+  if (!mEmitters.empty())
+  {
+    queue.WriteBuffer(mEmitterBuffer, 0, mEmitters.data(), mEmitters.size() * sizeof(tkGpuEmitter));
+  }
+
+  wgpu::ComputePassEncoder pass = encoder.BeginComputePass();
+  pass.SetBindGroup(0, mSimulateBindGroup);
+  pass.SetPipeline(mBeginPipeline);
+  pass.DispatchWorkgroups(1);
+  if (emitTotal > 0)
+  {
+    pass.SetPipeline(mEmitPipeline);
+    pass.DispatchWorkgroups((emitTotal + kParticleWorkgroupSize - 1) / kParticleWorkgroupSize);
+  }
+
+  pass.SetBindGroup(1, mIndirectBindGroup);
+  pass.SetPipeline(mPreparePipeline);
+  pass.DispatchWorkgroups(1);
+  // The simulate layout has no group 1, so the indirect buffer is not bound as storage here.
+  pass.SetPipeline(mSimulatePipeline);
+  pass.DispatchWorkgroupsIndirect(mIndirectBuffer, 0);
+  pass.SetPipeline(mFinalizePipeline);
+  pass.DispatchWorkgroups(1);
+
+  if (mSorted)
+  {
+    DispatchSort(pass, sortSize);
+  }
+  pass.End();
+
+  mCurrent = 1 - mCurrent;
+}
+
+void tsRenderParticles::DispatchSort(wgpu::ComputePassEncoder& pass, u32 sortSize)
+{
+  pass.SetPipeline(mSortKeysPipeline);
+  pass.DispatchWorkgroups(sortSize / kParticleSortWorkgroupSize);
+  pass.SetPipeline(mSortLocalPipeline);
+  pass.DispatchWorkgroups(sortSize / kParticleSortBlockSize);
+
+  const tkDArray<tkParticleSortStep> steps = GetSortSteps(sortSize);
+  for (u32 i = 0; i < steps.size(); i++)
+  {
+    const u32 offset = i * kParticleSortStepStride;
+    pass.SetBindGroup(1, mSortStepBindGroup, 1, &offset);
+    if (steps[i].J != 0)
+    {
+      pass.SetPipeline(mSortGlobalPipeline);
+      pass.DispatchWorkgroups(sortSize / 2 / kParticleSortWorkgroupSize);
+    }
+    else
+    {
+      pass.SetPipeline(mSortMergePipeline);
+      pass.DispatchWorkgroups(sortSize / kParticleSortBlockSize);
+    }
+  }
+}
+
+void tsRenderParticles::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+{
+  if (!mActive)
+  {
+    return;
+  }
+
+  pass.SetPipeline(mDrawPipeline);
+  pass.SetBindGroup(0, mDrawBindGroup);
+  pass.DrawIndirect(mIndirectBuffer, sizeof(u32) * 4);
+}
@@ -0,0 +1,109 @@
+#ifndef TS_RENDER_PARTICLES_H
+#define TS_RENDER_PARTICLES_H
+
+#include "../core/system.h"
+#include <chrono>
+#include <webgpu/webgpu_cpp.h>
+
+const u32 kMaxParticles = 1 << 20;
+
+// Matches Params in particles.wgsl and particleDraw.wgsl.
+struct tkParticleParams
+{
+  m4 ViewProjection;
+  f32 DeltaTime;
+  u32 Seed;
+  u32 EmitTotal;
+  u32 EmitterCount;
+  u32 Current;
+  u32 SortSize;
+  u32 MaxParticles;
+  u32 Sorted;
+};
+
+// Matches Emitter in particles.wgsl.
+struct tkGpuEmitter
+{
+  v2 Position;
+  v2 Velocity;
+  v2 Gravity;
+  f32 Spread;
+  f32 SpeedJitter;
+  f32 Lifetime;
+  f32 StartSize;
+  f32 EndSize;
+  u32 First;
+  u32 StartColor;
+  u32 EndColor;
+  u32 Padding[2];
+};
+
+// Particles live entirely in GPU storage buffers. Each frame the CPU only uploads one
+// record per active tcParticleEmitter; compute passes then pop slots from a dead list,
+// spawn, simulate and compact survivors into an alive list. The draw is indirect, with
+// the instance count written by the GPU.
+//
+// With sorting enabled the live particles are bitonic sorted back to front before
+// drawing, so alpha blending composites in the right order.
+class tsRenderParticles : public tkRenderSystem
+{
+  // Particles still alive at most until Expiry, for bounding the sort.
+  struct tkEmission
+  {
+    f32 Expiry;
+    u32 Count;
+  };
+
+  wgpu::ComputePipeline mBeginPipeline;
+  wgpu::ComputePipeline mEmitPipeline;
+  wgpu::ComputePipeline mPreparePipeline;
+  wgpu::ComputePipeline mSimulatePipeline;
+  wgpu::ComputePipeline mFinalizePipeline;
+  wgpu::ComputePipeline mSortKeysPipeline;
+  wgpu::ComputePipeline mSortLocalPipeline;
+  wgpu::ComputePipeline mSortGlobalPipeline;
+  wgpu::ComputePipeline mSortMergePipeline;
+  wgpu::RenderPipeline mDrawPipeline;
+
+  wgpu::BindGroupLayout mSimulateLayout;
+  wgpu::BindGroupLayout mDrawLayout;
+  wgpu::BindGroup mIndirectBindGroup;
+  wgpu::BindGroup mSortStepBindGroup;
+  wgpu::BindGroup mSimulateBindGroup;
+  wgpu::BindGroup mDrawBindGroup;
+
+  wgpu::Buffer mParamsBuffer;
+  wgpu::Buffer mParticleBuffer;
+  wgpu::Buffer mDeadBuffer;
+  wgpu::Buffer mAliveBuffer;
+  wgpu::Buffer mCounterBuffer;
+  wgpu::Buffer mIndirectBuffer;
+  wgpu::Buffer mEmitterBuffer;
+  wgpu::Buffer mSortBuffer;
+  wgpu::Buffer mSortStepBuffer;
+  u64 mEmitterCapacity = 0;
+  u64 mSortCapacity = 0;
+
+  tkDArray<tkGpuEmitter> mEmitters;
+  tkDArray<tkEmission> mEmissions;
+  std::chrono::steady_clock::time_point mLastTime;
+  f32 mTime = 0.f;
+  u32 mCurrent = 0;
+  u32 mFrame = 0;
+  bool mActive = false;
+  bool mSorted = false;
+
+public:
+  void SetupPipelines();
+  // Sort back to front for correct alpha blending, at the cost of a bitonic sort.
+  void SetSorted(bool sorted) { mSorted = sorted; }
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
+  void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+
+private:
+  u32 GatherEmitters(f32 deltaTime);
+  void Reserve(wgpu::Device& device, u32 sortSize);
+  void DispatchSort(wgpu::ComputePassEncoder& pass, u32 sortSize);
+};
+
+#endif //TS_RENDER_PARTICLES_H
@@ -0,0 +1,173 @@
+#include "sRenderSprite.h"
+#include "../components/sprite.h"
+#include "../components/transform2d.h"
+#include "../core/gpuUtil.h"
+#include "../core/renderer.h"
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+const u64 kMinSpriteInstanceCapacity = 1024;
+
+void tsRenderSprite::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 4> entries = {{
+    {.binding = 0, .visibility = wgpu::ShaderStage::Vertex, .buffer = {.type = wgpu::BufferBindingType::Uniform}},
+    {.binding = 1, .visibility = wgpu::ShaderStage::Fragment, .sampler = {.type = wgpu::SamplerBindingType::Filtering}},
+    {.binding = 2, .visibility = wgpu::ShaderStage::Fragment, .texture = {.sampleType = wgpu::TextureSampleType::Float}},
+    {.binding = 3, .visibility = wgpu::ShaderStage::Vertex, .buffer = {.type = wgpu::BufferBindingType::ReadOnlyStorage}},
+  }};
+  wgpu::BindGroupLayoutDescriptor layoutDesc{
+    .label = "Sprite",
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  mLayout = tkRenderer::Get().mBindGroupCache.GetLayout(layoutDesc);
+
+  wgpu::BufferDescriptor cameraDesc{
+    .label = "Sprite Camera",
+    .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+    .size = sizeof(m4),
+  };
+  mCameraBuffer = device.CreateBuffer(&cameraDesc);
+
+  const tkArray<wgpu::VertexAttribute, 4> attributes = {{
+    {.format = wgpu::VertexFormat::Uint32, .offset = offsetof(tkSpriteInstance, Transform), .shaderLocation = 0},
+    {.format = wgpu::VertexFormat::Unorm8x4, .offset = offsetof(tkSpriteInstance, Color), .shaderLocation = 1},
+    {.format = wgpu::VertexFormat::Float32x2, .offset = offsetof(tkSpriteInstance, Size), .shaderLocation = 2},
+    {.format = wgpu::VertexFormat::Float32x4, .offset = offsetof(tkSpriteInstance, UV), .shaderLocation = 3},
+  }};
+  wgpu::VertexBufferLayout instanceLayout{
+    .arrayStride = sizeof(tkSpriteInstance),
+    .stepMode = wgpu::VertexStepMode::Instance,
+    .attributeCount = attributes.size(),
+    .attributes = attributes.data(),
+  };
+
+  wgpu::ShaderModule shaderModule = tkRenderer::Get().LoadShader("shaders/sprite.wgsl");
+  const wgpu::ColorTargetState colorTargetState = tkAlphaBlendTarget();
+  wgpu::FragmentState fragmentState{
+    .module = shaderModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+
+  // Blended sprites are tested against the scene but do not occlude each other.
+  const wgpu::DepthStencilState depthStencilState = tkRenderer::Get().GetBlendedDepthState();
+
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &mLayout,
+  };
+  wgpu::RenderPipelineDescriptor pipelineDesc{
+    .label = "Sprite",
+    .layout = device.CreatePipelineLayout(&pipelineLayoutDesc),
+    .vertex = {.module = shaderModule, .entryPoint = "vs_main", .bufferCount = 1, .buffers = &instanceLayout},
+    .primitive = {.topology = wgpu::PrimitiveTopology::TriangleStrip, .cullMode = wgpu::CullMode::None},
+    .depthStencil = &depthStencilState,
+    .fragment = &fragmentState,
+  };
+  mPipeline = device.CreateRenderPipeline(&pipelineDesc);
+}
+
+void tsRenderSprite::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
+{
+  const tkSpriteAtlas& atlas = tkRenderer::Get().mSpriteAtlas;
+  const tkGpuMirror<tcTransform2d>& transforms = tkRenderer::Get().mTransforms2d;
+  const u32 pageCount = atlas.GetPageCount();
+  mPageInstances.resize(pageCount);
+  for (tkDArray<tkSpriteInstance>& instances : mPageInstances)
+  {
+    instances.clear();
+  }
+
+  for (auto entity : GetView<tcTransform2d, tcSprite>())
+  {
+    const tcSprite& sprite = GetComponent<tcSprite>(entity);
+    if (sprite.Region == kInvalidSpriteRegion)
+    {
+      continue;
+    }
+
+    const tkSpriteRegion& region = atlas.GetRegion(sprite.Region);
+    mPageInstances[region.Page].push_back({
+      .Transform = transforms.GetIndex(entity),
+      .Color = glm::packUnorm4x8(sprite.Color),
+      .Size = sprite.Size,
+      .UV = v4(region.UVMin, region.UVMax),
+    });
+  }
+
+  mInstances.clear();
+  for (const tkDArray<tkSpriteInstance>& instances : mPageInstances)
+  {
+    mInstances.insert(mInstances.end(), instances.begin(), instances.end());
+  }
+  if (mInstances.empty())
+  {
+    return;
+  }
+
+  if (mInstances.size() > mInstanceCapacity)
+  {
+    mInstanceCapacity = std::max<u64>(kMinSpriteInstanceCapacity, std::bit_ceil(mInstances.size()));
+    wgpu::BufferDescriptor instanceDesc{
+      .label = "Sprite Instances",
+      .usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::CopyDst,
+      .size = mInstanceCapacity * sizeof(tkSpriteInstance),
+    };
+    mInstanceBuffer = device.CreateBuffer(&instanceDesc);
+  }
+
+  // Looked up every frame, the cache only creates one when a page appears or the
+  // transform mirror moves to a new buffer.
+  mPageBindGroups.clear();
+  for (u32 page = 0; page < pageCount; page++)
+  {
+    const tkArray<wgpu::BindGroupEntry, 4> entries = {{
+      {.binding = 0, .buffer = mCameraBuffer, .size = sizeof(m4)},
+      {.binding = 1, .sampler = tkRenderer::Get().wSampler},
+      {.binding = 2, .textureView = atlas.GetPageView(page)},
+      {.binding = 3, .buffer = transforms.GetBuffer(), .size = transforms.GetBufferSize()},
+    }};
+    wgpu::BindGroupDescriptor bindGroupDesc{
+      .layout = mLayout,
+      .entryCount = entries.size(),
+      .entries = entries.data(),
+    };
+    mPageBindGroups.push_back(tkRenderer::Get().mBindGroupCache.GetBindGroup(bindGroupDesc));
+  }
+
+  const MVPUniforms& camera = tkRenderer::Get().mMvpUniforms;
+  const m4 viewProjection = camera.Projection * camera.View;
+  wgpu::Queue queue = device.GetQueue();
+  queue.WriteBuffer(mCameraBuffer, 0, &viewProjection, sizeof(viewProjection));
+  queue.WriteBuffer(mInstanceBuffer, 0, mInstances.data(), mInstances.size() * sizeof(tkSpriteInstance));
+}
+
+void tsRenderSprite::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+{
+  if (mInstances.empty())
+  {
+    return;
+  }
+
+  pass.SetPipeline(mPipeline);
+  pass.SetVertexBuffer(0, mInstanceBuffer);
+  u32 firstInstance = 0;
+  for (u32 page = 0; page < mPageInstances.size(); page++)
+  {
+    const u32 count = static_cast<u32>(mPageInstances[page].size());
+    if (count == 0)
+    {
+      continue;
+    }
+    pass.SetBindGroup(0, mPageBindGroups[page]);
+    pass.Draw(4, count, 0, firstInstance);
+    firstInstance += count;
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef TS_RENDER_SPRITE_H
+#define TS_RENDER_SPRITE_H
+
+#include "../core/system.h"
+#include <webgpu/webgpu_cpp.h>
+
+// Matches Instance in sprite.wgsl.
+struct tkSpriteInstance
+{
+  // Index into the renderer's tcTransform2d mirror.
+  u32 Transform;
+  // RGBA8 unorm.
+  u32 Color;
+  v2 Size;
+  v4 UV;
+};
+
+// Draws every tcSprite as an instanced quad. Instances are grouped by atlas page and
+// uploaded in one buffer, so a frame costs one draw call per page in use rather than
+// one per sprite. Transforms are not copied into instances, the shader reads them from
+// the renderer's tcTransform2d mirror.
+class tsRenderSprite : public tkRenderSystem
+{
+  wgpu::RenderPipeline mPipeline;
+  wgpu::BindGroupLayout mLayout;
+  wgpu::Buffer mCameraBuffer;
+  wgpu::Buffer mInstanceBuffer;
+  tkDArray<wgpu::BindGroup> mPageBindGroups;
+  tkDArray<tkDArray<tkSpriteInstance>> mPageInstances;
+  tkDArray<tkSpriteInstance> mInstances;
+  u64 mInstanceCapacity = 0;
+
+public:
+  void SetupPipelines();
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
+  void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+};
+
+#endif //TS_RENDER_SPRITE_H
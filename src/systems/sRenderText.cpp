@@ -0,0 +1,159 @@
+#include "sRenderText.h"
+#include "../components/text.h"
+#include "../components/transform2d.h"
+#include "../core/gpuUtil.h"
+#include "../core/renderer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+const u64 kMinGlyphInstanceCapacity = 4096;
+
+void tsRenderText::SetupPipelines()
+{
+  wgpu::Device& device = tkRenderer::GetDevice();
+
+  const tkArray<wgpu::BindGroupLayoutEntry, 3> entries = {{
+    {.binding = 0, .visibility = wgpu::ShaderStage::Vertex, .buffer = {.type = wgpu::BufferBindingType::Uniform}},
+    {.binding = 1, .visibility = wgpu::ShaderStage::Fragment, .sampler = {.type = wgpu::SamplerBindingType::Filtering}},
+    {.binding = 2, .visibility = wgpu::ShaderStage::Fragment, .texture = {.sampleType = wgpu::TextureSampleType::Float}},
+  }};
+  wgpu::BindGroupLayoutDescriptor layoutDesc{
+    .label = "Text",
+    .entryCount = entries.size(),
+    .entries = entries.data(),
+  };
+  wgpu::BindGroupLayout layout = device.CreateBindGroupLayout(&layoutDesc);
+
+  wgpu::BufferDescriptor cameraDesc{
+    .label = "Text Camera",
+    .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+    .size = sizeof(tkTextCamera),
+  };
+  mCameraBuffer = device.CreateBuffer(&cameraDesc);
+
+  // The atlas texture is created once and only rewritten, so one bind group lasts.
+  const tkArray<wgpu::BindGroupEntry, 3> bindings = {{
+    {.binding = 0, .buffer = mCameraBuffer, .size = sizeof(tkTextCamera)},
+    {.binding = 1, .sampler = tkRenderer::Get().wSampler},
+    {.binding = 2, .textureView = tkRenderer::Get().mGlyphCache.GetView()},
+  }};
+  wgpu::BindGroupDescriptor bindGroupDesc{
+    .layout = layout,
+    .entryCount = bindings.size(),
+    .entries = bindings.data(),
+  };
+  mBindGroup = device.CreateBindGroup(&bindGroupDesc);
+
+  const tkArray<wgpu::VertexAttribute, 5> attributes = {{
+    {.format = wgpu::VertexFormat::Float32x2, .offset = offsetof(tkGlyphInstance, Position), .shaderLocation = 0},
+    {.format = wgpu::VertexFormat::Float32x2, .offset = offsetof(tkGlyphInstance, Size), .shaderLocation = 1},
+    {.format = wgpu::VertexFormat::Unorm8x4, .offset = offsetof(tkGlyphInstance, Color), .shaderLocation = 2},
+    {.format = wgpu::VertexFormat::Uint32, .offset = offsetof(tkGlyphInstance, Screen), .shaderLocation = 3},
+    {.format = wgpu::VertexFormat::Float32x4, .offset = offsetof(tkGlyphInstance, UV), .shaderLocation = 4},
+  }};
+  wgpu::VertexBufferLayout instanceLayout{
+    .arrayStride = sizeof(tkGlyphInstance),
+    .stepMode = wgpu::VertexStepMode::Instance,
+    .attributeCount = attributes.size(),
+    .attributes = attributes.data(),
+  };
+
+  wgpu::ShaderModule shaderModule = tkRenderer::Get().LoadShader("shaders/text.wgsl");
+  const wgpu::ColorTargetState colorTargetState = tkAlphaBlendTarget();
+  wgpu::FragmentState fragmentState{
+    .module = shaderModule,
+    .entryPoint = "fs_main",
+    .targetCount = 1,
+    .targets = &colorTargetState
+  };
+
+  const wgpu::DepthStencilState depthStencilState = tkRenderer::Get().GetBlendedDepthState();
+
+  wgpu::PipelineLayoutDescriptor pipelineLayoutDesc{
+    .bindGroupLayoutCount = 1,
+    .bindGroupLayouts = &layout,
+  };
+  wgpu::RenderPipelineDescriptor pipelineDesc{
+    .label = "Text",
+    .layout = device.CreatePipelineLayout(&pipelineLayoutDesc),
+    .vertex = {.module = shaderModule, .entryPoint = "vs_main", .bufferCount = 1, .buffers = &instanceLayout},
+    .primitive = {.topology = wgpu::PrimitiveTopology::TriangleStrip, .cullMode = wgpu::CullMode::None},
+    .depthStencil = &depthStencilState,
+    .fragment = &fragmentState,
+  };
+  mPipeline = device.CreateRenderPipeline(&pipelineDesc);
+}
+
+void tsRenderText::PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder)
+{
+  mInstances.clear();
+  tkGlyphCache& glyphs = tkRenderer::Get().mGlyphCache;
+  if (!glyphs.IsLoaded())
+  {
+    return;
+  }
+
+  glyphs.BeginFrame();
+  wgpu::Queue queue = device.GetQueue();
+  for (auto entity : GetView<tcTransform2d, tcText>())
+  {
+    const tcText& text = GetComponent<tcText>(entity);
+    const tcTransform2d& transform = GetComponent<tcTransform2d>(entity);
+    const f32 size = text.Size * transform.Scale;
+    const u32 color = glm::packUnorm4x8(text.Color);
+    for (const tkGlyphQuad& glyph : glyphs.GetLayout(text.Text).Glyphs)
+    {
+      v4 uv;
+      if (!glyphs.GetGlyph(queue, glyph.Codepoint, uv))
+      {
+        continue;
+      }
+      mInstances.push_back({
+        .Position = transform.Position + glyph.Offset * size,
+        .Size = glyph.Size * size,
+        .Color = color,
+        .Screen = text.Screen ? 1u : 0u,
+        .UV = uv,
+      });
+    }
+  }
+  if (mInstances.empty())
+  {
+    return;
+  }
+
+  if (mInstances.size() > mInstanceCapacity)
+  {
+    mInstanceCapacity = std::max<u64>(kMinGlyphInstanceCapacity, std::bit_ceil(mInstances.size()));
+    wgpu::BufferDescriptor instanceDesc{
+      .label = "Text Instances",
+      .usage = wgpu::BufferUsage::Vertex | wgpu::BufferUsage::CopyDst,
+      .size = mInstanceCapacity * sizeof(tkGlyphInstance),
+    };
+    mInstanceBuffer = device.CreateBuffer(&instanceDesc);
+  }
+
+  const MVPUniforms& camera = tkRenderer::Get().mMvpUniforms;
+  const tkTextCamera textCamera{
+    .World = camera.Projection * camera.View,
+    .Screen = glm::ortho(0.f, static_cast<f32>(kWindowWidth), 0.f, static_cast<f32>(kWindowHeight)),
+  };
+  queue.WriteBuffer(mCameraBuffer, 0, &textCamera, sizeof(textCamera));
+  queue.WriteBuffer(mInstanceBuffer, 0, mInstances.data(), mInstances.size() * sizeof(tkGlyphInstance));
+}
+
+void tsRenderText::Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass)
+{
+  if (mInstances.empty())
+  {
+    return;
+  }
+
+  pass.SetPipeline(mPipeline);
+  pass.SetBindGroup(0, mBindGroup);
+  pass.SetVertexBuffer(0, mInstanceBuffer);
+  pass.Draw(4, static_cast<u32>(mInstances.size()));
+}
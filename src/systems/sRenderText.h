@@ -0,0 +1,43 @@
+#ifndef TS_RENDER_TEXT_H
+#define TS_RENDER_TEXT_H
+
+#include "../core/system.h"
+#include <webgpu/webgpu_cpp.h>
+
+// Matches Instance in text.wgsl.
+struct tkGlyphInstance
+{
+  v2 Position;
+  v2 Size;
+  // RGBA8 unorm.
+  u32 Color;
+  u32 Screen;
+  v4 UV;
+};
+
+// Matches Camera in text.wgsl.
+struct tkTextCamera
+{
+  m4 World;
+  m4 Screen;
+};
+
+// Draws every tcText from the renderer's glyph cache. All glyphs of a frame live in
+// one atlas, so they are uploaded to one instance buffer and drawn with a single
+// instanced draw.
+class tsRenderText : public tkRenderSystem
+{
+  wgpu::RenderPipeline mPipeline;
+  wgpu::Buffer mCameraBuffer;
+  wgpu::Buffer mInstanceBuffer;
+  wgpu::BindGroup mBindGroup;
+  tkDArray<tkGlyphInstance> mInstances;
+  u64 mInstanceCapacity = 0;
+
+public:
+  void SetupPipelines();
+  void PreRender(wgpu::Device& device, wgpu::CommandEncoder& encoder) override;
+  void Render(wgpu::Device& device, wgpu::RenderPassEncoder& pass) override;
+};
+
+#endif //TS_RENDER_TEXT_H
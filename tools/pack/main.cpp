@@ -0,0 +1,38 @@
+#include "../../src/core/pack.h"
+#include <cstdio>
+#include <cstring>
+
+static int PrintUsage()
+{
+  printf("Usage: teck-pack <resource directory> <output pack> [none|lz4|zstd]\n");
+  return TK_EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3)
+  {
+    return PrintUsage();
+  }
+
+  ePackCompression compression = ePackCompression::LZ4;
+  if (argc > 3)
+  {
+    if (strcmp(argv[3], "none") == 0)
+    {
+      compression = ePackCompression::None;
+    }
+    else if (strcmp(argv[3], "zstd") == 0)
+    {
+      compression = ePackCompression::Zstd;
+    }
+    else if (strcmp(argv[3], "lz4") != 0)
+    {
+      return PrintUsage();
+    }
+  }
+
+  tkPackBuilder builder;
+  builder.AddDirectory(argv[1], compression);
+  return builder.Write(argv[2]) ? TK_EXIT_SUCCESS : TK_EXIT_FAILURE;
+}